@@ -0,0 +1,851 @@
+// Benchmarks.cpp
+// angel.rodriguez@udit.es
+
+#include "Benchmarks.hpp"
+#include "Cube.hpp"
+#include "Height_Field.hpp"
+#include "Height_Map.hpp"
+#include "Mesh_Statistics.hpp"
+#include "Normal_Map.hpp"
+#include "Terrain_Cache.hpp"
+#include "Terrain_Mesh.hpp"
+#include "Terrain_Ray_Caster.hpp"
+#include <glm.hpp>
+#include <half.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using std::vector;
+using half_float::half;
+
+namespace udit
+{
+
+    namespace
+    {
+
+        typedef std::chrono::high_resolution_clock Clock;
+
+        // Mejor tiempo (en milisegundos) de varias repeticiones
+        template< typename FUNCTION >
+        double measure(unsigned repetitions, FUNCTION function)
+        {
+            double best = 1e30;
+
+            for (unsigned i = 0; i < repetitions; ++i)
+            {
+                auto start = Clock::now();
+                function();
+                best = std::min(best, std::chrono::duration< double, std::milli >(Clock::now() - start).count());
+            }
+
+            return best;
+        }
+
+        // Heightmap sintetico (RGB) para no depender de los assets
+        vector< unsigned char > make_heightmap(int size)
+        {
+            vector< unsigned char > image(size_t(size) * size * 3);
+
+            for (int y = 0; y < size; ++y)
+            {
+                for (int x = 0; x < size; ++x)
+                {
+                    float value = 0.5f + 0.25f * std::sin(x * 0.05f) * std::cos(y * 0.03f) + 0.2f * std::sin((x + y) * 0.011f);
+                    image[(size_t(y) * size + x) * 3] = (unsigned char)(std::max(0.0f, std::min(value, 1.0f)) * 255.0f);
+                }
+            }
+
+            return image;
+        }
+
+        // Canal rojo de una imagen RGB como heightmap de un canal
+        Height_Map red_channel(const vector< unsigned char > & image, int size)
+        {
+            Height_Map height_map(size, size, Height_Map::UNORM8);
+
+            unsigned char * texels = static_cast< unsigned char * >(height_map.get_data());
+
+            for (size_t i = 0; i < size_t(size) * size; ++i) texels[i] = image[i * 3];
+
+            return height_map;
+        }
+
+        // Los dos bucles que usaba Terrain antes de Terrain_Mesh (un hilo, vertice a vertice)
+        void scalar_terrain_mesh
+        (
+            const unsigned char * image, int tex_w, int tex_h, float width, float depth,
+            unsigned x_slices, unsigned z_slices, float max_height, vector< Packed_Vertex > & vertices
+        )
+        {
+            unsigned n_verts_x = x_slices + 1;
+            unsigned n_verts_z = z_slices + 1;
+
+            vertices.assign(size_t(n_verts_x) * n_verts_z, Packed_Vertex());
+
+            vector< float > temp_heights(size_t(n_verts_x) * n_verts_z);
+
+            float x_step = width / float(x_slices);
+            float z_step = depth / float(z_slices);
+
+            for (unsigned z = 0; z < n_verts_z; ++z)
+            {
+                for (unsigned x = 0; x < n_verts_x; ++x)
+                {
+                    int img_x = (int)((float)x / x_slices * (tex_w - 1));
+                    int img_y = (int)((float)z / z_slices * (tex_h - 1));
+
+                    float y_pos = (float)image[(size_t(img_y) * tex_w + img_x) * 3] / 255.0f * max_height;
+                    y_pos -= max_height * 0.15f;
+
+                    size_t i = size_t(z) * n_verts_x + x;
+
+                    temp_heights[i] = y_pos;
+
+                    vertices[i].position[0] = half(-width * 0.5f + x * x_step);
+                    vertices[i].position[1] = half(y_pos);
+                    vertices[i].position[2] = half(-depth * 0.5f + z * z_step);
+                    vertices[i].position[3] = half(0.0f);
+                    vertices[i].set_uv((float)x / (float)x_slices, (float)z / (float)z_slices);
+                }
+            }
+
+            for (unsigned z = 0; z < n_verts_z; ++z)
+            {
+                for (unsigned x = 0; x < n_verts_x; ++x)
+                {
+                    size_t i = size_t(z) * n_verts_x + x;
+
+                    float h_L = (x > 0)             ? temp_heights[i - 1]         : temp_heights[i];
+                    float h_R = (x < n_verts_x - 1) ? temp_heights[i + 1]         : temp_heights[i];
+                    float h_D = (z > 0)             ? temp_heights[i - n_verts_x] : temp_heights[i];
+                    float h_U = (z < n_verts_z - 1) ? temp_heights[i + n_verts_x] : temp_heights[i];
+
+                    vertices[i].set_normal(glm::normalize(glm::vec3(h_L - h_R, 2.0f * x_step, h_D - h_U)));
+                }
+            }
+        }
+
+        // Numero de vertices que no coinciden byte a byte
+        size_t count_differences(const vector< Packed_Vertex > & a, const vector< Packed_Vertex > & b)
+        {
+            if (a.size() != b.size()) return std::max(a.size(), b.size());
+
+            size_t differences = 0;
+
+            for (size_t i = 0; i < a.size(); ++i)
+            {
+                if (std::memcmp(&a[i], &b[i], sizeof(Packed_Vertex)) != 0) ++differences;
+            }
+
+            return differences;
+        }
+
+        void benchmark_terrain_mesh()
+        {
+            const int      image_size = 1024;
+            const unsigned sizes[]    = { 100, 256, 512, 1024, 2048, 4096 };
+
+            vector< unsigned char > image      = make_heightmap(image_size);
+            Height_Map              height_map = red_channel(image, image_size);
+
+            std::printf("\nTerrain_Mesh (vertices por lado, ms): escalar | 1 hilo | %u hilos | aceleracion | F16C %s\n",
+                        std::max(1u, std::thread::hardware_concurrency()), Terrain_Mesh::is_f16c_enabled() ? "si" : "no");
+
+            for (unsigned size : sizes)
+            {
+                unsigned slices      = size - 1;
+                unsigned repetitions = size <= 1024 ? 5 : 2;
+
+                vector< Packed_Vertex > reference;
+
+                double scalar = measure(repetitions, [&]
+                {
+                    scalar_terrain_mesh(image.data(), image_size, image_size, 200.0f, 200.0f, slices, slices, 15.0f, reference);
+                });
+
+                double single = measure(repetitions, [&]
+                {
+                    Terrain_Mesh mesh(&height_map, 200.0f, 200.0f, slices, slices, 15.0f, true, 1);
+                });
+
+                double parallel = measure(repetitions, [&]
+                {
+                    Terrain_Mesh mesh(&height_map, 200.0f, 200.0f, slices, slices, 15.0f);
+                });
+
+                Terrain_Mesh mesh(&height_map, 200.0f, 200.0f, slices, slices, 15.0f);
+
+                size_t differences = count_differences(reference, mesh.vertices);
+
+                std::printf("  %4u^2  %9.2f | %9.2f | %9.2f | %5.1fx | %zu diferencias\n",
+                            size, scalar, single, parallel, scalar / parallel, differences);
+            }
+        }
+
+
+        // Cache de datos simulada (32 KB, lineas de 64 bytes, 8 vias con reemplazo LRU) para contar
+        // las lineas que hay que traer de memoria al leer los vertices en el orden de los indices
+        class Cache_Simulator
+        {
+            static const unsigned line_size = 64, set_count = 64, ways = 8;
+
+            uintptr_t tags [set_count][ways];
+            unsigned  ages [set_count][ways];
+            unsigned  clock;
+
+        public:
+
+            size_t misses;
+
+            Cache_Simulator() : clock(0), misses(0)
+            {
+                std::memset(tags, 0xFF, sizeof(tags));
+                std::memset(ages, 0,    sizeof(ages));
+            }
+
+            void touch(const void * address, size_t size)
+            {
+                uintptr_t first = reinterpret_cast< uintptr_t >(address) / line_size;
+                uintptr_t last  = (reinterpret_cast< uintptr_t >(address) + size - 1) / line_size;
+
+                for (uintptr_t line = first; line <= last; ++line)
+                {
+                    unsigned set    = unsigned(line % set_count);
+                    unsigned oldest = 0;
+                    bool     hit    = false;
+
+                    for (unsigned way = 0; way < ways && !hit; ++way)
+                    {
+                        if (tags[set][way] == line) { ages[set][way] = ++clock; hit = true; }
+                        if (ages[set][way] < ages[set][oldest]) oldest = way;
+                    }
+
+                    if (!hit)
+                    {
+                        tags[set][oldest] = line;
+                        ages[set][oldest] = ++clock;
+                        ++misses;
+                    }
+                }
+            }
+        };
+
+        void benchmark_vertex_formats()
+        {
+            const unsigned side  = 1024;
+            const size_t   count = size_t(side) * side;
+
+            // Indices de una rejilla en el orden del terreno (filas de quads)
+            vector< GLuint > indices;
+            indices.reserve(size_t(side - 1) * (side - 1) * 6);
+
+            for (unsigned z = 0; z + 1 < side; ++z)
+            {
+                for (unsigned x = 0; x + 1 < side; ++x)
+                {
+                    GLuint tl = z * side + x, tr = tl + 1, bl = tl + side, br = bl + 1;
+                    indices.push_back(tl); indices.push_back(bl); indices.push_back(tr);
+                    indices.push_back(tr); indices.push_back(bl); indices.push_back(br);
+                }
+            }
+
+            // Formato anterior del terreno (3 buffers de half), del cubo (3 buffers de float) y el nuevo
+            vector< half  > half_positions(count * 3), half_uvs(count * 2), half_normals(count * 3);
+            vector< float > float_positions(count * 3), float_uvs(count * 2), float_normals(count * 3);
+            vector< Packed_Vertex > packed(count);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                glm::vec3 position(float(i % side), std::sin(i * 0.001f), float(i / side));
+                glm::vec2 uv      (float(i % side) / side, float(i / side) / side);
+                glm::vec3 normal   = glm::normalize(glm::vec3(std::sin(i * 0.01f), 1.0f, std::cos(i * 0.013f)));
+
+                for (int c = 0; c < 3; ++c) half_positions[i * 3 + c] = half(float_positions[i * 3 + c] = position[c]);
+                for (int c = 0; c < 2; ++c) half_uvs      [i * 2 + c] = half(float_uvs      [i * 2 + c] = uv      [c]);
+                for (int c = 0; c < 3; ++c) half_normals  [i * 3 + c] = half(float_normals  [i * 3 + c] = normal  [c]);
+
+                packed[i].set(position * (1.0f / side), uv, normal);
+            }
+
+            Cache_Simulator half_cache, float_cache, packed_cache;
+            float           error = 0.0f;       // Mayor error de la normal decodificada (en grados)
+
+            for (GLuint i : indices)
+            {
+                half_cache  .touch(&half_positions [i * 3], 3 * sizeof(half ));
+                half_cache  .touch(&half_uvs       [i * 2], 2 * sizeof(half ));
+                half_cache  .touch(&half_normals   [i * 3], 3 * sizeof(half ));
+                float_cache .touch(&float_positions[i * 3], 3 * sizeof(float));
+                float_cache .touch(&float_uvs      [i * 2], 2 * sizeof(float));
+                float_cache .touch(&float_normals  [i * 3], 3 * sizeof(float));
+                packed_cache.touch(&packed[i], sizeof(Packed_Vertex));
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                glm::vec3 normal (float_normals[i * 3], float_normals[i * 3 + 1], float_normals[i * 3 + 2]);
+                glm::vec3 decoded = Packed_Vertex::decode_octahedral(glm::vec2(packed[i].normal[0], packed[i].normal[1]) / 32767.0f);
+
+                error = std::max(error, std::acos(std::min(1.0f, glm::dot(normal, decoded))) * 57.29578f);
+            }
+
+            std::printf("\nFormato de vertice (rejilla %u^2, %zu indices):\n", side, indices.size());
+            std::printf("  %-28s %5s %8s %8s %16s\n", "", "bytes", "buffers", "MB", "lineas/indice");
+            std::printf("  %-28s %5u %8u %8.1f %16.3f\n", "terreno anterior (3 x half)", 16u, 3u, count * 16.0 / 1048576.0, double(half_cache .misses) / indices.size());
+            std::printf("  %-28s %5u %8u %8.1f %16.3f\n", "cubo anterior (3 x float)",   32u, 3u, count * 32.0 / 1048576.0, double(float_cache.misses) / indices.size());
+            std::printf("  %-28s %5u %8u %8.1f %16.3f\n", "Packed_Vertex", unsigned(sizeof(Packed_Vertex)), 1u, count * double(sizeof(Packed_Vertex)) / 1048576.0, double(packed_cache.misses) / indices.size());
+            std::printf("  Error maximo de la normal octaedrica: %.4f grados\n", error);
+        }
+
+
+        void benchmark_terrain_indices()
+        {
+            const unsigned chunk_size = 16;
+            const unsigned sizes[]    = { 256, 1024 };
+
+            std::printf("\nIndices del terreno por trozos de %u^2 quads (ACMR con cache FIFO de 16 / 32 vertices):\n", chunk_size);
+
+            for (unsigned size : sizes)
+            {
+                unsigned slices = size - 1;
+
+                vector< GLuint   > list;
+                vector< GLushort > strips;
+                vector< GLuint   > strips_global;       // Las tiras con el base vertex ya sumado
+
+                for (unsigned z0 = 0; z0 < slices; z0 += chunk_size)
+                {
+                    for (unsigned x0 = 0; x0 < slices; x0 += chunk_size)
+                    {
+                        unsigned x1 = std::min(x0 + chunk_size, slices);
+                        unsigned z1 = std::min(z0 + chunk_size, slices);
+
+                        Terrain_Mesh::append_triangles(list, size, x0, z0, x1, z1);
+
+                        size_t first = strips.size();
+                        Terrain_Mesh::append_strips(strips, size, x0, z0, x1, z1, 0xFFFF);
+
+                        // Cada trozo se dibuja aparte: el final de uno corta la tira igual que el reinicio
+                        if (!strips_global.empty()) strips_global.push_back(~GLuint(0));
+
+                        for (size_t i = first; i < strips.size(); ++i)
+                        {
+                            strips_global.push_back(strips[i] == 0xFFFF ? ~GLuint(0) : strips[i] + z0 * size + x0);
+                        }
+                    }
+                }
+
+                Mesh_Statistics list_16 (list,          GL_TRIANGLES,      16);
+                Mesh_Statistics list_32 (list,          GL_TRIANGLES,      32);
+                Mesh_Statistics strip_16(strips_global, GL_TRIANGLE_STRIP, 16);
+                Mesh_Statistics strip_32(strips_global, GL_TRIANGLE_STRIP, 32);
+
+                std::printf("  %4u^2 lista 32 bits: %9zu indices %8.1f KB  ACMR %.3f / %.3f  (%zu triangulos)\n",
+                            size, list.size(), list.size() * sizeof(GLuint) / 1024.0, list_16.acmr, list_32.acmr, list_32.triangle_count);
+                std::printf("  %4u^2 tiras 16 bits: %9zu indices %8.1f KB  ACMR %.3f / %.3f  (%zu triangulos)\n",
+                            size, strips.size(), strips.size() * sizeof(GLushort) / 1024.0, strip_16.acmr, strip_32.acmr, strip_32.triangle_count);
+            }
+        }
+
+        void benchmark_mesh_optimizer()
+        {
+            const unsigned side       = 1024;
+            const unsigned chunk_size = 16;
+
+            std::printf("\nMesh_Optimizer (cache FIFO de 32 vertices):\n");
+
+            auto report = [](const char * name, const vector< GLuint > & indices, GLenum primitive)
+            {
+                Mesh_Statistics statistics(indices, primitive, 32, ~GLuint(0));
+                std::printf("  %-40s ACMR %.3f  ATVR %.3f\n", name, statistics.acmr, statistics.atvr);
+            };
+
+            // Terreno: lista por trozos sin optimizar y optimizada (como la genera Terrain)
+            vector< float > heights(size_t(side) * side);
+
+            for (size_t i = 0; i < heights.size(); ++i) heights[i] = std::sin(float(i % side) * 0.05f) * std::cos(float(i / side) * 0.03f);
+
+            vector< GLuint > plain, optimized;
+            double optimize_time = measure(1, [&]
+            {
+                optimized.clear();
+
+                for (unsigned z0 = 0; z0 + 1 < side; z0 += chunk_size)
+                {
+                    for (unsigned x0 = 0; x0 + 1 < side; x0 += chunk_size)
+                    {
+                        unsigned x1 = std::min(x0 + chunk_size, side - 1);
+                        unsigned z1 = std::min(z0 + chunk_size, side - 1);
+
+                        Terrain_Mesh::append_optimized_triangles(optimized, side, x0, z0, x1, z1, heights, 1.0f, 1.0f);
+                    }
+                }
+            });
+
+            for (unsigned z0 = 0; z0 + 1 < side; z0 += chunk_size)
+            {
+                for (unsigned x0 = 0; x0 + 1 < side; x0 += chunk_size)
+                {
+                    Terrain_Mesh::append_triangles(plain, side, x0, z0, std::min(x0 + chunk_size, side - 1), std::min(z0 + chunk_size, side - 1));
+                }
+            }
+
+            std::printf("  Terreno %u^2 por trozos de %u^2 quads (optimizar: %.1f ms)\n", side, chunk_size, optimize_time);
+            report("    lista en orden de filas", plain,     GL_TRIANGLES);
+            report("    lista optimizada",        optimized, GL_TRIANGLES);
+
+            // Cubo: antes se dibujaba sin indices (36 vertices), ahora indexado y optimizado
+            vector< Packed_Vertex > cube_vertices;
+            vector< GLushort      > cube_indices;
+
+            Cube::make_mesh(1.0f, cube_vertices, cube_indices);
+
+            vector< GLuint > draw_arrays(36);
+            for (GLuint i = 0; i < 36; ++i) draw_arrays[i] = i;
+
+            std::printf("  Cubo (%zu vertices tras unir los repetidos)\n", cube_vertices.size());
+            report("    glDrawArrays (36 vertices)",                 draw_arrays, GL_TRIANGLES);
+            report("    indexado y optimizado", vector< GLuint >(cube_indices.begin(), cube_indices.end()), GL_TRIANGLES);
+        }
+
+        void benchmark_height_queries()
+        {
+            const unsigned side  = 1025;
+            const size_t   count = 1 << 20;
+
+            vector< float > grid_heights(size_t(side) * side);
+
+            for (size_t i = 0; i < grid_heights.size(); ++i)
+            {
+                grid_heights[i] = 15.0f * std::sin(float(i % side) * 0.02f) * std::cos(float(i / side) * 0.017f);
+            }
+
+            Height_Field field(grid_heights, side, side, glm::vec2(-100.0f), glm::vec2(200.0f / (side - 1)));
+
+            vector< float > xs(count), zs(count), scalar(count), batched(count);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                xs[i] = -110.0f + 220.0f * float((i * 2654435761u) % 100003) / 100003.0f;
+                zs[i] = -110.0f + 220.0f * float((i * 40503u)      % 100019) / 100019.0f;
+            }
+
+            double scalar_time  = measure(3, [&] { for (size_t i = 0; i < count; ++i) scalar[i] = field.height_at(xs[i], zs[i]); });
+            double batched_time = measure(3, [&] { field.heights_at(xs.data(), zs.data(), batched.data(), count); });
+
+            float difference = 0.0f;
+
+            for (size_t i = 0; i < count; ++i) difference = std::max(difference, std::abs(scalar[i] - batched[i]));
+
+            // Error de la cuantizacion a 16 bits en las propias muestras
+            float quantization = 0.0f;
+
+            for (unsigned j = 0; j < side; j += 7)
+            {
+                for (unsigned i = 0; i < side; i += 7)
+                {
+                    quantization = std::max(quantization, std::abs(field.sample(i, j) - grid_heights[size_t(j) * side + i]));
+                }
+            }
+
+            std::printf("\nHeight_Field %u^2 (%.1f KB, %.1f KB en float), %zu consultas aleatorias:\n",
+                        side, field.get_memory_size() / 1024.0, grid_heights.size() * sizeof(float) / 1024.0, count);
+            std::printf("  height_at  %7.2f ms (%.1f ns por punto)\n", scalar_time,  scalar_time  * 1e6 / count);
+            std::printf("  heights_at %7.2f ms (%.1f ns por punto)  diferencia maxima %g\n", batched_time, batched_time * 1e6 / count, difference);
+            std::printf("  Error de cuantizacion: %g (rango %g)\n", quantization, field.get_max_height() - field.get_min_height());
+        }
+
+        // Rayos contra el terreno: piramide min/max frente a probar todos los triangulos
+        void benchmark_ray_casting()
+        {
+            const unsigned side        = 513;
+            const size_t   count       = 1 << 16;
+            const size_t   brute_count = 256;           // La fuerza bruta prueba 2 * 512^2 triangulos por rayo
+
+            vector< float > grid_heights(size_t(side) * side);
+
+            for (size_t i = 0; i < grid_heights.size(); ++i)
+            {
+                grid_heights[i] = 15.0f * std::sin(float(i % side) * 0.02f) * std::cos(float(i / side) * 0.017f);
+            }
+
+            Height_Field       field(grid_heights, side, side, glm::vec2(-100.0f), glm::vec2(200.0f / (side - 1)));
+            Terrain_Ray_Caster caster(field);
+
+            // Rayos desde puntos por encima del terreno, la mayoria hacia abajo y algunos casi rasantes
+            vector< Terrain_Ray_Caster::Ray > rays(count);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                float a = float((i * 2654435761u) % 100003) / 100003.0f;
+                float b = float((i * 40503u)      % 100019) / 100019.0f;
+                float c = float((i * 69069u)      % 100043) / 100043.0f;
+
+                float angle = 6.2831853f * c;
+
+                rays[i].origin       = glm::vec3(-90.0f + 180.0f * a, 20.0f + 20.0f * b, -90.0f + 180.0f * c);
+                rays[i].direction    = glm::vec3(std::cos(angle), -0.05f - 0.6f * a, std::sin(angle));
+                rays[i].max_distance = 400.0f;
+            }
+
+            vector< Terrain_Ray_Caster::Hit > hits(count), brute_hits(brute_count);
+
+            double single_time  = measure(3, [&] { for (size_t i = 0; i < count; ++i) caster.intersect(rays[i], hits[i]); });
+            double batched_time = measure(3, [&] { caster.intersect(rays.data(), hits.data(), count); });
+            double brute_time   = measure(1, [&] { for (size_t i = 0; i < brute_count; ++i) caster.intersect_brute_force(rays[i], brute_hits[i]); });
+
+            size_t mismatches = 0, hit_count = 0;
+            float  difference = 0.0f;
+
+            for (size_t i = 0; i < brute_count; ++i)
+            {
+                if (hits[i].is_hit != brute_hits[i].is_hit) { ++mismatches; continue; }
+                if (hits[i].is_hit) { ++hit_count; difference = std::max(difference, std::abs(hits[i].distance - brute_hits[i].distance)); }
+            }
+
+            std::printf("\nRayos contra terreno %u^2 (piramide min/max de %.1f KB):\n", side, caster.get_memory_size() / 1024.0);
+            std::printf("  Fuerza bruta      %9.2f ms (%8.1f us por rayo, %zu rayos)\n", brute_time, brute_time * 1e3 / brute_count, brute_count);
+            std::printf("  Piramide          %9.2f ms (%8.3f us por rayo, %zu rayos)\n", single_time, single_time * 1e3 / count, count);
+            std::printf("  Piramide por lote %9.2f ms (%8.3f us por rayo, %u hilos)\n", batched_time, batched_time * 1e3 / count, std::thread::hardware_concurrency());
+            std::printf("  Comprobacion: %zu/%zu aciertos, %zu distintos, diferencia maxima %g\n", hit_count, brute_count, mismatches, difference);
+        }
+
+        // Edicion con pincel sobre una rejilla de 1024^2: solo el rectangulo tocado frente a rehacerlo todo
+        void benchmark_terrain_editing()
+        {
+            const int      image_size = 1024;
+            const unsigned slices     = 1024;
+            const float    size       = 200.0f;
+            const float    radius     = 8.0f;
+            const unsigned strokes    = 120;
+
+            Height_Map height_map = red_channel(make_heightmap(image_size), image_size);
+
+            Terrain_Mesh       mesh(&height_map, size, size, slices, slices, 15.0f);
+            Height_Field       field(mesh.heights, slices + 1, slices + 1, glm::vec2(-size * 0.5f), glm::vec2(size / slices));
+            Terrain_Ray_Caster caster(field);
+
+            // Recalcular toda la rejilla por regiones tiene que dar los mismos vertices que el constructor
+            vector< Packed_Vertex > rebuilt(mesh.vertices.size());
+            Terrain_Mesh::build_vertices(mesh.heights, size, size, slices, slices, 0, 0, slices, slices, rebuilt.data());
+
+            bool identical = std::memcmp(rebuilt.data(), mesh.vertices.data(), rebuilt.size() * sizeof(Packed_Vertex)) == 0;
+
+            // Trazo en diagonal, como Terrain::apply_brush + Terrain::update_region (sin la subida a la GPU)
+            vector< Packed_Vertex > edited;
+            size_t   uploaded_bytes = 0;
+            unsigned rebuilds       = 0;
+            float    step           = size / slices;
+            unsigned n_verts        = slices + 1;
+
+            double edit_time = measure(1, [&]
+            {
+                for (unsigned stroke = 0; stroke < strokes; ++stroke)
+                {
+                    float cx = -60.0f + 120.0f * stroke / strokes;
+                    float cz = -40.0f +  80.0f * stroke / strokes;
+
+                    unsigned x0 = unsigned(std::ceil ((cx - radius + size * 0.5f) / step)), x1 = unsigned(std::floor((cx + radius + size * 0.5f) / step));
+                    unsigned z0 = unsigned(std::ceil ((cz - radius + size * 0.5f) / step)), z1 = unsigned(std::floor((cz + radius + size * 0.5f) / step));
+
+                    for (unsigned z = z0; z <= z1; ++z)
+                    {
+                        for (unsigned x = x0; x <= x1; ++x)
+                        {
+                            float dx = (-size * 0.5f + x * step - cx) / radius;
+                            float dz = (-size * 0.5f + z * step - cz) / radius;
+                            float d2 = dx * dx + dz * dz;
+
+                            if (d2 < 1.0f) mesh.heights[size_t(z) * n_verts + x] += 0.15f * (1.0f - d2) * (1.0f - d2);
+                        }
+                    }
+
+                    unsigned vx0 = x0 - 1, vx1 = x1 + 1, vz0 = z0 - 1, vz1 = z1 + 1;
+
+                    edited.resize(size_t(vx1 - vx0 + 1) * (vz1 - vz0 + 1));
+                    Terrain_Mesh::build_vertices(mesh.heights, size, size, slices, slices, vx0, vz0, vx1, vz1, edited.data());
+                    uploaded_bytes += edited.size() * sizeof(Packed_Vertex);
+
+                    if (field.update(mesh.heights, x0, z0, x1, z1))
+                    {
+                        caster.update(x0 - 1, z0 - 1, x1, z1);
+                    }
+                    else
+                    {
+                        float headroom = std::max(1.0f, 0.25f * (field.get_max_height() - field.get_min_height()));
+                        field  = Height_Field(mesh.heights, n_verts, n_verts, glm::vec2(-size * 0.5f), glm::vec2(step), headroom);
+                        caster = Terrain_Ray_Caster(field);
+                        ++rebuilds;
+                    }
+                }
+            });
+
+            // Lo que costaba antes cualquier cambio: rehacer la malla, las consultas y subirlo todo
+            double rebuild_time = measure(3, [&]
+            {
+                Terrain_Mesh       full(&height_map, size, size, slices, slices, 15.0f);
+                Height_Field       full_field(full.heights, n_verts, n_verts, glm::vec2(-size * 0.5f), glm::vec2(step));
+                Terrain_Ray_Caster full_caster(full_field);
+            });
+
+            std::printf("\nEdicion de terreno %u^2 (pincel de radio %.0f, %u pinceladas):\n", slices, radius, strokes);
+            std::printf("  Region     %7.3f ms por pincelada, %6.1f KB subidos (%u veces se recuantiza todo)\n",
+                        edit_time / strokes, uploaded_bytes / 1024.0 / strokes, rebuilds);
+            std::printf("  Todo       %7.3f ms por cambio,     %6.1f KB subidos\n", rebuild_time, mesh.vertices.size() * sizeof(Packed_Vertex) / 1024.0);
+            std::printf("  Vertices recalculados por regiones %s a los del constructor\n", identical ? "identicos" : "DISTINTOS");
+        }
+
+        // Precision de los heightmaps de 8 y 16 bits y float con un max_height grande
+        void benchmark_height_maps()
+        {
+            const int   size       = 1024;
+            const float max_height = 500.0f;
+
+            // Suelo suave de referencia (normalizado)
+            vector< float > ground(size_t(size) * size);
+
+            for (int y = 0; y < size; ++y)
+            {
+                for (int x = 0; x < size; ++x)
+                {
+                    ground[size_t(y) * size + x] = 0.5f + 0.25f * std::sin(x * 0.005f) * std::cos(y * 0.004f) + 0.2f * std::sin((x + y) * 0.0021f);
+                }
+            }
+
+            vector< uint8_t  > unorm8 (ground.size());
+            vector< uint16_t > unorm16(ground.size());
+
+            for (size_t i = 0; i < ground.size(); ++i)
+            {
+                unorm8 [i] = uint8_t (std::lround(ground[i] * 255.0f));
+                unorm16[i] = uint16_t(std::lround(ground[i] * 65535.0f));
+            }
+
+            const Height_Map maps[] =
+            {
+                Height_Map(size, size, Height_Map::UNORM8,  unorm8 .data()),
+                Height_Map(size, size, Height_Map::UNORM16, unorm16.data()),
+                Height_Map(size, size, Height_Map::FLOAT32, ground .data()),
+            };
+
+            const char * names[] = { "8 bits ", "16 bits", "float  " };
+
+            std::printf("\nHeightmaps %d^2 con max_height %g (RGB de 8 bits: %.0f KB):\n", size, max_height, ground.size() * 3 / 1024.0);
+
+            for (int format = 0; format < 3; ++format)
+            {
+                Terrain_Mesh mesh(&maps[format], 200.0f, 200.0f, size - 1, size - 1, max_height, false);
+
+                // Error frente al suelo continuo y numero de alturas distintas (escalones)
+                float error = 0.0f;
+
+                for (int y = 0; y < size; ++y)
+                {
+                    for (int x = 0; x < size; ++x)
+                    {
+                        error = std::max(error, std::abs(maps[format].value(x, y) - ground[size_t(y) * size + x]) * max_height);
+                    }
+                }
+
+                vector< float > levels(mesh.heights);
+                std::sort(levels.begin(), levels.end());
+
+                size_t level_count = size_t(std::unique(levels.begin(), levels.end()) - levels.begin());
+
+                std::printf("  %s %6.0f KB  error maximo %8.4f  %7zu alturas distintas\n",
+                            names[format], maps[format].get_memory_size() / 1024.0, error, level_count);
+            }
+        }
+
+        // Normales horneadas frente a las interpoladas de una malla gruesa
+        void benchmark_normal_map()
+        {
+            const int      size          = 1024;
+            const float    terrain_size  = 200.0f;
+            const float    max_height    = 15.0f;
+            const unsigned coarse_slices = 128;
+
+            Height_Map height_map = red_channel(make_heightmap(size), size);
+
+            vector< GLbyte > texels;
+
+            double bake_time = measure(3, [&] { Normal_Map::bake(height_map, terrain_size, terrain_size, max_height, texels); });
+
+            // Malla gruesa: sus normales dentro de cada celda salen de las alturas de los vertices
+            Terrain_Mesh coarse(&height_map, terrain_size, terrain_size, coarse_slices, coarse_slices, max_height, false);
+            Height_Field coarse_field(coarse.heights, coarse_slices + 1, coarse_slices + 1, glm::vec2(-terrain_size * 0.5f), glm::vec2(terrain_size / coarse_slices));
+
+            // Referencia: normal en float con diferencias centrales sobre el heightmap completo
+            float  step = terrain_size / float(size - 1);
+            double mesh_error = 0.0, map_error = 0.0;
+            size_t samples    = 0;
+
+            for (int z = 1; z < size - 1; z += 3)
+            {
+                for (int x = 1; x < size - 1; x += 3)
+                {
+                    float dh_dx = (height_map.value(x + 1, z) - height_map.value(x - 1, z)) * max_height / (2.0f * step);
+                    float dh_dz = (height_map.value(x, z + 1) - height_map.value(x, z - 1)) * max_height / (2.0f * step);
+
+                    glm::vec3 reference = glm::normalize(glm::vec3(-dh_dx, 1.0f, -dh_dz));
+                    glm::vec3 from_mesh = coarse_field.normal_at(-terrain_size * 0.5f + x * step, -terrain_size * 0.5f + z * step);
+
+                    const GLbyte * texel = &texels[(size_t(z) * size + x) * 2];
+                    glm::vec2 xz(texel[0] / 127.0f, texel[1] / 127.0f);
+                    glm::vec3 from_map = glm::normalize(glm::vec3(xz.x, std::sqrt(std::max(1.0f - glm::dot(xz, xz), 0.0f)), xz.y));
+
+                    mesh_error += std::acos(std::min(1.0f, glm::dot(reference, from_mesh)));
+                    map_error  += std::acos(std::min(1.0f, glm::dot(reference, from_map )));
+                    ++samples;
+                }
+            }
+
+            const double to_degrees = 57.29577951;
+
+            std::printf("\nNormal map %d^2 (RG8_SNORM, %.0f KB) horneado en %.2f ms:\n", size, texels.size() / 1024.0, bake_time);
+            std::printf("  Malla %u^2 con normales por vertice  %8.0f KB de normales  error medio %6.3f grados\n",
+                        coarse_slices, (coarse_slices + 1) * (coarse_slices + 1) * 4.0 / 1024.0, mesh_error / samples * to_degrees);
+            std::printf("  Malla %u^2 con normal map            %8.0f KB de normales  error medio %6.3f grados\n",
+                        coarse_slices, texels.size() / 1024.0, map_error / samples * to_degrees);
+        }
+
+        // Arranque del terreno generando la malla desde el heightmap frente a leerla de la cache
+        void benchmark_terrain_cache()
+        {
+            const int      size       = 1024;
+            const unsigned slices     = 1023;
+            const float    max_height = 15.0f;
+            const char *   path       = "benchmark-height-map.r16";
+
+            // Heightmap de 16 bits en un fichero temporal (como lo encontraria Terrain)
+            {
+                vector< unsigned char > image = make_heightmap(size);
+                vector< uint16_t >      raw(size_t(size) * size);
+
+                for (size_t i = 0; i < raw.size(); ++i) raw[i] = uint16_t(image[i * 3] * 257);
+
+                std::ofstream(path, std::ios::binary).write(reinterpret_cast< const char * >(raw.data()), raw.size() * sizeof(uint16_t));
+            }
+
+            Terrain_Cache::Key key = { Terrain_Cache::hash_file(path), 200.0f, 200.0f, max_height, slices, slices, 0 };
+            std::string cache_path = Terrain_Cache::cache_path("", path, key);
+
+            vector< float         > heights;
+            vector< Packed_Vertex > vertices;
+            vector< GLushort      > indices;
+            vector< uint16_t      > field_samples;
+            vector< unsigned char > pyramid;
+            float                   field_range[2];
+
+            // Sin cache: decodificar, generar los vertices, los indices por trozos y las consultas
+            double generate_time = measure(3, [&]
+            {
+                Height_Map   height_map(path);
+                Terrain_Mesh mesh(&height_map, 200.0f, 200.0f, slices, slices, max_height);
+
+                indices.clear();
+
+                for (unsigned z = 0; z < slices; z += 16)
+                {
+                    for (unsigned x = 0; x < slices; x += 16)
+                    {
+                        Terrain_Mesh::append_strips(indices, slices + 1, x, z, std::min(x + 16, slices), std::min(z + 16, slices), 0xFFFF);
+                    }
+                }
+
+                Height_Field       field(mesh.heights, slices + 1, slices + 1, glm::vec2(-100.0f), glm::vec2(200.0f / slices));
+                Terrain_Ray_Caster caster(field);
+
+                field_samples.assign(field.get_samples(), field.get_samples() + size_t(slices + 1) * (slices + 1));
+                field_range[0] = field.get_min_height();
+                field_range[1] = field.get_height_scale();
+                pyramid.resize(caster.get_memory_size());
+                caster.copy_pyramid(pyramid.data());
+
+                heights  = std::move(mesh.heights);
+                vertices = std::move(mesh.vertices);
+            });
+
+            double write_time = measure(1, [&]
+            {
+                Terrain_Cache::write(cache_path, key,
+                {
+                    { heights .data(), heights .size() * sizeof(float)         },
+                    { vertices.data(), vertices.size() * sizeof(Packed_Vertex) },
+                    { indices .data(), indices .size() * sizeof(GLushort)      },
+                    { field_samples.data(), field_samples.size() * sizeof(uint16_t) },
+                    { field_range,          sizeof(field_range)                     },
+                    { pyramid.data(),       pyramid.size()                          },
+                });
+            });
+
+            // Con cache: hash del fichero, proyectar la cache y leer cada seccion una vez (como la subida).
+            // Las consultas se copian ya construidas, como en Terrain::load_cache.
+            bool   identical = false;
+            double hash_time = measure(3, [&] { Terrain_Cache::hash_file(path); });
+
+            double load_time = measure(3, [&]
+            {
+                Terrain_Cache::Key loaded_key = key;
+                loaded_key.source_hash = Terrain_Cache::hash_file(path);
+
+                Terrain_Cache cache(cache_path, loaded_key);
+
+                if (!cache.is_valid()) return;
+
+                const float * cached_heights = static_cast< const float * >(cache.get_section_data(0));
+
+                vector< float >         loaded_heights (cached_heights, cached_heights + cache.get_section_size(0) / sizeof(float));
+                vector< unsigned char > uploaded_vertices(cache.get_section_size(1));
+                vector< unsigned char > uploaded_indices (cache.get_section_size(2));
+
+                std::memcpy(uploaded_vertices.data(), cache.get_section_data(1), uploaded_vertices.size());
+                std::memcpy(uploaded_indices .data(), cache.get_section_data(2), uploaded_indices .size());
+
+                const float * range = static_cast< const float * >(cache.get_section_data(4));
+
+                Height_Field       field(static_cast< const uint16_t * >(cache.get_section_data(3)), slices + 1, slices + 1,
+                                         glm::vec2(-100.0f), glm::vec2(200.0f / slices), range[0], range[1]);
+                Terrain_Ray_Caster caster(field, cache.get_section_data(5), cache.get_section_size(5));
+
+                identical = loaded_heights == heights
+                         && std::memcmp(uploaded_vertices.data(), vertices.data(), uploaded_vertices.size()) == 0
+                         && std::memcmp(uploaded_indices .data(), indices .data(), uploaded_indices .size()) == 0
+                         && std::memcmp(field.get_samples(), field_samples.data(), field_samples.size() * sizeof(uint16_t)) == 0
+                         && caster.get_memory_size() == pyramid.size();
+            });
+
+            std::remove(cache_path.c_str());
+            std::remove(path);
+
+            std::printf("\nCache de la malla del terreno %u^2 (%.0f KB):\n", slices, (heights.size() * sizeof(float) + vertices.size() * sizeof(Packed_Vertex) + indices.size() * sizeof(GLushort)) / 1024.0);
+            std::printf("  Generando  %8.2f ms (y %.2f ms para escribir la cache)\n", generate_time, write_time);
+            std::printf("  Con cache  %8.2f ms (%.2f ms de hash del heightmap), datos %s\n", load_time, hash_time, identical ? "identicos" : "DISTINTOS");
+        }
+    }
+
+    int run_benchmarks()
+    {
+        benchmark_height_maps();
+        benchmark_terrain_mesh();
+        benchmark_vertex_formats();
+        benchmark_terrain_indices();
+        benchmark_mesh_optimizer();
+        benchmark_height_queries();
+        benchmark_ray_casting();
+        benchmark_terrain_editing();
+        benchmark_normal_map();
+        benchmark_terrain_cache();
+
+        return 0;
+    }
+
+}
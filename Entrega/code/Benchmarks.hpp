@@ -0,0 +1,17 @@
+// Benchmarks.hpp
+// angel.rodriguez@udit.es
+
+#ifndef BENCHMARKS_HEADER
+#define BENCHMARKS_HEADER
+
+namespace udit
+{
+
+    // Mediciones de rendimiento que no necesitan ventana. Se lanzan con el argumento
+    // --benchmark y escriben los resultados por la salida estandar.
+
+    int run_benchmarks ();
+
+}
+
+#endif
@@ -1,5 +1,5 @@
 
-// Este cdigo es de dominio pblico
+// Este código es de dominio público
 // angel.rodriguez@udit.es
 
 #ifndef CAMERA_HEADER
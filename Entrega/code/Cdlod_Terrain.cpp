@@ -0,0 +1,317 @@
+// Cdlod_Terrain.cpp
+// angel.rodriguez@udit.es
+
+#include "Cdlod_Terrain.hpp"
+#include <half.hpp>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+using glm::vec2;
+using glm::vec3;
+using std::vector;
+using half_float::half;
+
+namespace udit
+{
+
+    namespace
+    {
+        // Fraccion del rango de cada nivel a partir de la cual empieza la transicion al siguiente
+        constexpr float morph_start_ratio = 0.66f;
+
+        bool box_intersects_sphere(const vec3& box_min, const vec3& box_max, const vec3& center, float radius)
+        {
+            vec3  closest = glm::clamp(center, box_min, box_max);
+            vec3  delta   = closest - center;
+            return glm::dot(delta, delta) <= radius * radius;
+        }
+    }
+
+    Cdlod_Terrain::Cdlod_Terrain(const Height_Map& source_map, float width, float depth, float max_height, unsigned lod_levels, unsigned grid_resolution)
+        : width(width), depth(depth), max_height(max_height),
+          lod_levels(std::max(lod_levels, 1u)),
+          grid_resolution(std::min(std::max(grid_resolution & ~1u, 2u), 128u)),   // Par y con indices de 16 bits
+          program_id(0)
+    {
+        // 1. HEIGHTMAP (un solo canal, con su precision). Si no se pudo cargar se usa uno plano
+        // para poder seguir
+        const Height_Map   flat_map(1, 1, Height_Map::UNORM8);
+        const Height_Map & height_map = source_map.is_empty() ? flat_map : source_map;
+
+        int tex_w = height_map.get_width();
+        int tex_h = height_map.get_height();
+
+        height_texture.reset(new Height_Texture(height_map));
+
+        // 2. ALTURAS MINIMA Y MAXIMA DE CADA NODO
+        // Se recorren los pixeles de cada hoja y se propagan hacia arriba juntando los cuatro hijos.
+        unsigned leaves_per_side = 1u << (this->lod_levels - 1);
+
+        node_height_bounds.resize(this->lod_levels);
+        node_height_bounds[0].resize(leaves_per_side * leaves_per_side);
+
+        for (unsigned leaf_z = 0; leaf_z < leaves_per_side; ++leaf_z)
+        {
+            for (unsigned leaf_x = 0; leaf_x < leaves_per_side; ++leaf_x)
+            {
+                int x0 = int(float(leaf_x    ) / leaves_per_side * (tex_w - 1));
+                int x1 = int(float(leaf_x + 1) / leaves_per_side * (tex_w - 1) + 0.999f);
+                int z0 = int(float(leaf_z    ) / leaves_per_side * (tex_h - 1));
+                int z1 = int(float(leaf_z + 1) / leaves_per_side * (tex_h - 1) + 0.999f);
+
+                float min_value = std::numeric_limits< float >::max(), max_value = -min_value;
+
+                for (int z = z0; z <= std::min(z1, tex_h - 1); ++z)
+                {
+                    for (int x = x0; x <= std::min(x1, tex_w - 1); ++x)
+                    {
+                        float value = height_map.value(x, z);
+                        min_value = std::min(min_value, value);
+                        max_value = std::max(max_value, value);
+                    }
+                }
+
+                node_height_bounds[0][leaf_z * leaves_per_side + leaf_x] = vec2
+                (
+                    min_value * max_height - max_height * 0.15f,
+                    max_value * max_height - max_height * 0.15f
+                );
+            }
+        }
+
+        for (unsigned lod = 1; lod < this->lod_levels; ++lod)
+        {
+            unsigned nodes_per_side = leaves_per_side >> lod;
+            const vector< vec2 >& children = node_height_bounds[lod - 1];
+
+            node_height_bounds[lod].resize(nodes_per_side * nodes_per_side);
+
+            for (unsigned z = 0; z < nodes_per_side; ++z)
+            {
+                for (unsigned x = 0; x < nodes_per_side; ++x)
+                {
+                    vec2 bounds(std::numeric_limits< float >::max(), -std::numeric_limits< float >::max());
+
+                    for (unsigned i = 0; i < 4; ++i)
+                    {
+                        const vec2& child = children[(z * 2 + (i >> 1)) * nodes_per_side * 2 + x * 2 + (i & 1)];
+                        bounds.x = std::min(bounds.x, child.x);
+                        bounds.y = std::max(bounds.y, child.y);
+                    }
+
+                    node_height_bounds[lod][z * nodes_per_side + x] = bounds;
+                }
+            }
+        }
+
+        // 3. RANGOS DE CADA NIVEL
+        // Cada nivel cubre el doble de distancia que el anterior. El ultimo cubre todo el terreno.
+        float leaf_size = std::max(width, depth) / float(leaves_per_side);
+
+        lod_ranges.resize(this->lod_levels);
+
+        for (unsigned lod = 0; lod < this->lod_levels; ++lod)
+        {
+            lod_ranges[lod] = 2.0f * leaf_size * float(1u << lod);
+        }
+
+        lod_ranges.back() = std::numeric_limits< float >::max();
+
+        // 4. PARCHE DE REJILLA COMPARTIDO
+        unsigned n_verts = this->grid_resolution + 1;
+
+        vector< half > grid;
+        grid.reserve(n_verts * n_verts * 2);
+
+        for (unsigned z = 0; z < n_verts; ++z)
+        {
+            for (unsigned x = 0; x < n_verts; ++x)
+            {
+                grid.push_back(half(float(x) / this->grid_resolution));
+                grid.push_back(half(float(z) / this->grid_resolution));
+            }
+        }
+
+        // Los indices se ordenan por cuadrantes para poder pintar solo una parte del parche
+        // cuando alguno de los hijos del nodo se dibuja con un nivel mas fino.
+        unsigned half_resolution = this->grid_resolution / 2;
+
+        vector< GLushort > indices;
+        indices.reserve(this->grid_resolution * this->grid_resolution * 6);
+
+        for (unsigned quadrant = 0; quadrant < 4; ++quadrant)
+        {
+            unsigned x0 = (quadrant & 1) * half_resolution;
+            unsigned z0 = (quadrant >> 1) * half_resolution;
+
+            for (unsigned z = z0; z < z0 + half_resolution; ++z)
+            {
+                for (unsigned x = x0; x < x0 + half_resolution; ++x)
+                {
+                    GLushort tl = GLushort((z * n_verts) + x);
+                    GLushort tr = GLushort((z * n_verts) + (x + 1));
+                    GLushort bl = GLushort(((z + 1) * n_verts) + x);
+                    GLushort br = GLushort(((z + 1) * n_verts) + (x + 1));
+
+                    indices.push_back(tl); indices.push_back(bl); indices.push_back(tr);
+                    indices.push_back(tr); indices.push_back(bl); indices.push_back(br);
+                }
+            }
+        }
+
+        quadrant_index_count = GLsizei(half_resolution * half_resolution * 6);
+
+        // --- OPENGL CONFIG ---
+        glGenVertexArrays(1, &vao_id);
+        glGenBuffers(VBO_COUNT, vbo_ids);
+
+        glBindVertexArray(vao_id);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[GRID_VBO]);
+        glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(half), grid.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_HALF_FLOAT, GL_FALSE, 0, 0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_ids[INDICES_EBO]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+    }
+
+    Cdlod_Terrain::~Cdlod_Terrain()
+    {
+        glDeleteVertexArrays(1, &vao_id);
+        glDeleteBuffers(VBO_COUNT, vbo_ids);
+    }
+
+    void Cdlod_Terrain::node_box(unsigned node_x, unsigned node_z, unsigned lod, vec3& box_min, vec3& box_max) const
+    {
+        unsigned nodes_per_side = 1u << (lod_levels - 1 - lod);
+        float    size_x = width / float(nodes_per_side);
+        float    size_z = depth / float(nodes_per_side);
+        vec2     bounds = node_height_bounds[lod][node_z * nodes_per_side + node_x];
+
+        box_min = vec3(-width * 0.5f + node_x * size_x, bounds.x, -depth * 0.5f + node_z * size_z);
+        box_max = vec3(box_min.x + size_x, bounds.y, box_min.z + size_z);
+    }
+
+    bool Cdlod_Terrain::select_node(unsigned node_x, unsigned node_z, unsigned lod, const vec3& camera_position, const Frustum& frustum)
+    {
+        vec3 box_min, box_max;
+        node_box(node_x, node_z, lod, box_min, box_max);
+
+        // Si el nodo queda fuera del rango de su nivel lo tiene que cubrir el padre
+        if (!box_intersects_sphere(box_min, box_max, camera_position, lod_ranges[lod])) return false;
+
+        // Fuera de pantalla: se da por tratado sin dibujar nada
+        if (frustum.classify(box_min, box_max) == Frustum::OUTSIDE) return true;
+
+        Selected_Node node = { box_min.x, box_min.z, box_max.x - box_min.x, box_max.z - box_min.z, lod, 0xF };
+
+        if (lod == 0 || !box_intersects_sphere(box_min, box_max, camera_position, lod_ranges[lod - 1]))
+        {
+            selection.push_back(node);
+            return true;
+        }
+
+        // Parte del nodo necesita mas detalle: se baja a los hijos y los cuadrantes que
+        // no acepten el nivel inferior se dibujan con el nivel de este nodo.
+        node.quadrant_mask = 0;
+
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            if (!select_node(node_x * 2 + (i & 1), node_z * 2 + (i >> 1), lod - 1, camera_position, frustum))
+            {
+                node.quadrant_mask |= 1u << i;
+            }
+        }
+
+        if (node.quadrant_mask) selection.push_back(node);
+
+        return true;
+    }
+
+    void Cdlod_Terrain::draw_node(Shader_Program& program, const Selected_Node& node)
+    {
+        float range_end   = lod_ranges[node.lod];
+        float range_start = node.lod > 0 ? lod_ranges[node.lod - 1] : 0.0f;
+        float morph_start = range_start + (range_end - range_start) * morph_start_ratio;
+
+        program.set(node_id, glm::vec4(node.x, node.z, node.size_x, node.size_z));
+        program.set(morph_id, glm::vec2(morph_start, range_end));
+
+        // Se juntan los cuadrantes consecutivos en una misma llamada
+        for (unsigned first = 0; first < 4; )
+        {
+            if (!(node.quadrant_mask & (1u << first))) { ++first; continue; }
+
+            unsigned last = first;
+            while (last + 1 < 4 && (node.quadrant_mask & (1u << (last + 1)))) ++last;
+
+            glDrawElements
+            (
+                GL_TRIANGLES,
+                quadrant_index_count * GLsizei(last - first + 1),
+                GL_UNSIGNED_SHORT,
+                reinterpret_cast< const void * >(size_t(first) * quadrant_index_count * sizeof(GLushort))
+            );
+
+            first = last + 1;
+        }
+    }
+
+    void Cdlod_Terrain::render(const Camera& camera, GL_State& gl_state, Shader_Program& program)
+    {
+        if (program.get_id() != program_id)
+        {
+            program_id         = program.get_id();
+            node_id            = program.get_uniform_id("u_node");
+            morph_id           = program.get_uniform_id("u_morph");
+            camera_position_id = program.get_uniform_id("u_camera_position");
+            terrain_id         = program.get_uniform_id("u_terrain");
+            height_scale_id    = program.get_uniform_id("u_height_scale");
+            grid_resolution_id = program.get_uniform_id("u_grid_resolution");
+            height_map_id      = program.get_uniform_id("u_height_map");
+        }
+
+        vec3    camera_position(camera.get_location());
+        Frustum frustum(camera.get_projection_matrix() * camera.get_transform_matrix_inverse());
+
+        selection.clear();
+
+        if (!select_node(0, 0, lod_levels - 1, camera_position, frustum))
+        {
+            selection.push_back({ -width * 0.5f, -depth * 0.5f, width, depth, lod_levels - 1, 0xF });
+        }
+
+        // Salvo la camara son constantes: Shader_Program solo los sube la primera vez
+        program.set(camera_position_id, camera_position);
+        program.set(terrain_id, glm::vec4(-width * 0.5f, -depth * 0.5f, width, depth));
+        program.set(height_scale_id, glm::vec2(max_height, -max_height * 0.15f));
+        program.set(grid_resolution_id, float(grid_resolution));
+        program.set(height_map_id, GLint(1));
+
+        height_texture->bind(gl_state, 1);
+
+        gl_state.bind_vertex_array(vao_id);
+
+        for (const auto& node : selection)
+        {
+            draw_node(program, node);
+        }
+    }
+
+    size_t Cdlod_Terrain::get_last_triangle_count() const
+    {
+        size_t quadrants = 0;
+
+        for (const auto& node : selection)
+        {
+            for (unsigned i = 0; i < 4; ++i) if (node.quadrant_mask & (1u << i)) ++quadrants;
+        }
+
+        return quadrants * size_t(quadrant_index_count) / 3;
+    }
+
+}
@@ -0,0 +1,92 @@
+// Cdlod_Terrain.hpp
+// angel.rodriguez@udit.es
+
+#ifndef CDLOD_TERRAIN_HEADER
+#define CDLOD_TERRAIN_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Camera.hpp"
+#include "Frustum.hpp"
+#include "GL_State.hpp"
+#include "Height_Map.hpp"
+#include "Height_Texture.hpp"
+#include "Shader_Program.hpp"
+
+namespace udit
+{
+
+    // Terreno con nivel de detalle continuo segun la distancia (CDLOD, Strugar 2010).
+    // Se usa un unico parche de rejilla plana que se dibuja a distintas escalas: cada nodo del
+    // quadtree seleccionado es una llamada de dibujo del mismo parche. La altura se lee de una
+    // textura en el vertex shader y los vertices se "funden" (morph) con los del nivel siguiente
+    // segun la distancia a la camara para que no haya saltos entre niveles.
+
+    class Cdlod_Terrain
+    {
+    private:
+
+        struct Selected_Node
+        {
+            float    x, z;              // Esquina del nodo en el mundo
+            float    size_x, size_z;    // Lado del nodo en el mundo
+            unsigned lod;               // Nivel de detalle con el que se dibuja (0 = el mas fino)
+            unsigned quadrant_mask;     // Cuadrantes del parche que se dibujan (bit i = cuadrante i)
+        };
+
+        enum
+        {
+            GRID_VBO,
+            INDICES_EBO,
+            VBO_COUNT
+        };
+
+    private:
+
+        GLuint   vao_id;
+        GLuint   vbo_ids[VBO_COUNT];
+        std::unique_ptr< Height_Texture > height_texture;
+
+        float    width, depth, max_height;
+        unsigned lod_levels;
+        unsigned grid_resolution;               // Quads por lado del parche
+        GLsizei  quadrant_index_count;          // Indices de cada cuadrante del parche
+
+        std::vector< float > lod_ranges;        // Distancia maxima a la que se usa cada nivel
+
+        // Alturas minima y maxima de cada nodo por nivel (nivel 0 = hojas), para las cajas:
+        std::vector< std::vector< glm::vec2 > > node_height_bounds;
+
+        std::vector< Selected_Node > selection;
+
+        GLuint   program_id;                    // Programa para el que estan buscados los uniforms
+        Shader_Program::Uniform_Id node_id, morph_id, camera_position_id, terrain_id, height_scale_id, grid_resolution_id, height_map_id;
+
+    public:
+
+        Cdlod_Terrain(const Height_Map & source_map, float width, float depth, float max_height, unsigned lod_levels = 5, unsigned grid_resolution = 32);
+       ~Cdlod_Terrain();
+
+    public:
+
+        // Selecciona los nodos segun la distancia a la camara y los dibuja con el programa indicado
+        // (que debe estar activo y haber sido enlazado con shaders/cdlod_terrain.vert)
+        void render (const Camera & camera, GL_State & gl_state, Shader_Program & program);
+
+        // Numero de triangulos enviados en el ultimo render, para comprobar que el presupuesto es estable
+        size_t get_last_triangle_count () const;
+
+    private:
+
+        bool select_node (unsigned node_x, unsigned node_z, unsigned lod, const glm::vec3 & camera_position, const Frustum & frustum);
+        void node_box    (unsigned node_x, unsigned node_z, unsigned lod, glm::vec3 & box_min, glm::vec3 & box_max) const;
+        void draw_node   (Shader_Program & program, const Selected_Node & node);
+
+    };
+
+}
+
+#endif
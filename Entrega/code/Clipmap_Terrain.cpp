@@ -0,0 +1,300 @@
+// Clipmap_Terrain.cpp
+// angel.rodriguez@udit.es
+
+#include "Clipmap_Terrain.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using std::vector;
+using half_float::half;
+
+namespace udit
+{
+
+    namespace
+    {
+        int positive_modulo(long long value, int modulus)
+        {
+            int result = int(value % modulus);
+            return result < 0 ? result + modulus : result;
+        }
+    }
+
+    Clipmap_Terrain::Clipmap_Terrain(const std::string& height_database_path, float tile_width, float max_height, unsigned level_count, unsigned grid_resolution)
+        : max_height(max_height), database(height_database_path), streamer(database), program_id(0)
+    {
+        // La resolucion tiene que ser potencia de 2 (el hueco de cada anillo mide la mitad y
+        // se desplaza en pasos de una muestra) y caber en indices de 16 bits
+        this->grid_resolution = 8;
+        while (this->grid_resolution * 2 <= std::min(grid_resolution, 128u)) this->grid_resolution *= 2;
+
+        level_size = this->grid_resolution + 1;
+
+        // 1. BASE DE DATOS DE ALTURAS (solo se proyecta: no se lee nada hasta que hace falta)
+        if (!database.is_open())
+        {
+            std::cerr << "ERROR: No se pudo abrir " << height_database_path << std::endl;
+        }
+
+        unsigned source_width = database.is_open() ? database.get_width() : 1;
+
+        // Una muestra del nivel 0 por muestra de la base de datos, que ocupa tile_width unidades
+        sample_spacing = tile_width / float(source_width);
+        texture_scale  = 1.0f / tile_width;
+
+        levels.assign(std::max(level_count, 1u), Level{ 0, 0, false });
+        origins.resize(levels.size());
+
+        // 2. TEXTURA ARRAY DE ALTURAS (una capa por nivel, en half)
+        glGenTextures(1, &height_texture_id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, height_texture_id);
+
+        // GL_REPEAT hace el direccionamiento toroidal: la muestra i vive en el texel i % level_size
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R16F, level_size, level_size, GLsizei(levels.size()), 0, GL_RED, GL_HALF_FLOAT, nullptr);
+
+        // 3. REJILLA COMPARTIDA (coordenadas enteras de muestra codificadas en half)
+        vector< half > grid;
+        grid.reserve(level_size * level_size * 2);
+
+        for (unsigned z = 0; z < level_size; ++z)
+        {
+            for (unsigned x = 0; x < level_size; ++x)
+            {
+                grid.push_back(half(float(x)));
+                grid.push_back(half(float(z)));
+            }
+        }
+
+        // 4. INDICES: la rejilla completa para el nivel 0 y cuatro anillos para el resto.
+        // El hueco de un anillo es la zona que cubre el nivel anterior; segun como haya
+        // ajustado cada nivel su origen, cae una muestra mas a la derecha y/o abajo.
+        vector< GLushort > indices;
+        unsigned quarter = this->grid_resolution / 4;
+        unsigned hole    = this->grid_resolution / 2;
+
+        auto add_quads = [&](int hole_x, int hole_z)
+        {
+            for (unsigned z = 0; z < this->grid_resolution; ++z)
+            {
+                for (unsigned x = 0; x < this->grid_resolution; ++x)
+                {
+                    if (hole_x >= 0 && int(x) >= hole_x && int(x) < hole_x + int(hole) && int(z) >= hole_z && int(z) < hole_z + int(hole)) continue;
+
+                    GLushort tl = GLushort((z * level_size) + x);
+                    GLushort tr = GLushort((z * level_size) + (x + 1));
+                    GLushort bl = GLushort(((z + 1) * level_size) + x);
+                    GLushort br = GLushort(((z + 1) * level_size) + (x + 1));
+
+                    indices.push_back(tl); indices.push_back(bl); indices.push_back(tr);
+                    indices.push_back(tr); indices.push_back(bl); indices.push_back(br);
+                }
+            }
+        };
+
+        add_quads(-1, -1);
+        full_grid_index_count = GLsizei(indices.size());
+
+        for (unsigned variant = 0; variant < 4; ++variant)
+        {
+            add_quads(int(quarter + (variant & 1)), int(quarter + (variant >> 1)));
+        }
+
+        ring_index_count = GLsizei(indices.size() - full_grid_index_count) / 4;
+
+        // --- OPENGL CONFIG ---
+        glGenVertexArrays(1, &vao_id);
+        glGenBuffers(VBO_COUNT, vbo_ids);
+
+        glBindVertexArray(vao_id);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[GRID_VBO]);
+        glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(half), grid.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_HALF_FLOAT, GL_FALSE, 0, 0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_ids[INDICES_EBO]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+    }
+
+    Clipmap_Terrain::~Clipmap_Terrain()
+    {
+        glDeleteVertexArrays(1, &vao_id);
+        glDeleteBuffers(VBO_COUNT, vbo_ids);
+        glDeleteTextures(1, &height_texture_id);
+    }
+
+    float Clipmap_Terrain::sample_source(long long x, long long z)
+    {
+        if (!database.is_open()) return -max_height * 0.15f;
+
+        unsigned tile_size = database.get_tile_size();
+        unsigned sample_x  = unsigned(positive_modulo(x, int(database.get_width ())));
+        unsigned sample_z  = unsigned(positive_modulo(z, int(database.get_height())));
+        unsigned tile_x    = sample_x / tile_size;
+        unsigned tile_z    = sample_z / tile_size;
+
+        if (!last_tile || last_tile->tile_x != tile_x || last_tile->tile_z != tile_z)
+        {
+            last_tile = streamer.get_tile(tile_x, tile_z);
+        }
+
+        // Si el hilo aun no ha traido el tile (o esta lejos de la camara, como en los niveles
+        // gruesos) se lee directamente del fichero proyectado
+        uint16_t value = last_tile
+            ? last_tile->heights[(sample_z % tile_size) * tile_size + (sample_x % tile_size)]
+            : database.sample(sample_x, sample_z);
+
+        return value / 65535.0f * max_height - max_height * 0.15f;
+    }
+
+    void Clipmap_Terrain::upload_region(unsigned level, int x0, int z0, int x1, int z1)
+    {
+        // La region (en muestras del nivel, extremo final excluido) se parte por donde da la
+        // vuelta la textura, como mucho en cuatro rectangulos
+        int size = int(level_size);
+
+        for (int z = z0; z < z1; )
+        {
+            int texel_z = positive_modulo(z, size);
+            int rows    = std::min(z1 - z, size - texel_z);
+
+            for (int x = x0; x < x1; )
+            {
+                int texel_x = positive_modulo(x, size);
+                int columns = std::min(x1 - x, size - texel_x);
+
+                upload_buffer.resize(size_t(rows) * columns);
+
+                for (int row = 0; row < rows; ++row)
+                {
+                    for (int column = 0; column < columns; ++column)
+                    {
+                        upload_buffer[size_t(row) * columns + column] = half(sample_source
+                        (
+                            (long long)(x + column) << level,
+                            (long long)(z + row   ) << level
+                        ));
+                    }
+                }
+
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, texel_x, texel_z, GLint(level), columns, rows, 1, GL_RED, GL_HALF_FLOAT, upload_buffer.data());
+
+                x += columns;
+            }
+
+            z += rows;
+        }
+    }
+
+    void Clipmap_Terrain::update_level(unsigned level, int origin_x, int origin_z)
+    {
+        Level& current = levels[level];
+        int    size    = int(level_size);
+
+        if (current.is_loaded && current.origin_x == origin_x && current.origin_z == origin_z) return;
+
+        int delta_x = origin_x - current.origin_x;
+        int delta_z = origin_z - current.origin_z;
+
+        if (!current.is_loaded || std::abs(delta_x) >= size || std::abs(delta_z) >= size)
+        {
+            upload_region(level, origin_x, origin_z, origin_x + size, origin_z + size);
+        }
+        else
+        {
+            // Solo las columnas y filas que acaban de entrar en el nivel
+            if (delta_x > 0) upload_region(level, current.origin_x + size, origin_z, origin_x + size, origin_z + size);
+            if (delta_x < 0) upload_region(level, origin_x, origin_z, current.origin_x, origin_z + size);
+            if (delta_z > 0) upload_region(level, origin_x, current.origin_z + size, origin_x + size, origin_z + size);
+            if (delta_z < 0) upload_region(level, origin_x, origin_z, origin_x + size, current.origin_z);
+        }
+
+        current.origin_x  = origin_x;
+        current.origin_z  = origin_z;
+        current.is_loaded = true;
+    }
+
+    void Clipmap_Terrain::render(const Camera& camera, GL_State& gl_state, Shader_Program& program)
+    {
+        if (program.get_id() != program_id)
+        {
+            program_id         = program.get_id();
+            level_id           = program.get_uniform_id("u_level");
+            level_count_id     = program.get_uniform_id("u_level_count");
+            level_origin_id    = program.get_uniform_id("u_level_origin");
+            level_spacing_id   = program.get_uniform_id("u_level_spacing");
+            grid_resolution_id = program.get_uniform_id("u_grid_resolution");
+            texture_scale_id   = program.get_uniform_id("u_texture_scale");
+            height_map_id      = program.get_uniform_id("u_height_map");
+        }
+
+        // Las subidas de update_level van a la textura de la unidad activa, que bind_texture no
+        // cambia si la textura ya estaba en la unidad 1
+        gl_state.bind_texture      (1, GL_TEXTURE_2D_ARRAY, height_texture_id);
+        gl_state.set_active_texture(1);
+
+        // El streamer mantiene cargados los tiles que rodean a la camara
+        streamer.set_focus
+        (
+            (long long)std::floor(camera.get_location().x / sample_spacing),
+            (long long)std::floor(camera.get_location().z / sample_spacing)
+        );
+
+        // Cada nivel se centra en la camara con su origen en una muestra par, asi cae
+        // exactamente sobre la rejilla del nivel siguiente
+        int half_resolution = int(grid_resolution / 2);
+
+        for (unsigned level = 0; level < levels.size(); ++level)
+        {
+            float spacing = sample_spacing * float(1u << level);
+
+            origins[level].x = 2 * int(std::floor(camera.get_location().x / (2.0f * spacing))) - half_resolution;
+            origins[level].y = 2 * int(std::floor(camera.get_location().z / (2.0f * spacing))) - half_resolution;
+
+            update_level(level, origins[level].x, origins[level].y);
+        }
+
+        // Son constantes: Shader_Program solo los sube la primera vez
+        program.set(level_count_id, GLint(levels.size()));
+        program.set(grid_resolution_id, float(grid_resolution));
+        program.set(texture_scale_id, texture_scale);
+        program.set(height_map_id, GLint(1));
+
+        gl_state.bind_vertex_array(vao_id);
+
+        for (unsigned level = 0; level < levels.size(); ++level)
+        {
+            program.set(level_id, GLint(level));
+            program.set(level_origin_id, glm::vec2(float(origins[level].x), float(origins[level].y)));
+            program.set(level_spacing_id, sample_spacing * float(1u << level));
+
+            if (level == 0)
+            {
+                glDrawElements(GL_TRIANGLES, full_grid_index_count, GL_UNSIGNED_SHORT, 0);
+            }
+            else
+            {
+                // Posicion del hueco (el nivel anterior) dentro de este nivel
+                int offset_x = origins[level - 1].x / 2 - origins[level].x - int(grid_resolution / 4);
+                int offset_z = origins[level - 1].y / 2 - origins[level].y - int(grid_resolution / 4);
+                int variant  = offset_x + offset_z * 2;
+
+                glDrawElements
+                (
+                    GL_TRIANGLES,
+                    ring_index_count,
+                    GL_UNSIGNED_SHORT,
+                    reinterpret_cast< const void * >((size_t(full_grid_index_count) + size_t(variant) * ring_index_count) * sizeof(GLushort))
+                );
+            }
+        }
+    }
+
+}
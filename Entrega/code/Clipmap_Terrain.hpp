@@ -0,0 +1,99 @@
+// Clipmap_Terrain.hpp
+// angel.rodriguez@udit.es
+
+#ifndef CLIPMAP_TERRAIN_HEADER
+#define CLIPMAP_TERRAIN_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <half.hpp>
+#include <string>
+#include <vector>
+#include "Camera.hpp"
+#include "GL_State.hpp"
+#include "Height_Database.hpp"
+#include "Shader_Program.hpp"
+#include "Tile_Streamer.hpp"
+
+namespace udit
+{
+
+    // Terreno con geometry clipmaps (Losasso & Hoppe 2004). Hay varios niveles de rejilla del
+    // mismo tamano centrados en la camara; cada nivel separa sus muestras el doble que el anterior.
+    // Las alturas de cada nivel viven en una capa de una textura array que se actualiza de forma
+    // toroidal: al moverse la camara solo se suben las filas y columnas que entran en el nivel.
+    // La memoria no depende del tamano del mundo, que aqui es la base de datos de alturas
+    // repetida sin fin. Las alturas cercanas las trae un Tile_Streamer en segundo plano.
+
+    class Clipmap_Terrain
+    {
+    private:
+
+        enum
+        {
+            GRID_VBO,
+            INDICES_EBO,
+            VBO_COUNT
+        };
+
+        struct Level
+        {
+            int  origin_x, origin_z;        // Primera muestra (en unidades del nivel) guardada en la textura
+            bool is_loaded;
+        };
+
+    private:
+
+        GLuint   vao_id;
+        GLuint   vbo_ids[VBO_COUNT];
+        GLuint   height_texture_id;             // GL_TEXTURE_2D_ARRAY con una capa por nivel
+
+        unsigned grid_resolution;               // Quads por lado de cada nivel (potencia de 2)
+        unsigned level_size;                    // Muestras por lado = grid_resolution + 1
+        float    sample_spacing;                // Separacion de las muestras del nivel 0 en el mundo
+        float    max_height;
+
+        std::vector< Level > levels;
+        std::vector< glm::ivec2 > origins;      // Origen de cada nivel en el frame actual (se reserva una vez)
+
+        // Alturas de origen (proyectadas en memoria) que se repiten para formar un mundo infinito
+        Height_Database database;
+        Tile_Streamer   streamer;
+        std::shared_ptr< const Tile_Streamer::Tile > last_tile;    // Ultimo tile consultado
+
+        GLsizei  full_grid_index_count;         // Rejilla completa (nivel 0)
+        GLsizei  ring_index_count;              // Cada una de las 4 variantes de anillo
+
+        std::vector< half_float::half > upload_buffer;     // Alturas de la region que se sube
+
+        GLuint   program_id;                    // Programa para el que estan buscados los uniforms
+        Shader_Program::Uniform_Id level_id, level_count_id, level_origin_id, level_spacing_id, grid_resolution_id, texture_scale_id, height_map_id;
+        float    texture_scale;                 // Repeticiones de la textura del suelo por unidad de mundo
+
+    public:
+
+        Clipmap_Terrain(const std::string & height_database_path, float tile_width, float max_height, unsigned level_count = 8, unsigned grid_resolution = 64);
+       ~Clipmap_Terrain();
+
+    private:
+
+        Clipmap_Terrain(const Clipmap_Terrain & ) = delete;
+        Clipmap_Terrain & operator = (const Clipmap_Terrain & ) = delete;
+
+    public:
+
+        // Recentra los niveles en la camara, sube las zonas nuevas y dibuja los anillos con el
+        // programa indicado (que debe estar activo y enlazado con shaders/clipmap_terrain.vert)
+        void render (const Camera & camera, GL_State & gl_state, Shader_Program & program);
+
+    private:
+
+        float sample_source (long long x, long long z);
+        void  update_level  (unsigned level, int origin_x, int origin_z);
+        void  upload_region (unsigned level, int x0, int z0, int x1, int z1);
+
+    };
+
+}
+
+#endif
@@ -2,22 +2,23 @@
 // angel.rodriguez@udit.es
 
 #include "Cube.hpp"
+#include "Mesh_Optimizer.hpp"
 #include <vector>
 
 namespace udit
 {
-    Cube::Cube(float size)
+    void Cube::make_mesh(float size, std::vector<Packed_Vertex>& packed, std::vector<GLushort>& indices)
     {
         float s = size * 0.5f;
 
-        // Cada vrtice tiene 8 nmeros: X, Y, Z (Posicin) | U, V (Textura) | NX, NY, NZ (Normal)
+        // Cada vértice tiene 8 números: X, Y, Z (Posición) | U, V (Textura) | NX, NY, NZ (Normal)
         float vertices[] = {
             // --- CARA FRONTAL (Apunta hacia +Z) ---
-            // Posicin(xyz) | Textura(uv) | Normal(xyz)
+            // Posición(xyz) | Textura(uv) | Normal(xyz)
             -s, -s,  s,  0, 0,  0, 0, 1, // Abajo-Izq
              s, -s,  s,  1, 0,  0, 0, 1, // Abajo-Der
              s,  s,  s,  1, 1,  0, 0, 1, // Arriba-Der
-            -s, -s,  s,  0, 0,  0, 0, 1, // Abajo-Izq (Repetido para cerrar tringulo)
+            -s, -s,  s,  0, 0,  0, 0, 1, // Abajo-Izq (Repetido para cerrar triángulo)
              s,  s,  s,  1, 1,  0, 0, 1, // Arriba-Der
             -s,  s,  s,  0, 1,  0, 0, 1, // Arriba-Izq
 
@@ -62,60 +63,66 @@ namespace udit
               -s, -s,  s,  0, 1,  0,-1, 0,
         };
 
-        vertex_count = 36; // 6 caras * 2 tringulos * 3 vrtices
-
-        // Separamos el array gigante 'vertices' en 3 vectores organizados
-        // Esto facilita enviarlos a OpenGL por separado.
-        std::vector<float> pos, uvs, norm;
+        // Empaquetamos cada vértice en el formato entrelazado de 16 bytes (en lugar de 32 bytes
+        // repartidos en 3 buffers): posición en half, UV en unorm16 y normal octaédrica.
+        packed.resize(36);
         for (int i = 0; i < 36; ++i) {
-            int base = i * 8; // Cada vrtice ocupa 8 huecos en el array original
-            // 3 floats para posicin
-            pos.push_back(vertices[base + 0]); pos.push_back(vertices[base + 1]); pos.push_back(vertices[base + 2]);
-            // 2 floats para UVs
-            uvs.push_back(vertices[base + 3]); uvs.push_back(vertices[base + 4]);
-            // 3 floats para normales
-            norm.push_back(vertices[base + 5]); norm.push_back(vertices[base + 6]); norm.push_back(vertices[base + 7]);
+            const float* v = vertices + i * 8; // Cada vértice ocupa 8 huecos en el array original
+            packed[i].set(glm::vec3(v[0], v[1], v[2]), glm::vec2(v[3], v[4]), glm::vec3(v[5], v[6], v[7]));
+        }
+
+        // Los vértices repetidos (las esquinas compartidas por los 2 triángulos de cada cara) se
+        // unen y se pasa a dibujar con índices: 24 vértices en lugar de 36, optimizados para la caché.
+        std::vector<GLuint> welded = Mesh_Optimizer::weld_vertices(packed);
+
+        std::vector<glm::vec3> positions;
+        for (const Packed_Vertex& vertex : packed) {
+            positions.push_back(glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]));
         }
 
+        Mesh_Optimizer::optimize_vertex_cache(welded, packed.size());
+        Mesh_Optimizer::optimize_overdraw(welded, positions);
+        Mesh_Optimizer::optimize_vertex_fetch(welded, packed);
+
+        indices.assign(welded.begin(), welded.end());
+    }
+
+    Cube::Cube(float size)
+    {
+        std::vector<Packed_Vertex> packed;
+        std::vector<GLushort> indices;
+
+        make_mesh(size, packed, indices);
+
+        index_count = (GLsizei)indices.size(); // 6 caras * 2 triángulos * 3 vértices
+
         // Generamos los identificadores de OpenGL
         glGenVertexArrays(1, &vao_id);
-        glGenBuffers(3, vbo_ids);
+        glGenBuffers(1, &vbo_id);
+        glGenBuffers(1, &ebo_id);
 
-        // Activamos el VAO para empezar a "grabar" la configuracin
+        // Activamos el VAO para empezar a "grabar" la configuración
         glBindVertexArray(vao_id);
 
-        // 1. Configuramos el Buffer de POSICIONES (Location 0 en el shader)
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[0]);
-        glBufferData(GL_ARRAY_BUFFER, pos.size() * sizeof(float), pos.data(), GL_STATIC_DRAW);
-        // Le decimos a OpenGL: "En el canal 0, lee grupos de 3 floats"
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(0);
-
-        // 2. Configuramos el Buffer de TEXTURAS UV (Location 1 en el shader)
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[1]);
-        glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(float), uvs.data(), GL_STATIC_DRAW);
-        // Le decimos: "En el canal 1, lee grupos de 2 floats"
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(1);
-
-        // 3. Configuramos el Buffer de NORMALES (Location 2 en el shader)
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[2]);
-        glBufferData(GL_ARRAY_BUFFER, norm.size() * sizeof(float), norm.data(), GL_STATIC_DRAW);
-        // Le decimos: "En el canal 2, lee grupos de 3 floats"
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(2);
+        // Un solo buffer con todos los atributos seguidos. Los canales 0 (posición), 1 (UV)
+        // y 2 (normal) leen de él con un desplazamiento distinto dentro de cada vértice.
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(Packed_Vertex), packed.data(), GL_STATIC_DRAW);
+        Packed_Vertex::enable_attributes();
+
+        // Y el buffer de índices (queda guardado en el VAO)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_id);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
     }
 
     Cube::~Cube() {
         // Borramos buffers y VAO de la GPU al destruir el objeto
         glDeleteVertexArrays(1, &vao_id);
-        glDeleteBuffers(3, vbo_ids);
+        glDeleteBuffers(1, &vbo_id);
+        glDeleteBuffers(1, &ebo_id);
     }
 
-    void Cube::render() {
-        // Para dibujar, solo hay que activar el VAO (que ya recuerda la config)
-        glBindVertexArray(vao_id);
-        // Y mandar dibujar los tringulos
-        glDrawArrays(GL_TRIANGLES, 0, vertex_count);
+    void Cube::draw() {
+        glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, 0);
     }
 }
\ No newline at end of file
@@ -6,32 +6,41 @@
 
 #include <glad/gl.h>
 #include <vector>
+#include "Packed_Vertex.hpp"
 
 namespace udit
 {
     class Cube
     {
     private:
-        // ID del "Vertex Array Object". Es el 'archivador' que guarda la configuracin
-        // de cmo estn organizados los vrtices en la memoria de la tarjeta grfica.
+        // ID del "Vertex Array Object". Es el 'archivador' que guarda la configuración
+        // de cómo están organizados los vértices en la memoria de la tarjeta gráfica.
         GLuint vao_id;
 
-        // IDs de los "Vertex Buffer Objects". Son los buffers de datos crudos.
-        // Usamos 3: uno para posiciones (0), uno para coordenadas de textura (1) y otro para normales (2).
-        GLuint vbo_ids[3];
+        // ID del "Vertex Buffer Object" con los datos crudos. Es uno solo con los vértices
+        // entrelazados (ver Packed_Vertex): posición (0), coordenadas de textura (1) y normal (2).
+        GLuint vbo_id;
 
-        // Cantidad total de vrtices a dibujar (36 para un cubo hecho de tringulos).
-        GLsizei vertex_count;
+        // ID del buffer de índices (los vértices repetidos se unen al crear el cubo).
+        GLuint ebo_id;
+
+        // Cantidad total de índices a dibujar (36 para un cubo hecho de triángulos).
+        GLsizei index_count;
 
     public:
-        // Constructor: Recibe el tamao (lado) del cubo
+        // Constructor: Recibe el tamaño (lado) del cubo
         Cube(float size);
 
-        // Destructor: Limpia la memoria de la grfica al borrar el objeto
+        // Destructor: Limpia la memoria de la gráfica al borrar el objeto
         ~Cube();
 
-        // Funcin que manda la orden de dibujo a OpenGL
-        void render();
+        // Función que manda la orden de dibujo a OpenGL con el VAO ya activo (lo activa la cola
+        // de render a través de GL_State, y solo cuando cambia)
+        GLuint get_vao_id() const { return vao_id; }
+        void draw();
+
+        // Genera los vértices e índices del cubo ya optimizados (sin tocar OpenGL)
+        static void make_mesh(float size, std::vector<Packed_Vertex>& vertices, std::vector<GLushort>& indices);
     };
 }
 
@@ -0,0 +1,48 @@
+// File_System.cpp
+// angel.rodriguez@udit.es
+
+#include "File_System.hpp"
+#include <SDL3/SDL_filesystem.h>
+#include <cstdio>
+
+namespace udit
+{
+
+    bool create_parent_directory(const std::string & file_path)
+    {
+        size_t separator = file_path.find_last_of("/\\");
+
+        // Sin directorio: el fichero va al directorio de trabajo, que ya existe
+        if (separator == std::string::npos || separator == 0) return true;
+
+        return SDL_CreateDirectory(file_path.substr(0, separator).c_str());
+    }
+
+    bool replace_file(const std::string & temporary_path, const std::string & path)
+    {
+        // std::rename no sustituye un fichero existente en Windows
+        std::remove(path.c_str());
+
+        if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporary_path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string file_stem(const std::string & path)
+    {
+        size_t start = path.find_last_of("/\\");
+
+        start = start == std::string::npos ? 0 : start + 1;
+
+        size_t end = path.find_last_of('.');
+
+        if (end == std::string::npos || end < start) end = path.size();
+
+        return path.substr(start, end - start);
+    }
+
+}
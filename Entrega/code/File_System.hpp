@@ -0,0 +1,30 @@
+// File_System.hpp
+// angel.rodriguez@udit.es
+
+#ifndef FILE_SYSTEM_HEADER
+#define FILE_SYSTEM_HEADER
+
+#include <string>
+
+namespace udit
+{
+
+    // Operaciones con ficheros que comparten las caches en disco (programas, mallas de terreno y
+    // bases de datos de alturas).
+
+    // Crea el directorio en el que va el fichero (y los que falten por encima). Devuelve true si
+    // ya existia o se ha podido crear.
+    bool create_parent_directory (const std::string & file_path);
+
+    // Sustituye path por temporary_path, que ya se ha escrito entero. Asi nunca queda un fichero
+    // a medias con el nombre definitivo si el programa se cierra mientras escribe. Si no se puede
+    // renombrar se borra el temporal y devuelve false.
+    bool replace_file (const std::string & temporary_path, const std::string & path);
+
+    // Nombre del fichero sin el directorio ni la extension ("../assets/height-map.png" da
+    // "height-map"), para nombrar en la cache lo que se genera a partir de el.
+    std::string file_stem (const std::string & path);
+
+}
+
+#endif
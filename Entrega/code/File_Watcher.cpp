@@ -0,0 +1,126 @@
+// File_Watcher.cpp
+// angel.rodriguez@udit.es
+
+#include "File_Watcher.hpp"
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace udit
+{
+
+    namespace
+    {
+        long long modification_time(const std::string & path)
+        {
+            struct stat file_status;
+
+            return stat(path.c_str(), &file_status) == 0 ? static_cast< long long >(file_status.st_mtime) : -1;
+        }
+
+        void add_once(std::vector< std::string > & paths, const std::string & path)
+        {
+            if (std::find(paths.begin(), paths.end(), path) == paths.end()) paths.push_back(path);
+        }
+    }
+
+    File_Watcher::File_Watcher()
+    {
+    #ifdef __linux__
+        inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    #endif
+    }
+
+    File_Watcher::~File_Watcher()
+    {
+    #ifdef __linux__
+        if (inotify_descriptor >= 0) close(inotify_descriptor);
+    #endif
+    }
+
+    void File_Watcher::add(const std::string & path)
+    {
+        for (const Watched_File & file : files)
+        {
+            if (file.path == path) return;
+        }
+
+        size_t separator = path.find_last_of("/\\");
+
+        Watched_File file;
+        file.path              = path;
+        file.name              = separator == std::string::npos ? path : path.substr(separator + 1);
+        file.modification_time = modification_time(path);
+        file.watch_descriptor  = -1;
+
+    #ifdef __linux__
+        if (inotify_descriptor >= 0)
+        {
+            // Se vigila el directorio y no el fichero: al guardar, muchos editores escriben otro
+            // fichero y lo renombran, y la vigilancia de un fichero se pierde con el original.
+            // inotify devuelve el mismo descriptor si el directorio ya estaba vigilado.
+            std::string directory = separator == std::string::npos ? std::string(".") : path.substr(0, separator + 1);
+
+            file.watch_descriptor = inotify_add_watch(inotify_descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        }
+    #endif
+
+        files.push_back(file);
+    }
+
+    std::vector< std::string > File_Watcher::poll()
+    {
+        std::vector< std::string > changed;
+
+    #ifdef __linux__
+        if (inotify_descriptor >= 0)
+        {
+            alignas(inotify_event) char buffer[4096];
+
+            for (;;)
+            {
+                ssize_t length = read(inotify_descriptor, buffer, sizeof(buffer));
+
+                if (length <= 0) break;                 // EAGAIN: no quedan eventos
+
+                for (ssize_t offset = 0; offset < length; )
+                {
+                    const inotify_event * event = reinterpret_cast< const inotify_event * >(buffer + offset);
+
+                    if (event->len > 0)
+                    {
+                        for (const Watched_File & file : files)
+                        {
+                            if (file.watch_descriptor == event->wd && file.name == event->name) add_once(changed, file.path);
+                        }
+                    }
+
+                    offset += ssize_t(sizeof(inotify_event) + event->len);
+                }
+            }
+        }
+    #endif
+
+        // Sin inotify (o si no se pudo vigilar el directorio) se compara la fecha de modificacion
+        for (Watched_File & file : files)
+        {
+            if (file.watch_descriptor >= 0) continue;
+
+            long long time = modification_time(file.path);
+
+            if (time != file.modification_time)
+            {
+                file.modification_time = time;
+                add_once(changed, file.path);
+            }
+        }
+
+        return changed;
+    }
+
+}
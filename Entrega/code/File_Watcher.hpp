@@ -0,0 +1,63 @@
+// File_Watcher.hpp
+// angel.rodriguez@udit.es
+
+#ifndef FILE_WATCHER_HEADER
+#define FILE_WATCHER_HEADER
+
+#include <string>
+#include <vector>
+
+namespace udit
+{
+
+    // Avisa de los ficheros que se han modificado desde la ultima consulta, sin bloquear (se
+    // consulta una vez por frame).
+    //
+    // En Linux se usa inotify sobre los directorios de los ficheros: solo se avisa cuando el
+    // fichero se cierra tras escribirlo o cuando se renombra encima otro (lo que hacen muchos
+    // editores al guardar), asi que nunca se lee un fichero a medio escribir. En el resto de
+    // sistemas, o si inotify no esta disponible, se compara la fecha de modificacion.
+
+    class File_Watcher
+    {
+    private:
+
+        struct Watched_File
+        {
+            std::string path;                   // Tal como se paso a add (es lo que devuelve poll)
+            std::string name;                   // Sin el directorio
+            long long   modification_time;
+            int         watch_descriptor;       // Del directorio en inotify (-1 = sin inotify)
+        };
+
+    private:
+
+        std::vector< Watched_File > files;
+
+    #ifdef __linux__
+        int inotify_descriptor;
+    #endif
+
+    public:
+
+        File_Watcher();
+       ~File_Watcher();
+
+    private:
+
+        File_Watcher(const File_Watcher & ) = delete;
+        File_Watcher & operator = (const File_Watcher & ) = delete;
+
+    public:
+
+        // Empieza a vigilar el fichero (no hace nada si ya se vigilaba)
+        void add (const std::string & path);
+
+        // Ficheros modificados desde la llamada anterior, cada uno una sola vez
+        std::vector< std::string > poll ();
+
+    };
+
+}
+
+#endif
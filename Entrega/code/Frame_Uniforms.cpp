@@ -0,0 +1,44 @@
+// Frame_Uniforms.cpp
+// angel.rodriguez@udit.es
+
+#include "Frame_Uniforms.hpp"
+
+namespace udit
+{
+
+    static_assert(sizeof(Frame_Uniforms::Data) == 3 * 64 + 4 * 16, "Frame_Uniforms::Data no coincide con el layout std140");
+
+    Frame_Uniforms::Frame_Uniforms()
+    {
+        glGenBuffers    (1, &buffer_id);
+        glBindBuffer    (GL_UNIFORM_BUFFER, buffer_id);
+        glBufferData    (GL_UNIFORM_BUFFER, sizeof(Data), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding_point, buffer_id);
+    }
+
+    Frame_Uniforms::~Frame_Uniforms()
+    {
+        glDeleteBuffers (1, &buffer_id);
+    }
+
+    void Frame_Uniforms::update(const Data & data)
+    {
+        // Se pide memoria nueva con los datos en lugar de sobrescribir la anterior: el driver no
+        // tiene que esperar a que la GPU termine el frame previo que aun puede estar leyendola
+        glBindBuffer (GL_UNIFORM_BUFFER, buffer_id);
+        glBufferData (GL_UNIFORM_BUFFER, sizeof(Data), &data, GL_DYNAMIC_DRAW);
+    }
+
+    void Frame_Uniforms::bind_block(GLuint program_id)
+    {
+        if (program_id == 0) return;                    // Programa que no se pudo compilar
+
+        GLuint block_index = glGetUniformBlockIndex (program_id, "Frame_Uniforms");
+
+        if (block_index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding (program_id, block_index, binding_point);
+        }
+    }
+
+}
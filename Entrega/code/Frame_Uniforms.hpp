@@ -0,0 +1,64 @@
+// Frame_Uniforms.hpp
+// angel.rodriguez@udit.es
+
+#ifndef FRAME_UNIFORMS_HEADER
+#define FRAME_UNIFORMS_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+
+namespace udit
+{
+
+    // Datos comunes a todos los programas en un frame (camara y luz) en un uniform buffer con
+    // layout std140 (el bloque GLSL esta en shaders/frame_uniforms.glsl). Se escribe una vez por
+    // frame y queda enlazado siempre al mismo binding point, asi que cada programa solo tiene que
+    // asociar su bloque a ese punto al crearse (bind_block) y no hay que volver a subirle nada.
+
+    class Frame_Uniforms
+    {
+    public:
+
+        static const GLuint binding_point = 0;
+
+        // Mismo orden y tipos que el bloque de frame_uniforms.glsl: con std140 las mat4 y los vec4
+        // no llevan relleno, asi que el struct se copia tal cual
+        struct Data
+        {
+            glm::mat4 view;
+            glm::mat4 projection;
+            glm::mat4 view_projection;
+            glm::vec4 light_dir;                // Direccion hacia la que va la luz, en espacio de vista (w = 0)
+            glm::vec4 light_color;
+            glm::vec4 ambient_color;
+            glm::vec4 fog;                      // Color de la niebla (rgb) y densidad (a); solo la usan los programas con niebla
+        };
+
+    private:
+
+        GLuint buffer_id;
+
+    public:
+
+        Frame_Uniforms();
+       ~Frame_Uniforms();
+
+    private:
+
+        Frame_Uniforms(const Frame_Uniforms & ) = delete;
+        Frame_Uniforms & operator = (const Frame_Uniforms & ) = delete;
+
+    public:
+
+        // Sustituye el contenido del buffer (una vez por frame, antes de pintar)
+        void update (const Data & data);
+
+        // Asocia el bloque Frame_Uniforms del programa al binding point (no hace nada si el
+        // programa no lo usa)
+        static void bind_block (GLuint program_id);
+
+    };
+
+}
+
+#endif
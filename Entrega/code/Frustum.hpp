@@ -0,0 +1,79 @@
+// Frustum.hpp
+// angel.rodriguez@udit.es
+
+#ifndef FRUSTUM_HEADER
+#define FRUSTUM_HEADER
+
+#include <glm.hpp>
+
+namespace udit
+{
+
+    // Piramide de vision expresada como 6 planos. Se extraen directamente de la matriz
+    // proyeccion * vista (metodo de Gribb & Hartmann) y sirve para descartar en la CPU la
+    // geometria que no va a salir en pantalla antes de mandarla a OpenGL.
+
+    class Frustum
+    {
+    public:
+
+        enum Result
+        {
+            OUTSIDE,        // La caja queda completamente fuera
+            INTERSECTS,     // La caja corta algun plano
+            INSIDE          // La caja queda completamente dentro
+        };
+
+    private:
+
+        glm::vec4 planes[6];    // (a, b, c, d) con la normal apuntando hacia el interior
+
+    public:
+
+        Frustum(const glm::mat4 & view_projection)
+        {
+            // glm guarda las matrices por columnas: la fila i es (m[0][i], m[1][i], m[2][i], m[3][i])
+
+            glm::vec4 row_x(view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]);
+            glm::vec4 row_y(view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]);
+            glm::vec4 row_z(view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]);
+            glm::vec4 row_w(view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]);
+
+            planes[0] = row_w + row_x;  // Izquierda
+            planes[1] = row_w - row_x;  // Derecha
+            planes[2] = row_w + row_y;  // Abajo
+            planes[3] = row_w - row_y;  // Arriba
+            planes[4] = row_w + row_z;  // Cerca
+            planes[5] = row_w - row_z;  // Lejos
+
+            for (auto & plane : planes)
+            {
+                plane /= glm::length(glm::vec3(plane));
+            }
+        }
+
+    public:
+
+        Result classify (const glm::vec3 & box_min, const glm::vec3 & box_max) const
+        {
+            Result result = INSIDE;
+
+            for (const auto & plane : planes)
+            {
+                // Vertice de la caja mas adentrado segun la normal del plano (p) y el opuesto (n):
+
+                glm::vec3 p(plane.x >= 0.f ? box_max.x : box_min.x, plane.y >= 0.f ? box_max.y : box_min.y, plane.z >= 0.f ? box_max.z : box_min.z);
+                glm::vec3 n(plane.x >= 0.f ? box_min.x : box_max.x, plane.y >= 0.f ? box_min.y : box_max.y, plane.z >= 0.f ? box_min.z : box_max.z);
+
+                if (glm::dot(glm::vec3(plane), p) + plane.w < 0.f) return OUTSIDE;
+                if (glm::dot(glm::vec3(plane), n) + plane.w < 0.f) result = INTERSECTS;
+            }
+
+            return result;
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,224 @@
+// GL_State.cpp
+// angel.rodriguez@udit.es
+
+#include "GL_State.hpp"
+
+namespace udit
+{
+
+    GL_State::GL_State()
+    :
+        issued_calls      (0),
+        skipped_calls     (0),
+        last_issued_calls (0),
+        last_skipped_calls(0)
+    {
+        forget_all ();
+    }
+
+    void GL_State::use_program(GLuint program_id)
+    {
+        if (changes (this->program_id, program_id)) glUseProgram (program_id);
+    }
+
+    void GL_State::bind_vertex_array(GLuint vao_id)
+    {
+        if (changes (this->vao_id, vao_id)) glBindVertexArray (vao_id);
+    }
+
+    void GL_State::bind_framebuffer(GLuint framebuffer_id)
+    {
+        if (changes (this->framebuffer_id, framebuffer_id)) glBindFramebuffer (GL_FRAMEBUFFER, framebuffer_id);
+    }
+
+    void GL_State::bind_texture(GLuint unit, GLenum target, GLuint texture_id)
+    {
+        int target_index = get_target_index (target);
+
+        if (unit < max_texture_units && target_index >= 0)
+        {
+            if (!changes (textures[unit][target_index], texture_id)) return;
+        }
+        else
+            ++issued_calls;
+
+        set_active_texture (unit);
+
+        glBindTexture (target, texture_id);
+    }
+
+    void GL_State::bind_sampler(GLuint unit, GLuint sampler_id)
+    {
+        if (unit < max_texture_units)
+        {
+            if (!changes (samplers[unit], sampler_id)) return;
+        }
+        else
+            ++issued_calls;
+
+        glBindSampler (unit, sampler_id);
+    }
+
+    void GL_State::set_active_texture(GLuint unit)
+    {
+        if (changes (active_unit, unit)) glActiveTexture (GL_TEXTURE0 + unit);
+    }
+
+    void GL_State::set_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (is_viewport_known && viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height)
+        {
+            ++skipped_calls;
+            return;
+        }
+
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+
+        is_viewport_known = true;
+
+        ++issued_calls;
+
+        glViewport (x, y, width, height);
+    }
+
+    void GL_State::set_depth_test(bool enabled)
+    {
+        if (changes (depth_test, enabled))
+        {
+            if (enabled) glEnable (GL_DEPTH_TEST); else glDisable (GL_DEPTH_TEST);
+        }
+    }
+
+    void GL_State::set_depth_write(bool enabled)
+    {
+        if (changes (depth_write, enabled)) glDepthMask (enabled ? GL_TRUE : GL_FALSE);
+    }
+
+    void GL_State::set_blend(bool enabled)
+    {
+        if (changes (blend, enabled))
+        {
+            if (enabled) glEnable (GL_BLEND); else glDisable (GL_BLEND);
+        }
+    }
+
+    void GL_State::set_blend_function(GLenum source, GLenum destination)
+    {
+        if (blend_source == source && blend_destination == destination)
+        {
+            ++skipped_calls;
+            return;
+        }
+
+        blend_source      = source;
+        blend_destination = destination;
+
+        ++issued_calls;
+
+        glBlendFunc (source, destination);
+    }
+
+    void GL_State::set_primitive_restart(bool enabled)
+    {
+        if (changes (primitive_restart, enabled))
+        {
+            if (enabled) glEnable (GL_PRIMITIVE_RESTART); else glDisable (GL_PRIMITIVE_RESTART);
+        }
+    }
+
+    void GL_State::set_restart_index(GLuint index)
+    {
+        if (is_restart_index_known && restart_index == index)
+        {
+            ++skipped_calls;
+            return;
+        }
+
+        restart_index          = index;
+        is_restart_index_known = true;
+
+        ++issued_calls;
+
+        glPrimitiveRestartIndex (index);
+    }
+
+    void GL_State::forget_bindings()
+    {
+        vao_id      = unknown;
+        active_unit = unknown;
+
+        for (auto & unit : textures)
+        {
+            for (GLuint & texture_id : unit) texture_id = unknown;
+        }
+
+        for (GLuint & sampler_id : samplers) sampler_id = unknown;
+    }
+
+    void GL_State::forget_all()
+    {
+        forget_bindings ();
+
+        program_id        = unknown;
+        framebuffer_id    = unknown;
+        is_viewport_known = false;
+        depth_test        = -1;
+        depth_write       = -1;
+        blend             = -1;
+        blend_source      = GL_NONE;          // Ninguna funcion de mezcla valida usa GL_NONE
+        blend_destination = GL_NONE;
+        primitive_restart = -1;
+
+        is_restart_index_known = false;
+    }
+
+    void GL_State::begin_frame()
+    {
+        last_issued_calls  = issued_calls;
+        last_skipped_calls = skipped_calls;
+
+        issued_calls  = 0;
+        skipped_calls = 0;
+    }
+
+    bool GL_State::changes(GLuint & current, GLuint value)
+    {
+        if (current == value)
+        {
+            ++skipped_calls;
+            return false;
+        }
+
+        current = value;
+        ++issued_calls;
+        return true;
+    }
+
+    bool GL_State::changes(int & current, bool value)
+    {
+        if (current == int(value))
+        {
+            ++skipped_calls;
+            return false;
+        }
+
+        current = int(value);
+        ++issued_calls;
+        return true;
+    }
+
+    int GL_State::get_target_index(GLenum target)
+    {
+        switch (target)
+        {
+            case GL_TEXTURE_2D:       return TEXTURE_2D;
+            case GL_TEXTURE_2D_ARRAY: return TEXTURE_2D_ARRAY;
+            case GL_TEXTURE_CUBE_MAP: return TEXTURE_CUBE_MAP;
+            default:                  return -1;
+        }
+    }
+
+}
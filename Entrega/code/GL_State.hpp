@@ -0,0 +1,117 @@
+// GL_State.hpp
+// angel.rodriguez@udit.es
+
+#ifndef GL_STATE_HEADER
+#define GL_STATE_HEADER
+
+#include <glad/gl.h>
+
+namespace udit
+{
+
+    // Copia en memoria de la parte del estado de OpenGL que se cambia en cada frame (programa,
+    // VAO, texturas y samplers por unidad, framebuffer, viewport, test y escritura de
+    // profundidad, mezcla y reinicio de primitivas).
+    // Cada cambio se compara con la copia y solo llega al driver si de verdad cambia algo; las
+    // llamadas que se ahorran se cuentan.
+    //
+    // Al empezar no se conoce nada (la primera llamada de cada tipo siempre se envia). Todo el
+    // dibujo pasa por aqui; el codigo que cambie alguno de estos estados directamente (al crear
+    // texturas y VAOs, por ejemplo) tiene que llamar despues a forget_*() para que la copia no se
+    // quede desfasada.
+
+    class GL_State
+    {
+    public:
+
+        static const unsigned max_texture_units = 8;     // Las unidades superiores no se recuerdan (siempre se envian)
+
+    private:
+
+        static const GLuint   unknown = ~GLuint(0);
+
+        // Destinos de textura que se recuerdan en cada unidad
+        enum Texture_Target
+        {
+            TEXTURE_2D,
+            TEXTURE_2D_ARRAY,
+            TEXTURE_CUBE_MAP,
+            TEXTURE_TARGET_COUNT
+        };
+
+    private:
+
+        GLuint  program_id;
+        GLuint  vao_id;
+        GLuint  framebuffer_id;
+        GLuint  active_unit;
+        GLuint  textures[max_texture_units][TEXTURE_TARGET_COUNT];
+        GLuint  samplers[max_texture_units];
+
+        GLint   viewport[4];
+        bool    is_viewport_known;
+
+        int     depth_test;                 // -1 = desconocido
+        int     depth_write;
+        int     blend;
+        GLenum  blend_source;
+        GLenum  blend_destination;
+        int     primitive_restart;
+        GLuint  restart_index;
+        bool    is_restart_index_known;     // Cualquier valor es un indice valido: no vale unknown
+
+        // Llamadas enviadas y ahorradas en el frame actual y en el anterior
+        unsigned issued_calls;
+        unsigned skipped_calls;
+        unsigned last_issued_calls;
+        unsigned last_skipped_calls;
+
+    public:
+
+        GL_State();
+
+    private:
+
+        GL_State(const GL_State & ) = delete;
+        GL_State & operator = (const GL_State & ) = delete;
+
+    public:
+
+        void use_program          (GLuint program_id);
+        void bind_vertex_array    (GLuint vao_id);
+        void bind_framebuffer     (GLuint framebuffer_id);                     // GL_FRAMEBUFFER
+        void bind_texture         (GLuint unit, GLenum target, GLuint texture_id);
+        void bind_sampler         (GLuint unit, GLuint sampler_id);            // 0 = los parametros de la propia textura
+        void set_active_texture   (GLuint unit);                               // 0, 1, 2... (no GL_TEXTUREi)
+        void set_viewport         (GLint x, GLint y, GLsizei width, GLsizei height);
+        void set_depth_test       (bool enabled);
+        void set_depth_write      (bool enabled);
+        void set_blend            (bool enabled);
+        void set_blend_function   (GLenum source, GLenum destination);
+        void set_primitive_restart(bool enabled);
+        void set_restart_index    (GLuint index);
+
+        // Olvida el VAO, la unidad activa, las texturas y los samplers (tras llamar a codigo que los cambia directamente)
+        void forget_bindings      ();
+
+        // Olvida todo
+        void forget_all           ();
+
+        // Cierra los contadores del frame anterior y empieza los del nuevo
+        void begin_frame          ();
+
+        unsigned get_issued_calls  () const { return last_issued_calls;  }
+        unsigned get_skipped_calls () const { return last_skipped_calls; }
+
+    private:
+
+        bool changes (GLuint & current, GLuint value);
+        bool changes (int    & current, bool   value);
+
+        static int get_target_index (GLenum target);
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+// Hash.hpp
+// angel.rodriguez@udit.es
+
+#ifndef HASH_HEADER
+#define HASH_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace udit
+{
+
+    // Hash FNV-1a de 64 bits compartido por las caches en disco y la cola de render. No es
+    // criptografico: solo sirve para detectar cambios y agrupar estados.
+
+    constexpr uint64_t fnv_offset_basis = 14695981039346656037ull;
+    constexpr uint64_t fnv_prime        = 1099511628211ull;
+
+    // FNV-1a tomando palabras de 64 bits (y los bytes que sobran al final uno a uno): basta
+    // para detectar cambios en un fichero y va unas ocho veces mas rapido que byte a byte.
+    // La multiplicacion solo lleva los bits hacia arriba, asi que despues de cada palabra se
+    // devuelve la mitad alta a la baja (si no, la mitad alta de las palabras no influiria en
+    // los 32 bits bajos del resultado).
+    inline uint64_t fnv1a (const void * data, size_t size, uint64_t hash = fnv_offset_basis)
+    {
+        const unsigned char * bytes = static_cast< const unsigned char * >(data);
+        size_t                words = size / sizeof(uint64_t);
+
+        for (size_t i = 0; i < words; ++i)
+        {
+            uint64_t word;
+            std::memcpy (&word, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+            hash  = (hash ^ word) * fnv_prime;
+            hash ^= hash >> 32;
+        }
+
+        for (size_t i = words * sizeof(uint64_t); i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * fnv_prime;
+        }
+
+        return hash;
+    }
+
+    // Anade un valor de 64 bits a un hash (un solo paso de fnv1a)
+    inline uint64_t hash_combine (uint64_t hash, uint64_t value)
+    {
+        return fnv1a (&value, sizeof(value), hash);
+    }
+
+}
+
+#endif
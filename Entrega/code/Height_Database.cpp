@@ -0,0 +1,150 @@
+// Height_Database.cpp
+// angel.rodriguez@udit.es
+
+#include "Height_Database.hpp"
+#include "File_System.hpp"
+#include "Terrain_Cache.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace udit
+{
+
+    bool Height_Database::build(const std::string& image_path, const Height_Map& image, const std::string& database_path, unsigned tile_size)
+    {
+        // Con un heightmap de 16 bits o float las alturas se guardan sin perder precision
+        if (image.is_empty()) return false;
+
+        int width  = image.get_width();
+        int height = image.get_height();
+
+        tile_size = std::max(tile_size, 1u);
+
+        Header header;
+        std::memcpy(header.magic, "UDHT", 4);
+        header.version     = version;
+        header.width       = uint32_t(width);
+        header.height      = uint32_t(height);
+        header.tile_size   = tile_size;
+        header.tiles_x     = (header.width  + tile_size - 1) / tile_size;
+        header.tiles_z     = (header.height + tile_size - 1) / tile_size;
+        header.reserved    = 0;
+        header.source_hash = Terrain_Cache::hash_file(image_path);
+
+        size_t   tile_count = size_t(header.tiles_x) * header.tiles_z;
+        size_t   tile_bytes = size_t(tile_size) * tile_size * sizeof(uint16_t);
+        uint64_t offset     = sizeof(Header) + tile_count * sizeof(uint64_t);
+
+        std::vector< uint64_t > offsets(tile_count);
+
+        for (size_t tile = 0; tile < tile_count; ++tile, offset += tile_bytes)
+        {
+            offsets[tile] = offset;
+        }
+
+        // Si el programa se cierra mientras escribe no queda una base de datos a medias con
+        // el hash correcto
+        std::string temporary_path = database_path + ".tmp";
+
+        create_parent_directory(database_path);
+
+        std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+
+        if (output.good())
+        {
+            output.write(reinterpret_cast< const char * >(&header), sizeof(header));
+            output.write(reinterpret_cast< const char * >(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+            std::vector< uint16_t > tile(size_t(tile_size) * tile_size);
+
+            for (unsigned tile_z = 0; tile_z < header.tiles_z; ++tile_z)
+            {
+                for (unsigned tile_x = 0; tile_x < header.tiles_x; ++tile_x)
+                {
+                    for (unsigned z = 0; z < tile_size; ++z)
+                    {
+                        unsigned source_z = std::min(tile_z * tile_size + z, header.height - 1);
+
+                        for (unsigned x = 0; x < tile_size; ++x)
+                        {
+                            unsigned source_x = std::min(tile_x * tile_size + x, header.width - 1);
+
+                            tile[size_t(z) * tile_size + x] = image.value_16(int(source_x), int(source_z));
+                        }
+                    }
+
+                    output.write(reinterpret_cast< const char * >(tile.data()), tile_bytes);
+                }
+            }
+        }
+
+        if (!output.good())
+        {
+            std::cerr << "ERROR: No se pudo escribir " << database_path << std::endl;
+            output.close();
+            std::remove(temporary_path.c_str());
+            return false;
+        }
+
+        output.close();
+
+        return replace_file(temporary_path, database_path);
+    }
+
+    bool Height_Database::update(const std::string& image_path, const Height_Map& image, const std::string& database_path, unsigned tile_size)
+    {
+        {
+            // Se cierra antes de construir: un fichero proyectado no se puede sustituir en Windows
+            Height_Database database(database_path);
+
+            if (database.is_open() && database.get_source_hash() == Terrain_Cache::hash_file(image_path))
+            {
+                return true;
+            }
+        }
+
+        return build(image_path, image, database_path, tile_size);
+    }
+
+    Height_Database::Height_Database(const std::string& database_path)
+        : file(database_path), header(nullptr), tile_offsets(nullptr)
+    {
+        if (!file.is_open() || file.get_size() < sizeof(Header)) return;
+
+        const Header * candidate = reinterpret_cast< const Header * >(file.get_data());
+
+        // Una version anterior no es un error: update la vuelve a construir
+        if (std::memcmp(candidate->magic, "UDHT", 4) == 0 && candidate->version != version) return;
+
+        if (std::memcmp(candidate->magic, "UDHT", 4) != 0 || candidate->tile_size == 0)
+        {
+            std::cerr << "ERROR: " << database_path << " no es una base de datos de alturas valida." << std::endl;
+            return;
+        }
+
+        // Se comprueba que el indice y el ultimo tile caben en el fichero antes de aceptarlo
+        size_t tile_count = size_t(candidate->tiles_x) * candidate->tiles_z;
+        size_t tile_bytes = size_t(candidate->tile_size) * candidate->tile_size * sizeof(uint16_t);
+
+        if (tile_count == 0 || file.get_size() < sizeof(Header) + tile_count * sizeof(uint64_t)) return;
+
+        const uint64_t * offsets = reinterpret_cast< const uint64_t * >(file.get_data() + sizeof(Header));
+
+        for (size_t tile = 0; tile < tile_count; ++tile)
+        {
+            if (offsets[tile] % sizeof(uint16_t) != 0 || offsets[tile] + tile_bytes > file.get_size())
+            {
+                std::cerr << "ERROR: " << database_path << " esta truncada." << std::endl;
+                return;
+            }
+        }
+
+        header       = candidate;
+        tile_offsets = offsets;
+    }
+
+}
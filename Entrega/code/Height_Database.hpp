@@ -0,0 +1,100 @@
+// Height_Database.hpp
+// angel.rodriguez@udit.es
+
+#ifndef HEIGHT_DATABASE_HEADER
+#define HEIGHT_DATABASE_HEADER
+
+#include <cstdint>
+#include <string>
+#include "Height_Map.hpp"
+#include "Mapped_File.hpp"
+
+namespace udit
+{
+
+    // Base de datos de alturas troceada en tiles de 16 bits y proyectada en memoria.
+    //
+    // Formato (little endian):
+    //   Header      magic "UDHT", version, ancho y alto en muestras, lado del tile, tiles por eje
+    //               y hash del heightmap del que sale (para saber si hay que reconstruirla)
+    //   uint64_t    offset de cada tile desde el principio del fichero (fila a fila)
+    //   uint16_t    tile_size x tile_size alturas por tile (los tiles del borde se rellenan
+    //               repitiendo la ultima muestra)
+    //
+    // Abrirla no lee nada: las paginas de cada tile se cargan al tocarlas.
+
+    class Height_Database
+    {
+    public:
+
+        static const uint32_t version = 2;
+
+    private:
+
+        struct Header
+        {
+            char     magic[4];
+            uint32_t version;
+            uint32_t width;
+            uint32_t height;
+            uint32_t tile_size;
+            uint32_t tiles_x;
+            uint32_t tiles_z;
+            uint32_t reserved;
+            uint64_t source_hash;               // Terrain_Cache::hash_file del heightmap
+        };
+
+    private:
+
+        Mapped_File      file;
+        const Header   * header;
+        const uint64_t * tile_offsets;
+
+    public:
+
+        // Convierte un heightmap ya cargado de image_path (ver Height_Map: imagen de 8 o 16 bits,
+        // .r16 o .r32) al formato troceado conservando hasta 16 bits por muestra. Solo hace falta
+        // una vez; despues el terreno arranca sin leer la imagen completa.
+        // Se escribe en un fichero temporal que sustituye al anterior al terminar.
+        static bool build  (const std::string & image_path, const Height_Map & image, const std::string & database_path, unsigned tile_size = 128);
+
+        // Llama a build si la base de datos no existe o si el heightmap ha cambiado desde que se
+        // construyo. Devuelve false si hacia falta construirla y no se ha podido.
+        static bool update (const std::string & image_path, const Height_Map & image, const std::string & database_path, unsigned tile_size = 128);
+
+        Height_Database(const std::string & database_path);
+
+    private:
+
+        Height_Database(const Height_Database & ) = delete;
+        Height_Database & operator = (const Height_Database & ) = delete;
+
+    public:
+
+        bool     is_open         () const { return header != nullptr; }
+
+        unsigned get_width       () const { return header->width;       }
+        unsigned get_height      () const { return header->height;      }
+        unsigned get_tile_size   () const { return header->tile_size;   }
+        unsigned get_tiles_x     () const { return header->tiles_x;     }
+        unsigned get_tiles_z     () const { return header->tiles_z;     }
+        uint64_t get_source_hash () const { return header->source_hash; }
+
+        // Alturas de un tile dentro del fichero proyectado (tile_size x tile_size, fila a fila)
+        const uint16_t * get_tile (unsigned tile_x, unsigned tile_z) const
+        {
+            return reinterpret_cast< const uint16_t * >(file.get_data() + tile_offsets[size_t(tile_z) * header->tiles_x + tile_x]);
+        }
+
+        uint16_t sample (unsigned x, unsigned z) const
+        {
+            unsigned tile_size = header->tile_size;
+
+            return get_tile(x / tile_size, z / tile_size)[(z % tile_size) * tile_size + (x % tile_size)];
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,192 @@
+// Height_Field.cpp
+// angel.rodriguez@udit.es
+
+#include "Height_Field.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define HEIGHT_FIELD_SSE
+    #include <emmintrin.h>
+#endif
+
+namespace udit
+{
+
+    Height_Field::Height_Field()
+        : samples_x(0), samples_z(0), origin(0.0f), step(1.0f), min_height(0.0f), height_scale(0.0f)
+    {
+    }
+
+    Height_Field::Height_Field(const std::vector< float >& heights, unsigned samples_x, unsigned samples_z, const glm::vec2& origin, const glm::vec2& step, float headroom)
+        : samples(heights.size()), samples_x(samples_x), samples_z(samples_z), origin(origin), step(step)
+    {
+        auto range = std::minmax_element(heights.begin(), heights.end());
+
+        min_height   = heights.empty() ? 0.0f : *range.first - headroom;
+        height_scale = heights.empty() ? 0.0f : (*range.second + headroom - min_height) / 65535.0f;
+
+        float inverse_scale = height_scale > 0.0f ? 1.0f / height_scale : 0.0f;
+
+        for (size_t i = 0; i < heights.size(); ++i)
+        {
+            samples[i] = uint16_t(std::lround((heights[i] - min_height) * inverse_scale));
+        }
+    }
+
+    Height_Field::Height_Field(const uint16_t* samples, unsigned samples_x, unsigned samples_z, const glm::vec2& origin, const glm::vec2& step,
+                               float min_height, float height_scale)
+        : samples(samples, samples + size_t(samples_x) * samples_z), samples_x(samples_x), samples_z(samples_z), origin(origin), step(step),
+          min_height(min_height), height_scale(height_scale)
+    {
+    }
+
+    bool Height_Field::update(const std::vector< float >& heights, unsigned x0, unsigned z0, unsigned x1, unsigned z1)
+    {
+        float max_height = get_max_height();
+
+        for (unsigned j = z0; j <= z1; ++j)
+        {
+            for (unsigned i = x0; i <= x1; ++i)
+            {
+                float height = heights[size_t(j) * samples_x + i];
+
+                if (height < min_height || height > max_height) return false;
+            }
+        }
+
+        float inverse_scale = height_scale > 0.0f ? 1.0f / height_scale : 0.0f;
+
+        for (unsigned j = z0; j <= z1; ++j)
+        {
+            for (unsigned i = x0; i <= x1; ++i)
+            {
+                size_t index = size_t(j) * samples_x + i;
+
+                samples[index] = uint16_t(std::lround((heights[index] - min_height) * inverse_scale));
+            }
+        }
+
+        return true;
+    }
+
+    bool Height_Field::contains(float x, float z) const
+    {
+        float u = (x - origin.x) / step.x;
+        float v = (z - origin.y) / step.y;
+
+        return !samples.empty() && u >= 0.0f && v >= 0.0f && u <= float(samples_x - 1) && v <= float(samples_z - 1);
+    }
+
+    void Height_Field::locate(float x, float z, unsigned& i, unsigned& j, float& fx, float& fz) const
+    {
+        float u = std::max(0.0f, std::min((x - origin.x) / step.x, float(samples_x - 1)));
+        float v = std::max(0.0f, std::min((z - origin.y) / step.y, float(samples_z - 1)));
+
+        // En el borde final se usa la ultima celda con fraccion 1
+        i  = std::min(unsigned(u), samples_x > 1 ? samples_x - 2 : 0u);
+        j  = std::min(unsigned(v), samples_z > 1 ? samples_z - 2 : 0u);
+        fx = u - float(i);
+        fz = v - float(j);
+    }
+
+    float Height_Field::height_at(float x, float z) const
+    {
+        if (samples.empty()) return 0.0f;
+        if (samples_x < 2 || samples_z < 2) return sample(0, 0);
+
+        unsigned i, j;
+        float    fx, fz;
+
+        locate(x, z, i, j, fx, fz);
+
+        float h00 = sample(i, j    ), h10 = sample(i + 1, j    );
+        float h01 = sample(i, j + 1), h11 = sample(i + 1, j + 1);
+
+        float h0 = h00 + (h10 - h00) * fx;
+        float h1 = h01 + (h11 - h01) * fx;
+
+        return h0 + (h1 - h0) * fz;
+    }
+
+    glm::vec3 Height_Field::normal_at(float x, float z) const
+    {
+        if (samples_x < 2 || samples_z < 2) return glm::vec3(0.0f, 1.0f, 0.0f);
+
+        unsigned i, j;
+        float    fx, fz;
+
+        locate(x, z, i, j, fx, fz);
+
+        float h00 = sample(i, j    ), h10 = sample(i + 1, j    );
+        float h01 = sample(i, j + 1), h11 = sample(i + 1, j + 1);
+
+        // Derivadas de la superficie bilineal dentro de la celda
+        float dh_dx = ((h10 - h00) + ((h11 - h01) - (h10 - h00)) * fz) / step.x;
+        float dh_dz = ((h01 - h00) + ((h11 - h10) - (h01 - h00)) * fx) / step.y;
+
+        return glm::normalize(glm::vec3(-dh_dx, 1.0f, -dh_dz));
+    }
+
+    void Height_Field::heights_at(const float* xs, const float* zs, float* heights, size_t count) const
+    {
+        size_t point = 0;
+
+    #ifdef HEIGHT_FIELD_SSE
+        if (samples_x >= 2 && samples_z >= 2)
+        {
+            // Cuatro puntos a la vez: la posicion en la rejilla, el limite y las fracciones en SSE;
+            // las cuatro muestras de cada punto se leen una a una (SSE2 no tiene gather)
+            const __m128 origin_x  = _mm_set1_ps(origin.x),                 origin_z  = _mm_set1_ps(origin.y);
+            const __m128 inverse_x = _mm_set1_ps(1.0f / step.x),            inverse_z = _mm_set1_ps(1.0f / step.y);
+            const __m128 limit_u   = _mm_set1_ps(float(samples_x - 1)),     limit_v   = _mm_set1_ps(float(samples_z - 1));
+            const __m128 cell_u    = _mm_set1_ps(float(samples_x - 2)),     cell_v    = _mm_set1_ps(float(samples_z - 2));
+            const __m128 zero      = _mm_setzero_ps();
+            const __m128 scale     = _mm_set1_ps(height_scale),             offset    = _mm_set1_ps(min_height);
+
+            for ( ; point + 4 <= count; point += 4)
+            {
+                __m128 u = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(xs + point), origin_x), inverse_x), zero), limit_u);
+                __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(zs + point), origin_z), inverse_z), zero), limit_v);
+
+                // Truncar es floor porque u y v ya no son negativos
+                __m128 cell_x = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(u)), cell_u);
+                __m128 cell_z = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(v)), cell_v);
+                __m128 fx     = _mm_sub_ps(u, cell_x);
+                __m128 fz     = _mm_sub_ps(v, cell_z);
+
+                alignas(16) int cells_x[4], cells_z[4];
+                _mm_store_si128(reinterpret_cast< __m128i * >(cells_x), _mm_cvttps_epi32(cell_x));
+                _mm_store_si128(reinterpret_cast< __m128i * >(cells_z), _mm_cvttps_epi32(cell_z));
+
+                alignas(16) float h00[4], h10[4], h01[4], h11[4];
+
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    const uint16_t * row = &samples[size_t(cells_z[lane]) * samples_x + size_t(cells_x[lane])];
+
+                    h00[lane] = float(row[0]);
+                    h10[lane] = float(row[1]);
+                    h01[lane] = float(row[samples_x]);
+                    h11[lane] = float(row[samples_x + 1]);
+                }
+
+                __m128 a = _mm_load_ps(h00), b = _mm_load_ps(h10);
+                __m128 c = _mm_load_ps(h01), d = _mm_load_ps(h11);
+
+                __m128 h0 = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fx));
+                __m128 h1 = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), fx));
+                __m128 h  = _mm_add_ps(h0, _mm_mul_ps(_mm_sub_ps(h1, h0), fz));
+
+                _mm_storeu_ps(heights + point, _mm_add_ps(offset, _mm_mul_ps(h, scale)));
+            }
+        }
+    #endif
+
+        for ( ; point < count; ++point)
+        {
+            heights[point] = height_at(xs[point], zs[point]);
+        }
+    }
+
+}
@@ -0,0 +1,94 @@
+// Height_Field.hpp
+// angel.rodriguez@udit.es
+
+#ifndef HEIGHT_FIELD_HEADER
+#define HEIGHT_FIELD_HEADER
+
+#include <glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace udit
+{
+
+    // Copia compacta en la CPU de las alturas de una rejilla regular (16 bits por muestra,
+    // cuantizadas entre la altura minima y la maxima) para consultar el suelo sin leer de la
+    // GPU: colocar objetos, pegar la camara al terreno, picking...
+    //
+    // Las consultas usan interpolacion bilineal entre las cuatro muestras que rodean al punto
+    // y fuera de la rejilla devuelven el valor del borde mas cercano.
+
+    class Height_Field
+    {
+    private:
+
+        std::vector< uint16_t > samples;        // Fila a fila (x crece primero)
+
+        unsigned  samples_x, samples_z;
+        glm::vec2 origin;                       // Posicion en el mundo de la muestra (0, 0)
+        glm::vec2 step;                         // Separacion entre muestras en x y z
+        float     min_height;
+        float     height_scale;                 // Altura de un paso de cuantizacion
+
+    public:
+
+        Height_Field();
+
+        // heights tiene samples_x * samples_z alturas; la muestra (i, j) esta en origin + (i, j) * step.
+        // headroom amplia el rango de cuantizacion por arriba y por abajo (para poder editar sin rehacerlo).
+        Height_Field(const std::vector< float > & heights, unsigned samples_x, unsigned samples_z, const glm::vec2 & origin, const glm::vec2 & step,
+                     float headroom = 0.0f);
+
+        // Muestras ya cuantizadas (por ejemplo las de otro Height_Field guardadas en Terrain_Cache)
+        Height_Field(const uint16_t * samples, unsigned samples_x, unsigned samples_z, const glm::vec2 & origin, const glm::vec2 & step,
+                     float min_height, float height_scale);
+
+    public:
+
+        // Vuelve a cuantizar las muestras [x0, x1] x [z0, z1] (incluidas) de heights, que tiene las
+        // alturas de toda la rejilla. Devuelve false sin cambiar nada si alguna se sale del rango
+        // de cuantizacion actual (entonces hay que construir el Height_Field otra vez).
+        bool update (const std::vector< float > & heights, unsigned x0, unsigned z0, unsigned x1, unsigned z1);
+
+        bool     is_empty      () const { return samples.empty(); }
+        unsigned get_samples_x () const { return samples_x; }
+        unsigned get_samples_z () const { return samples_z; }
+        float    get_min_height() const { return min_height; }
+        float    get_max_height() const { return min_height + height_scale * 65535.0f; }
+        float    get_height_scale() const { return height_scale; }
+
+        size_t   get_memory_size () const { return samples.size() * sizeof(uint16_t); }
+        const uint16_t * get_samples () const { return samples.data(); }
+
+        const glm::vec2 & get_origin () const { return origin; }
+        const glm::vec2 & get_step   () const { return step;   }
+
+        bool contains (float x, float z) const;
+
+        // Muestra (i, j) cuantizada y su altura
+        uint16_t quantized_sample (unsigned i, unsigned j) const { return samples[size_t(j) * samples_x + i]; }
+        float    dequantize       (uint16_t value) const { return min_height + height_scale * float(value); }
+
+        // Altura de la muestra (i, j) ya descuantizada
+        float sample (unsigned i, unsigned j) const
+        {
+            return dequantize(quantized_sample(i, j));
+        }
+
+        float     height_at (float x, float z) const;
+        glm::vec3 normal_at (float x, float z) const;
+
+        // Version por lotes de height_at para muchos puntos (con SSE en x86)
+        void heights_at (const float * xs, const float * zs, float * heights, size_t count) const;
+
+    private:
+
+        // Celda y fraccion dentro de ella para una posicion del mundo (ya limitada a la rejilla)
+        void locate (float x, float z, unsigned & i, unsigned & j, float & fx, float & fz) const;
+
+    };
+
+}
+
+#endif
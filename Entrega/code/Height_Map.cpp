@@ -0,0 +1,127 @@
+// Height_Map.cpp
+// angel.rodriguez@udit.es
+
+#include "Height_Map.hpp"
+#include "Mapped_File.hpp"
+#include <SOIL2.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace udit
+{
+
+    namespace
+    {
+
+        bool has_extension(const std::string & path, const char * extension)
+        {
+            size_t length = std::strlen(extension);
+
+            if (path.size() < length) return false;
+
+            for (size_t i = 0; i < length; ++i)
+            {
+                if (std::tolower((unsigned char)path[path.size() - length + i]) != extension[i]) return false;
+            }
+
+            return true;
+        }
+
+    }
+
+    Height_Map::Height_Map()
+        : width(0), height(0), format(UNORM8)
+    {
+    }
+
+    Height_Map::Height_Map(int width, int height, Format format, const void * data)
+        : width(std::max(width, 0)), height(std::max(height, 0)), format(format)
+    {
+        texels.resize(size_t(this->width) * this->height * get_texel_size());
+
+        if (data && !texels.empty()) std::memcpy(texels.data(), data, texels.size());
+    }
+
+    Height_Map::Height_Map(const std::string & path)
+        : width(0), height(0), format(UNORM8)
+    {
+        bool is_loaded = false;
+
+        if      (has_extension(path, ".r16")) is_loaded = load_raw(path, UNORM16);
+        else if (has_extension(path, ".r32")) is_loaded = load_raw(path, FLOAT32);
+        else if (stbi_is_16_bit(path.c_str()))
+        {
+            // PNG de 16 bits: se pide un solo canal para no decodificar ni guardar los otros
+            int channels = 0;
+            stbi_us * image = stbi_load_16(path.c_str(), &width, &height, &channels, 1);
+
+            if (image)
+            {
+                format = UNORM16;
+                texels.assign(reinterpret_cast< unsigned char * >(image), reinterpret_cast< unsigned char * >(image) + size_t(width) * height * 2);
+                stbi_image_free(image);
+                is_loaded = true;
+            }
+        }
+        else
+        {
+            int channels = 0;
+            unsigned char * image = SOIL_load_image(path.c_str(), &width, &height, &channels, SOIL_LOAD_L);
+
+            if (image)
+            {
+                format = UNORM8;
+                texels.assign(image, image + size_t(width) * height);
+                SOIL_free_image_data(image);
+                is_loaded = true;
+            }
+        }
+
+        if (!is_loaded)
+        {
+            std::cerr << "ERROR: No se pudo cargar el heightmap " << path << std::endl;
+
+            texels.clear();
+            width = height = 0;
+        }
+    }
+
+    bool Height_Map::load_raw(const std::string & path, Format raw_format)
+    {
+        Mapped_File file(path);
+
+        if (!file.is_open()) return false;
+
+        format = raw_format;
+
+        // Los ficheros crudos no tienen cabecera: la rejilla es cuadrada
+        size_t count = file.get_size() / get_texel_size();
+        int    side  = int(std::sqrt(double(count)) + 0.5);
+
+        if (side == 0 || size_t(side) * side != count) return false;
+
+        width  = side;
+        height = side;
+        texels.assign(file.get_data(), file.get_data() + count * get_texel_size());
+
+        return true;
+    }
+
+    uint16_t Height_Map::value_16(int x, int y) const
+    {
+        size_t index = size_t(y) * width + x;
+
+        switch (format)
+        {
+            // De 8 a 16 bits sin perder el rango completo (255 * 257 = 65535)
+            case UNORM8:  return uint16_t(texels[index] * 257);
+            case UNORM16: return reinterpret_cast< const uint16_t * >(texels.data())[index];
+            default:      return uint16_t(std::lround(std::min(std::max(value(x, y), 0.0f), 1.0f) * 65535.0f));
+        }
+    }
+
+}
@@ -0,0 +1,90 @@
+// Height_Map.hpp
+// angel.rodriguez@udit.es
+
+#ifndef HEIGHT_MAP_HEADER
+#define HEIGHT_MAP_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace udit
+{
+
+    // Heightmap de un solo canal guardado tal cual se lee (8 o 16 bits sin signo o float), sin
+    // expandirlo a RGB. Los valores se devuelven normalizados (0..1 en los formatos enteros; los
+    // float se usan como estan), asi que la altura del terreno sigue siendo valor * max_height.
+    //
+    // Formatos que se cargan segun la extension:
+    //  - .r16: alturas crudas de 16 bits (little endian), rejilla cuadrada
+    //  - .r32: alturas crudas float de 32 bits, rejilla cuadrada
+    //  - cualquier otra: imagen (PNG de 8 o 16 bits, JPG...) de la que se lee solo la luminancia
+
+    class Height_Map
+    {
+    public:
+
+        enum Format
+        {
+            UNORM8,
+            UNORM16,
+            FLOAT32
+        };
+
+    private:
+
+        std::vector< unsigned char > texels;        // Fila a fila, get_texel_size() bytes por texel
+
+        int    width;
+        int    height;
+        Format format;
+
+    public:
+
+        Height_Map();
+
+        // Si no se puede cargar queda vacio (is_empty)
+        explicit Height_Map(const std::string & path);
+
+        // Copia width * height valores del formato indicado (o ceros si data es nullptr)
+        Height_Map(int width, int height, Format format, const void * data = nullptr);
+
+    public:
+
+        bool   is_empty      () const { return texels.empty(); }
+        int    get_width     () const { return width;  }
+        int    get_height    () const { return height; }
+        Format get_format    () const { return format; }
+        size_t get_texel_size() const { return format == UNORM8 ? 1 : format == UNORM16 ? 2 : 4; }
+
+        const void * get_data () const { return texels.data(); }
+        void       * get_data ()       { return texels.data(); }
+
+        size_t get_memory_size () const { return texels.size(); }
+
+        // Valor normalizado del texel (x, y)
+        float value (int x, int y) const
+        {
+            size_t index = size_t(y) * width + x;
+
+            switch (format)
+            {
+                case UNORM8:  return float(texels[index]) / 255.0f;
+                case UNORM16: return float(reinterpret_cast< const uint16_t * >(texels.data())[index]) / 65535.0f;
+                default:      return reinterpret_cast< const float * >(texels.data())[index];
+            }
+        }
+
+        // Valor del texel (x, y) llevado a 16 bits (los float se limitan a 0..1)
+        uint16_t value_16 (int x, int y) const;
+
+    private:
+
+        bool load_raw (const std::string & path, Format raw_format);
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+// Height_Texture.cpp
+// angel.rodriguez@udit.es
+
+#include "Height_Texture.hpp"
+
+namespace udit
+{
+
+    Height_Texture::Height_Texture(GLsizei width, GLsizei height, const unsigned char * texels)
+        : width(width), height(height)
+    {
+        create(GL_R8, GL_UNSIGNED_BYTE, texels);
+    }
+
+    Height_Texture::Height_Texture(const Height_Map & height_map)
+        : width(height_map.get_width()), height(height_map.get_height())
+    {
+        switch (height_map.get_format())
+        {
+            case Height_Map::UNORM8:  create(GL_R8,   GL_UNSIGNED_BYTE,  height_map.get_data()); break;
+            case Height_Map::UNORM16: create(GL_R16,  GL_UNSIGNED_SHORT, height_map.get_data()); break;
+            default:                  create(GL_R32F, GL_FLOAT,          height_map.get_data()); break;
+        }
+    }
+
+    void Height_Texture::create(GLint internal_format, GLenum type, const void * texels)
+    {
+        texel_type = type;
+
+        glGenTextures(1, &texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+
+        // Se filtra linealmente pero sin mipmaps: el vertex shader siempre lee el nivel 0
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // Las filas de un solo byte no tienen por que estar alineadas a 4
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, GL_RED, type, texels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    Height_Texture::~Height_Texture()
+    {
+        glDeleteTextures(1, &texture_id);
+    }
+
+    void Height_Texture::update(GL_State & gl_state, GLuint texture_unit, GLint x, GLint y, GLsizei region_width, GLsizei region_height, const void * texels)
+    {
+        // glTexSubImage2D trabaja con la unidad activa, que bind_texture no cambia si la textura ya estaba
+        gl_state.bind_texture      (texture_unit, GL_TEXTURE_2D, texture_id);
+        gl_state.set_active_texture(texture_unit);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, region_width, region_height, GL_RED, texel_type, texels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    void Height_Texture::bind(GL_State & gl_state, GLuint texture_unit) const
+    {
+        gl_state.bind_texture(texture_unit, GL_TEXTURE_2D, texture_id);
+    }
+
+}
@@ -0,0 +1,55 @@
+// Height_Texture.hpp
+// angel.rodriguez@udit.es
+
+#ifndef HEIGHT_TEXTURE_HEADER
+#define HEIGHT_TEXTURE_HEADER
+
+#include <glad/gl.h>
+#include "GL_State.hpp"
+#include "Height_Map.hpp"
+
+namespace udit
+{
+
+    // Textura de un solo canal con las alturas del terreno. Se sube una vez y los shaders
+    // desplazan con ella una rejilla plana, asi que editar el terreno es solo actualizar texels.
+    // Conserva la precision del heightmap (R8, R16 o R32F); el shader lee siempre un valor 0..1.
+
+    class Height_Texture
+    {
+    private:
+
+        GLuint  texture_id;
+        GLsizei width;
+        GLsizei height;
+        GLenum  texel_type;                 // Tipo de los texels que recibe update
+
+    public:
+
+        Height_Texture(GLsizei width, GLsizei height, const unsigned char * texels);
+        explicit Height_Texture(const Height_Map & height_map);
+       ~Height_Texture();
+
+    private:
+
+        void create (GLint internal_format, GLenum type, const void * texels);
+
+        Height_Texture(const Height_Texture & ) = delete;
+        Height_Texture & operator = (const Height_Texture & ) = delete;
+
+    public:
+
+        GLsizei get_width  () const { return width;  }
+        GLsizei get_height () const { return height; }
+
+        // Sustituye un rectangulo de texels (del mismo formato que al crearla) sin volver a crear la
+        // textura. La deja activa en la unidad indicada (0, 1, 2...), normalmente en la que se usa.
+        void update (GL_State & gl_state, GLuint texture_unit, GLint x, GLint y, GLsizei region_width, GLsizei region_height, const void * texels);
+
+        void bind   (GL_State & gl_state, GLuint texture_unit) const;
+
+    };
+
+}
+
+#endif
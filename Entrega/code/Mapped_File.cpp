@@ -0,0 +1,77 @@
+// Mapped_File.cpp
+// angel.rodriguez@udit.es
+
+#include "Mapped_File.hpp"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace udit
+{
+
+#ifdef _WIN32
+
+    Mapped_File::Mapped_File(const std::string& path)
+        : data(nullptr), size(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr)
+    {
+        file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file_handle == INVALID_HANDLE_VALUE) return;
+
+        LARGE_INTEGER file_size;
+
+        if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) return;
+
+        mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (!mapping_handle) return;
+
+        data = static_cast< const unsigned char * >(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+        size = data ? size_t(file_size.QuadPart) : 0;
+    }
+
+    Mapped_File::~Mapped_File()
+    {
+        if (data)                               UnmapViewOfFile(data);
+        if (mapping_handle)                     CloseHandle(mapping_handle);
+        if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+    }
+
+#else
+
+    Mapped_File::Mapped_File(const std::string& path)
+        : data(nullptr), size(0), file_descriptor(-1)
+    {
+        file_descriptor = open(path.c_str(), O_RDONLY);
+
+        if (file_descriptor < 0) return;
+
+        struct stat file_status;
+
+        if (fstat(file_descriptor, &file_status) != 0 || file_status.st_size == 0) return;
+
+        void * address = mmap(nullptr, size_t(file_status.st_size), PROT_READ, MAP_SHARED, file_descriptor, 0);
+
+        if (address == MAP_FAILED) return;
+
+        data = static_cast< const unsigned char * >(address);
+        size = size_t(file_status.st_size);
+    }
+
+    Mapped_File::~Mapped_File()
+    {
+        if (data)                 munmap(const_cast< unsigned char * >(data), size);
+        if (file_descriptor >= 0) close(file_descriptor);
+    }
+
+#endif
+
+}
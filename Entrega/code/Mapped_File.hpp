@@ -0,0 +1,51 @@
+// Mapped_File.hpp
+// angel.rodriguez@udit.es
+
+#ifndef MAPPED_FILE_HEADER
+#define MAPPED_FILE_HEADER
+
+#include <cstddef>
+#include <string>
+
+namespace udit
+{
+
+    // Fichero proyectado en memoria en modo solo lectura. El sistema operativo carga las paginas
+    // cuando se tocan y puede descartarlas cuando le haga falta, asi que se pueden usar ficheros
+    // mas grandes que la memoria disponible sin leerlos enteros.
+
+    class Mapped_File
+    {
+    private:
+
+        const unsigned char * data;
+        size_t                size;
+
+    #ifdef _WIN32
+        void * file_handle;
+        void * mapping_handle;
+    #else
+        int    file_descriptor;
+    #endif
+
+    public:
+
+        Mapped_File(const std::string & path);
+       ~Mapped_File();
+
+    private:
+
+        Mapped_File(const Mapped_File & ) = delete;
+        Mapped_File & operator = (const Mapped_File & ) = delete;
+
+    public:
+
+        bool                  is_open  () const { return data != nullptr; }
+        const unsigned char * get_data () const { return data; }
+        size_t                get_size () const { return size; }
+
+    };
+
+}
+
+#endif
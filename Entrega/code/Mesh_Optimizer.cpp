@@ -0,0 +1,316 @@
+// Mesh_Optimizer.cpp
+// angel.rodriguez@udit.es
+
+#include "Mesh_Optimizer.hpp"
+#include "Mesh_Statistics.hpp"
+#include <algorithm>
+#include <cmath>
+
+using std::vector;
+
+namespace udit
+{
+
+    namespace
+    {
+
+        // Parametros del articulo de Forsyth ("Linear-Speed Vertex Cache Optimisation", 2006)
+        const float cache_decay_power   = 1.5f;
+        const float last_triangle_score = 0.75f;
+        const float valence_boost_scale = 2.0f;
+        const float valence_boost_power = 0.5f;
+
+        // Las puntuaciones se tabulan porque se recalculan para toda la cache en cada triangulo
+        class Vertex_Scores
+        {
+            static const unsigned max_valence = 32;
+
+            std::vector< float > position_scores;       // Segun la posicion en la cache
+            std::vector< float > valence_scores;        // Segun los triangulos pendientes
+
+        public:
+
+            Vertex_Scores(unsigned cache_size) : position_scores(cache_size), valence_scores(max_valence + 1)
+            {
+                for (unsigned position = 0; position < cache_size; ++position)
+                {
+                    // Los tres vertices del ultimo triangulo puntuan igual para no favorecer tiras largas
+                    position_scores[position] = position < 3
+                        ? last_triangle_score
+                        : std::pow(1.0f - float(position - 3) / float(cache_size - 3), cache_decay_power);
+                }
+
+                for (unsigned valence = 1; valence <= max_valence; ++valence)
+                {
+                    valence_scores[valence] = valence_boost_scale * std::pow(float(valence), -valence_boost_power);
+                }
+            }
+
+            float operator () (int cache_position, unsigned remaining_triangles) const
+            {
+                if (remaining_triangles == 0) return -1.0f;     // Ya no aporta nada
+
+                float score = cache_position >= 0 ? position_scores[size_t(cache_position)] : 0.0f;
+
+                // Los vertices con pocos triangulos pendientes se terminan antes para sacarlos de la cache
+                score += remaining_triangles <= max_valence
+                    ? valence_scores[remaining_triangles]
+                    : valence_boost_scale * std::pow(float(remaining_triangles), -valence_boost_power);
+
+                return score;
+            }
+        };
+
+    }
+
+    void Mesh_Optimizer::optimize_vertex_cache(vector< GLuint >& indices, size_t vertex_count, unsigned cache_size)
+    {
+        size_t triangle_count = indices.size() / 3;
+
+        if (triangle_count == 0) return;
+
+        cache_size = std::max(cache_size, 4u);
+
+        // Triangulos de cada vertice (listas de adyacencia compactas)
+        vector< unsigned > remaining  (vertex_count, 0);
+        vector< unsigned > first_entry(vertex_count + 1, 0);
+
+        for (GLuint index : indices) ++remaining[index];
+
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) first_entry[vertex + 1] = first_entry[vertex] + remaining[vertex];
+
+        vector< unsigned > adjacency(indices.size());
+        vector< unsigned > fill(first_entry.begin(), first_entry.end() - 1);
+
+        for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                GLuint vertex = indices[triangle * 3 + corner];
+                adjacency[fill[vertex]++] = unsigned(triangle);
+            }
+        }
+
+        Vertex_Scores vertex_score(cache_size);
+
+        vector< int   > cache_position(vertex_count, -1);
+        vector< float > vertex_scores (vertex_count);
+        vector< float > triangle_scores(triangle_count, 0.0f);
+        vector< bool  > emitted       (triangle_count, false);
+
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+        {
+            vertex_scores[vertex] = vertex_score(-1, remaining[vertex]);
+        }
+
+        for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+        {
+            for (int corner = 0; corner < 3; ++corner) triangle_scores[triangle] += vertex_scores[indices[triangle * 3 + corner]];
+        }
+
+        vector< GLuint > cache, new_cache;      // LRU: el primero es el mas reciente
+        vector< GLuint > result;
+        result.reserve(indices.size());
+
+        size_t scan_position = 0;               // Para buscar un triangulo nuevo cuando la cache no tiene ninguno
+
+        long long best_triangle = 0;
+
+        for (size_t i = 1; i < triangle_count; ++i)
+        {
+            if (triangle_scores[i] > triangle_scores[size_t(best_triangle)]) best_triangle = (long long)i;
+        }
+
+        while (best_triangle >= 0)
+        {
+            size_t triangle = size_t(best_triangle);
+            const GLuint * corners = &indices[triangle * 3];
+
+            emitted[triangle] = true;
+            result.insert(result.end(), corners, corners + 3);
+
+            // El triangulo sale de las listas de sus vertices
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                GLuint     vertex = corners[corner];
+                unsigned * begin  = &adjacency[first_entry[vertex]];
+                unsigned * end    = begin + remaining[vertex];
+
+                std::iter_swap(std::find(begin, end, unsigned(triangle)), end - 1);
+                --remaining[vertex];
+            }
+
+            // Los vertices del triangulo pasan al principio de la cache
+            new_cache.assign(corners, corners + 3);
+
+            for (GLuint vertex : cache)
+            {
+                if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) new_cache.push_back(vertex);
+            }
+
+            for (size_t i = cache_size; i < new_cache.size(); ++i) cache_position[new_cache[i]] = -1;     // Expulsados
+
+            if (new_cache.size() > cache_size + 3) new_cache.resize(cache_size + 3);
+
+            cache.swap(new_cache);
+
+            // Se recalculan las puntuaciones de los vertices afectados y de sus triangulos...
+            for (size_t position = 0; position < cache.size(); ++position)
+            {
+                GLuint vertex = cache[position];
+
+                cache_position[vertex] = position < cache_size ? int(position) : -1;
+
+                float score = vertex_score(cache_position[vertex], remaining[vertex]);
+                float delta = score - vertex_scores[vertex];
+
+                vertex_scores[vertex] = score;
+
+                for (unsigned entry = 0; entry < remaining[vertex]; ++entry)
+                {
+                    triangle_scores[adjacency[first_entry[vertex] + entry]] += delta;
+                }
+            }
+
+            // ...y se elige el mejor de los triangulos que tocan la cache
+            best_triangle = -1;
+            float best_score = -1.0f;
+
+            for (GLuint vertex : cache)
+            {
+                for (unsigned entry = 0; entry < remaining[vertex]; ++entry)
+                {
+                    unsigned neighbour = adjacency[first_entry[vertex] + entry];
+
+                    if (triangle_scores[neighbour] > best_score)
+                    {
+                        best_score    = triangle_scores[neighbour];
+                        best_triangle = neighbour;
+                    }
+                }
+            }
+
+            if (cache.size() > cache_size) cache.resize(cache_size);
+
+            // Ningun triangulo pendiente comparte vertices con la cache: se busca el siguiente
+            if (best_triangle < 0)
+            {
+                while (scan_position < triangle_count && emitted[scan_position]) ++scan_position;
+
+                if (scan_position < triangle_count) best_triangle = (long long)scan_position;
+            }
+        }
+
+        indices.swap(result);
+    }
+
+    void Mesh_Optimizer::optimize_overdraw(vector< GLuint >& indices, const vector< glm::vec3 >& positions, unsigned cache_size, float threshold)
+    {
+        size_t triangle_count = indices.size() / 3;
+
+        if (triangle_count < 2) return;
+
+        // 1. Clusters: se corta donde la cache "se vacia" (un triangulo con sus 3 vertices nuevos),
+        // asi reordenar clusters enteros casi no cambia los fallos de cache
+        vector< size_t > cluster_starts;
+        {
+            vector< GLuint > fifo;
+            size_t           next = 0;              // Posicion de la FIFO circular
+
+            for (size_t triangle = 0; triangle < triangle_count; ++triangle)
+            {
+                int misses = 0;
+
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    GLuint vertex = indices[triangle * 3 + corner];
+
+                    if (std::find(fifo.begin(), fifo.end(), vertex) != fifo.end()) continue;
+
+                    ++misses;
+
+                    if (fifo.size() < cache_size) fifo.push_back(vertex);
+                    else                          fifo[next++ % cache_size] = vertex;
+                }
+
+                if (triangle == 0 || misses == 3) cluster_starts.push_back(triangle);
+            }
+        }
+
+        size_t cluster_count = cluster_starts.size();
+
+        if (cluster_count < 2) return;
+
+        cluster_starts.push_back(triangle_count);
+
+        // 2. Orientacion de cada cluster respecto al centro de la malla
+        glm::vec3 mesh_center(0.0f);
+
+        for (GLuint index : indices) mesh_center += positions[index];
+
+        mesh_center /= float(indices.size());
+
+        vector< std::pair< float, size_t > > order(cluster_count);       // (clave, cluster)
+
+        for (size_t cluster = 0; cluster < cluster_count; ++cluster)
+        {
+            glm::vec3 center(0.0f), normal(0.0f);
+            float     area = 0.0f;
+
+            for (size_t triangle = cluster_starts[cluster]; triangle < cluster_starts[cluster + 1]; ++triangle)
+            {
+                const glm::vec3 & a = positions[indices[triangle * 3 + 0]];
+                const glm::vec3 & b = positions[indices[triangle * 3 + 1]];
+                const glm::vec3 & c = positions[indices[triangle * 3 + 2]];
+
+                glm::vec3 cross = glm::cross(b - a, c - a);     // Longitud = 2 x area
+                float     weight = glm::length(cross);
+
+                center += (a + b + c) * (weight / 3.0f);
+                normal += cross;
+                area   += weight;
+            }
+
+            if (area > 0.0f) center /= area;
+
+            float normal_length = glm::length(normal);
+
+            // Cuanto mas hacia fuera mira el cluster antes se dibuja
+            order[cluster].first  = normal_length > 0.0f ? -glm::dot(center - mesh_center, normal / normal_length) : 0.0f;
+            order[cluster].second = cluster;
+        }
+
+        std::stable_sort(order.begin(), order.end(),
+                         [](const std::pair< float, size_t > & a, const std::pair< float, size_t > & b) { return a.first < b.first; });
+
+        vector< GLuint > sorted;
+        sorted.reserve(indices.size());
+
+        for (const auto & entry : order)
+        {
+            sorted.insert(sorted.end(), indices.begin() + cluster_starts[entry.second] * 3, indices.begin() + cluster_starts[entry.second + 1] * 3);
+        }
+
+        // 3. Solo se acepta si la cache de vertices no sale perjudicada
+        float before = Mesh_Statistics(indices, GL_TRIANGLES, cache_size).acmr;
+        float after  = Mesh_Statistics(sorted,  GL_TRIANGLES, cache_size).acmr;
+
+        if (after <= before * threshold) indices.swap(sorted);
+    }
+
+    vector< GLuint > Mesh_Optimizer::vertex_fetch_remap(vector< GLuint >& indices, size_t vertex_count)
+    {
+        vector< GLuint > remap(vertex_count, unused);
+        GLuint           next = 0;
+
+        for (GLuint & index : indices)
+        {
+            if (remap[index] == unused) remap[index] = next++;
+
+            index = remap[index];
+        }
+
+        return remap;
+    }
+
+}
@@ -0,0 +1,95 @@
+// Mesh_Optimizer.hpp
+// angel.rodriguez@udit.es
+
+#ifndef MESH_OPTIMIZER_HEADER
+#define MESH_OPTIMIZER_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace udit
+{
+
+    // Pasos de optimizacion para cualquier malla indexada (listas de triangulos) antes de
+    // subirla a la GPU. Se aplican en este orden:
+    //
+    //  1. optimize_vertex_cache: reordena los triangulos para reutilizar los vertices ya
+    //     transformados (algoritmo de Tom Forsyth con una cache LRU).
+    //  2. optimize_overdraw: agrupa los triangulos en clusters que respetan el orden anterior y
+    //     dibuja primero los que miran hacia fuera de la malla, que suelen tapar a los demas
+    //     (idea de Tipsify, Sander et al. 2007). Solo se acepta si el ACMR apenas empeora.
+    //  3. optimize_vertex_fetch: renumera los vertices en el orden en que se usan para que
+    //     las lecturas del vertex buffer sean consecutivas.
+    //
+    // Mesh_Statistics mide el resultado.
+
+    class Mesh_Optimizer
+    {
+    public:
+
+        static void optimize_vertex_cache (std::vector< GLuint > & indices, size_t vertex_count, unsigned cache_size = 32);
+
+        // positions[i] es la posicion del vertice i. threshold es el empeoramiento maximo del ACMR
+        // que se admite (1.05 = un 5%).
+        static void optimize_overdraw     (std::vector< GLuint > & indices, const std::vector< glm::vec3 > & positions,
+                                           unsigned cache_size = 32, float threshold = 1.05f);
+
+        // Une los vertices identicos (byte a byte) de una malla sin indices y devuelve los indices
+        template< typename VERTEX >
+        static std::vector< GLuint > weld_vertices (std::vector< VERTEX > & vertices)
+        {
+            std::vector< VERTEX > unique;
+            std::vector< GLuint > indices;
+            std::unordered_map< std::string, GLuint > first_copy;     // Bytes del vertice -> indice
+
+            indices.reserve(vertices.size());
+
+            for (const VERTEX & vertex : vertices)
+            {
+                std::string key(reinterpret_cast< const char * >(&vertex), sizeof(VERTEX));
+
+                auto inserted = first_copy.insert(std::make_pair(key, GLuint(unique.size())));
+
+                if (inserted.second) unique.push_back(vertex);
+
+                indices.push_back(inserted.first->second);
+            }
+
+            vertices.swap(unique);
+
+            return indices;
+        }
+
+        // Los vertices que no usa ningun indice se eliminan
+        template< typename VERTEX >
+        static void optimize_vertex_fetch (std::vector< GLuint > & indices, std::vector< VERTEX > & vertices)
+        {
+            std::vector< GLuint > remap = vertex_fetch_remap(indices, vertices.size());
+            std::vector< VERTEX > reordered;
+
+            for (size_t i = 0; i < remap.size(); ++i)
+            {
+                if (remap[i] == unused) continue;
+                if (remap[i] >= reordered.size()) reordered.resize(remap[i] + 1);
+
+                reordered[remap[i]] = vertices[i];
+            }
+
+            vertices.swap(reordered);
+        }
+
+    private:
+
+        static const GLuint unused = ~GLuint(0);
+
+        // Nuevo indice de cada vertice (unused si no se usa). Tambien renumera indices.
+        static std::vector< GLuint > vertex_fetch_remap (std::vector< GLuint > & indices, size_t vertex_count);
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+// Mesh_Statistics.cpp
+// angel.rodriguez@udit.es
+
+#include "Mesh_Statistics.hpp"
+#include <algorithm>
+#include <deque>
+#include <unordered_set>
+
+namespace udit
+{
+
+    Mesh_Statistics::Mesh_Statistics(const std::vector< GLuint >& indices, GLenum primitive, unsigned cache_size, GLuint restart_index)
+        : triangle_count(0), vertex_count(0), cache_misses(0), acmr(0.0f), atvr(0.0f)
+    {
+        std::deque< GLuint > cache;
+        std::unordered_set< GLuint > referenced;
+
+        auto fetch = [&](GLuint index)
+        {
+            if (std::find(cache.begin(), cache.end(), index) != cache.end()) return;
+
+            ++cache_misses;
+
+            referenced.insert(index);
+
+            cache.push_back(index);
+            if (cache.size() > cache_size) cache.pop_front();
+        };
+
+        if (primitive == GL_TRIANGLES)
+        {
+            for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                fetch(indices[i]); fetch(indices[i + 1]); fetch(indices[i + 2]);
+
+                if (indices[i] != indices[i + 1] && indices[i + 1] != indices[i + 2] && indices[i] != indices[i + 2]) ++triangle_count;
+            }
+        }
+        else
+        {
+            size_t strip_length = 0;
+
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                if (indices[i] == restart_index)
+                {
+                    strip_length = 0;
+                    continue;
+                }
+
+                fetch(indices[i]);
+
+                if (++strip_length >= 3)
+                {
+                    GLuint a = indices[i - 2], b = indices[i - 1], c = indices[i];
+
+                    if (a != b && b != c && a != c) ++triangle_count;
+                }
+            }
+        }
+
+        vertex_count = referenced.size();
+
+        acmr = triangle_count ? float(cache_misses) / float(triangle_count) : 0.0f;
+        atvr = vertex_count   ? float(cache_misses) / float(vertex_count  ) : 0.0f;
+    }
+
+}
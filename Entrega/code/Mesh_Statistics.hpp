@@ -0,0 +1,43 @@
+// Mesh_Statistics.hpp
+// angel.rodriguez@udit.es
+
+#ifndef MESH_STATISTICS_HEADER
+#define MESH_STATISTICS_HEADER
+
+#include <glad/gl.h>
+#include <cstddef>
+#include <vector>
+
+namespace udit
+{
+
+    // Simula la cache de vertices transformados de la GPU (FIFO de cache_size entradas) sobre
+    // un buffer de indices para medir cuantas veces se ejecutaria el vertex shader.
+    //
+    //   ACMR (average cache miss ratio)         = vertices transformados / triangulos
+    //   ATVR (average transform to vertex ratio) = vertices transformados / vertices distintos
+    //
+    // Una rejilla tiene el doble de triangulos que de vertices, asi que el ACMR minimo es ~0.5;
+    // una lista sin ninguna reutilizacion da 3. El ATVR ideal es 1 (cada vertice una sola vez).
+
+    class Mesh_Statistics
+    {
+    public:
+
+        size_t triangle_count;          // Triangulos no degenerados
+        size_t vertex_count;            // Vertices distintos referenciados
+        size_t cache_misses;            // Vertices transformados
+        float  acmr;
+        float  atvr;
+
+    public:
+
+        // primitive es GL_TRIANGLES o GL_TRIANGLE_STRIP. En las tiras, restart_index corta la tira
+        // (y en el hardware real tambien vacia la cache de la tira, pero no la de vertices).
+        Mesh_Statistics(const std::vector< GLuint > & indices, GLenum primitive, unsigned cache_size = 32, GLuint restart_index = ~GLuint(0));
+
+    };
+
+}
+
+#endif
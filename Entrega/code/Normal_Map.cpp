@@ -0,0 +1,108 @@
+// Normal_Map.cpp
+// angel.rodriguez@udit.es
+
+#include "Normal_Map.hpp"
+#include <glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace udit
+{
+
+    void Normal_Map::bake
+    (
+        const Height_Map & height_map, float width, float depth, float max_height,
+        std::vector< GLbyte > & texels, unsigned thread_count
+    )
+    {
+        int map_width  = height_map.get_width();
+        int map_height = height_map.get_height();
+
+        texels.resize(size_t(map_width) * map_height * 2);
+
+        if (texels.empty()) return;
+
+        // Separacion entre pixels en el mundo (el primero y el ultimo caen en los bordes del terreno)
+        float step_x = map_width  > 1 ? width / float(map_width  - 1) : 1.0f;
+        float step_z = map_height > 1 ? depth / float(map_height - 1) : 1.0f;
+
+        auto bake_rows = [&](int first_row, int last_row)
+        {
+            for (int z = first_row; z < last_row; ++z)
+            {
+                int down = std::max(z - 1, 0), up = std::min(z + 1, map_height - 1);
+
+                for (int x = 0; x < map_width; ++x)
+                {
+                    int left = std::max(x - 1, 0), right = std::min(x + 1, map_width - 1);
+
+                    // Diferencias centrales (en los bordes, hacia el unico vecino que hay)
+                    float dh_dx = right > left ? (height_map.value(right, z) - height_map.value(left, z)) * max_height / (float(right - left) * step_x) : 0.0f;
+                    float dh_dz = up    > down ? (height_map.value(x, up   ) - height_map.value(x, down)) * max_height / (float(up    - down) * step_z) : 0.0f;
+
+                    glm::vec3 normal = glm::normalize(glm::vec3(-dh_dx, 1.0f, -dh_dz));
+
+                    GLbyte * texel = &texels[(size_t(z) * map_width + x) * 2];
+
+                    texel[0] = GLbyte(std::lround(normal.x * 127.0f));
+                    texel[1] = GLbyte(std::lround(normal.z * 127.0f));
+                }
+            }
+        };
+
+        if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        thread_count = std::max(1u, std::min(thread_count, unsigned(map_height) / 16 + 1));
+
+        std::vector< std::thread > threads;
+
+        for (unsigned thread = 0; thread < thread_count; ++thread)
+        {
+            int first = int(size_t(map_height) *  thread      / thread_count);
+            int last  = int(size_t(map_height) * (thread + 1) / thread_count);
+
+            if (thread + 1 < thread_count) threads.emplace_back(bake_rows, first, last);
+            else                           bake_rows(first, last);
+        }
+
+        for (auto & thread : threads) thread.join();
+    }
+
+    Normal_Map::Normal_Map(const Height_Map & height_map, float width, float depth, float max_height)
+        : width(std::max(height_map.get_width(), 1)), height(std::max(height_map.get_height(), 1))
+    {
+        std::vector< GLbyte > texels;
+
+        if (height_map.is_empty())
+        {
+            texels.assign(2, 0);            // Terreno plano: normal (0, 1, 0)
+        }
+        else
+        {
+            bake(height_map, width, depth, max_height, texels);
+        }
+
+        glGenTextures(1, &texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+
+        // Con mipmaps: a lo lejos se promedian las normales en lugar de parpadear. El terreno no se
+        // repite, asi que en el borde no se mezcla con las normales del borde opuesto.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8_SNORM, this->width, this->height, 0, GL_RG, GL_BYTE, texels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    Normal_Map::~Normal_Map()
+    {
+        glDeleteTextures(1, &texture_id);
+    }
+
+}
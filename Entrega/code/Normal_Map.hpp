@@ -0,0 +1,58 @@
+// Normal_Map.hpp
+// angel.rodriguez@udit.es
+
+#ifndef NORMAL_MAP_HEADER
+#define NORMAL_MAP_HEADER
+
+#include <glad/gl.h>
+#include <vector>
+#include "Height_Map.hpp"
+
+namespace udit
+{
+
+    // Normales del terreno horneadas en una textura a partir del heightmap (un texel por pixel,
+    // normalmente mucha mas resolucion que la malla). El fragment shader las lee en lugar de
+    // interpolar las de los vertices, asi que una malla gruesa conserva el detalle de la luz.
+    //
+    // Como las normales del terreno siempre miran hacia arriba solo se guardan x y z (RG8_SNORM,
+    // 2 bytes por texel); el shader reconstruye y = sqrt(1 - x^2 - z^2).
+
+    class Normal_Map
+    {
+    private:
+
+        GLuint  texture_id;
+        GLsizei width;
+        GLsizei height;
+
+    public:
+
+        // Calcula las normales en la CPU (repartiendo las filas entre hilos) para un terreno de
+        // width x depth unidades de mundo con alturas height_map * max_height. texels recibe
+        // dos valores (x, z) por pixel del heightmap. thread_count = 0 usa todos los hilos.
+        static void bake
+        (
+            const Height_Map & height_map, float width, float depth, float max_height,
+            std::vector< GLbyte > & texels, unsigned thread_count = 0
+        );
+
+        Normal_Map(const Height_Map & height_map, float width, float depth, float max_height);
+       ~Normal_Map();
+
+    private:
+
+        Normal_Map(const Normal_Map & ) = delete;
+        Normal_Map & operator = (const Normal_Map & ) = delete;
+
+    public:
+
+        GLsizei get_width  () const { return width;  }
+        GLsizei get_height () const { return height; }
+        GLuint  get_texture_id () const { return texture_id; }     // GL_TEXTURE_2D
+
+    };
+
+}
+
+#endif
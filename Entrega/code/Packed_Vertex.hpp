@@ -0,0 +1,117 @@
+// Packed_Vertex.hpp
+// angel.rodriguez@udit.es
+
+#ifndef PACKED_VERTEX_HEADER
+#define PACKED_VERTEX_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <half.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace udit
+{
+
+    // Formato de vertice entrelazado y cuantizado (16 bytes) que comparten Terrain y Cube.
+    // Todos los atributos de un vertice estan seguidos, asi que leerlo toca una sola linea de
+    // cache en lugar de una por buffer.
+    //
+    //   location 0: posicion xyz en half (+ un half de relleno para alinear a 8 bytes)
+    //   location 1: uv en unorm16 (la GPU lo ve como vec2 en [0, 1])
+    //   location 2: normal en codificacion octaedrica con 2 x snorm16 (vec2 en [-1, 1] que el
+    //               vertex shader convierte de nuevo a vec3)
+
+    struct Packed_Vertex
+    {
+        half_float::half position[4];
+        GLushort         uv[2];
+        GLshort          normal[2];
+
+        static GLushort pack_unorm16 (float value)
+        {
+            return GLushort(std::lround(std::max(0.0f, std::min(value, 1.0f)) * 65535.0f));
+        }
+
+        static GLshort pack_snorm16 (float value)
+        {
+            return GLshort(std::lround(std::max(-1.0f, std::min(value, 1.0f)) * 32767.0f));
+        }
+
+        // Proyecta la normal sobre el octaedro |x| + |y| + |z| = 1 y lo despliega en el plano
+        // (el hemisferio inferior se dobla sobre las esquinas)
+        static glm::vec2 encode_octahedral (const glm::vec3 & normal)
+        {
+            glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+            glm::vec2 e(n.x, n.z);
+
+            if (n.y < 0.0f)
+            {
+                e = glm::vec2
+                (
+                    (1.0f - std::abs(n.z)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                    (1.0f - std::abs(n.x)) * (n.z >= 0.0f ? 1.0f : -1.0f)
+                );
+            }
+
+            return e;
+        }
+
+        // La misma cuenta que hace el vertex shader
+        static glm::vec3 decode_octahedral (const glm::vec2 & e)
+        {
+            glm::vec3 n(e.x, 1.0f - std::abs(e.x) - std::abs(e.y), e.y);
+
+            if (n.y < 0.0f)
+            {
+                float x = n.x;
+                n.x = (1.0f - std::abs(n.z)) * (x   >= 0.0f ? 1.0f : -1.0f);
+                n.z = (1.0f - std::abs(x  )) * (n.z >= 0.0f ? 1.0f : -1.0f);
+            }
+
+            return glm::normalize(n);
+        }
+
+        void set_uv (float u, float v)
+        {
+            uv[0] = pack_unorm16(u);
+            uv[1] = pack_unorm16(v);
+        }
+
+        void set_normal (const glm::vec3 & value)
+        {
+            glm::vec2 e = encode_octahedral(value);
+
+            normal[0] = pack_snorm16(e.x);
+            normal[1] = pack_snorm16(e.y);
+        }
+
+        void set (const glm::vec3 & position, const glm::vec2 & uv, const glm::vec3 & normal)
+        {
+            this->position[0] = half_float::half(position.x);
+            this->position[1] = half_float::half(position.y);
+            this->position[2] = half_float::half(position.z);
+            this->position[3] = half_float::half(0.0f);
+
+            set_uv    (uv.x, uv.y);
+            set_normal(normal);
+        }
+
+        // Configura los atributos del VAO activo para el GL_ARRAY_BUFFER enlazado
+        static void enable_attributes ()
+        {
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_HALF_FLOAT,     GL_FALSE, sizeof(Packed_Vertex), reinterpret_cast< const void * >(offsetof(Packed_Vertex, position)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE,  sizeof(Packed_Vertex), reinterpret_cast< const void * >(offsetof(Packed_Vertex, uv      )));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_SHORT,          GL_TRUE,  sizeof(Packed_Vertex), reinterpret_cast< const void * >(offsetof(Packed_Vertex, normal  )));
+        }
+    };
+
+    static_assert(sizeof(Packed_Vertex) == 16, "Packed_Vertex debe ocupar 16 bytes");
+
+}
+
+#endif
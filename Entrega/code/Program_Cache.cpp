@@ -0,0 +1,208 @@
+// Program_Cache.cpp
+// angel.rodriguez@udit.es
+
+#include "Program_Cache.hpp"
+#include "Hash.hpp"
+#include "File_System.hpp"
+#include "Mapped_File.hpp"
+#include <SDL3/SDL_video.h>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// GLAD se ha generado para OpenGL 3.3 sin extensiones: las constantes de los binarios de
+// programa (OpenGL 4.1 / ARB_get_program_binary) se definen aqui y las funciones se obtienen
+// en tiempo de ejecucion
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    #define GL_PROGRAM_BINARY_RETRIEVABLE_HINT  0x8257
+    #define GL_PROGRAM_BINARY_LENGTH            0x8741
+    #define GL_NUM_PROGRAM_BINARY_FORMATS       0x87FE
+#endif
+
+namespace udit
+{
+
+    namespace
+    {
+        typedef void (GLAD_API_PTR * Get_Program_Binary_Function)(GLuint program, GLsizei buffer_size, GLsizei * length, GLenum * binary_format, void * binary);
+        typedef void (GLAD_API_PTR * Program_Binary_Function    )(GLuint program, GLenum binary_format, const void * binary, GLsizei length);
+        typedef void (GLAD_API_PTR * Program_Parameteri_Function)(GLuint program, GLenum name, GLint value);
+
+        Get_Program_Binary_Function get_program_binary = nullptr;
+        Program_Binary_Function     program_binary     = nullptr;
+        Program_Parameteri_Function program_parameteri = nullptr;
+
+        uint64_t hash_string(const GLubyte * text, uint64_t hash)
+        {
+            return text ? fnv1a(text, std::strlen(reinterpret_cast< const char * >(text)) + 1, hash) : hash;
+        }
+    }
+
+    Program_Cache::Program_Cache(const std::string & directory)
+        : directory(directory), enabled(false)
+    {
+        // Un binario solo vale para el mismo driver en la misma GPU
+        driver_hash = hash_string(glGetString(GL_VENDOR),   fnv_offset_basis);
+        driver_hash = hash_string(glGetString(GL_RENDERER), driver_hash);
+        driver_hash = hash_string(glGetString(GL_VERSION),  driver_hash);
+
+        if (!get_program_binary)
+        {
+            get_program_binary = reinterpret_cast< Get_Program_Binary_Function >(SDL_GL_GetProcAddress("glGetProgramBinary"));
+            program_binary     = reinterpret_cast< Program_Binary_Function     >(SDL_GL_GetProcAddress("glProgramBinary"));
+            program_parameteri = reinterpret_cast< Program_Parameteri_Function >(SDL_GL_GetProcAddress("glProgramParameteri"));
+        }
+
+        // Algunos drivers exportan las funciones pero no admiten ningun formato
+        GLint format_count = 0;
+
+        if (get_program_binary && program_binary && program_parameteri)
+        {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        }
+
+        enabled = format_count > 0;
+    }
+
+    Program_Cache::Key Program_Cache::make_key(const std::vector< const std::string * > & sources) const
+    {
+        Key key = driver_hash;
+
+        for (const std::string * source : sources)
+        {
+            // Se incluye el tamano para que mover texto de una etapa a otra cambie la clave
+            uint64_t size = source->size();
+            key = fnv1a(&size, sizeof(size), key);
+            key = fnv1a(source->data(), source->size(), key);
+        }
+
+        return key;
+    }
+
+    std::string Program_Cache::file_path(const std::string & name) const
+    {
+        std::string file_name = name;
+
+        for (char & character : file_name)
+        {
+            if (!std::isalnum(static_cast< unsigned char >(character)) && character != '-') character = '_';
+        }
+
+        return directory + file_name + ".udpb";
+    }
+
+    GLuint Program_Cache::load(const std::string & name, Key key) const
+    {
+        if (!enabled) return 0;
+
+        std::string path = file_path(name);
+
+        {
+            Mapped_File file(path);
+
+            if (!file.is_open()) return 0;
+
+            const Header * header = reinterpret_cast< const Header * >(file.get_data());
+
+            bool is_stale = file.get_size() < sizeof(Header)
+                         || std::memcmp(header->magic, "UDPB", 4) != 0 || header->version != version || header->key != key
+                         || file.get_size() < sizeof(Header) + header->binary_size;
+
+            if (!is_stale) return load_binary(file);
+        }
+
+        // Binario de otras fuentes o de otro driver: ya no se va a poder usar. Si el programa
+        // compila, store() escribe el nuevo en su lugar.
+        std::remove(path.c_str());
+
+        return 0;
+    }
+
+    GLuint Program_Cache::load_binary(const Mapped_File & file) const
+    {
+        const Header * header = reinterpret_cast< const Header * >(file.get_data());
+
+        GLuint program_id = glCreateProgram();
+
+        program_binary(program_id, header->binary_format, file.get_data() + sizeof(Header), GLsizei(header->binary_size));
+
+        // El driver puede rechazar un binario que antes aceptaba (otra version del compilador
+        // con la misma cadena de version, por ejemplo): entonces se compila desde el codigo
+        GLint succeeded = GL_FALSE;
+        glGetProgramiv(program_id, GL_LINK_STATUS, &succeeded);
+
+        if (!succeeded)
+        {
+            glDeleteProgram(program_id);
+            return 0;
+        }
+
+        return program_id;
+    }
+
+    void Program_Cache::prepare(GLuint program_id) const
+    {
+        if (enabled) program_parameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    void Program_Cache::store(const std::string & name, Key key, GLuint program_id) const
+    {
+        if (!enabled) return;
+
+        GLint succeeded = GL_FALSE;
+        GLint length    = 0;
+
+        glGetProgramiv(program_id, GL_LINK_STATUS,           &succeeded);
+        glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length   );
+
+        if (!succeeded || length <= 0) return;
+
+        std::vector< char > binary(size_t(length), 0);
+        GLsizei             written = 0;
+        GLenum              format  = 0;
+
+        get_program_binary(program_id, length, &written, &format, binary.data());
+
+        if (written <= 0) return;
+
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "UDPB", 4);
+        header.version       = version;
+        header.key           = key;
+        header.binary_format = uint32_t(format);
+        header.binary_size   = uint32_t(written);
+
+        // Fichero temporal y renombrado, para no dejar un binario a medias
+        std::string path           = file_path(name);
+        std::string temporary_path = path + ".tmp";
+
+        if (!create_parent_directory(path))
+        {
+            std::cerr << "AVISO: No se pudo crear el directorio de la cache de programas " << directory << std::endl;
+            return;
+        }
+
+        {
+            std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+
+            output.write(reinterpret_cast< const char * >(&header), sizeof(header));
+            output.write(binary.data(), written);
+
+            if (!output.good())
+            {
+                std::cerr << "AVISO: No se pudo guardar el programa compilado en " << path << std::endl;
+                output.close();
+                std::remove(temporary_path.c_str());
+                return;
+            }
+        }
+
+        replace_file(temporary_path, path);
+    }
+
+}
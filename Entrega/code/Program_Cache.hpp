@@ -0,0 +1,93 @@
+// Program_Cache.hpp
+// angel.rodriguez@udit.es
+
+#ifndef PROGRAM_CACHE_HEADER
+#define PROGRAM_CACHE_HEADER
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Mapped_File.hpp"
+
+namespace udit
+{
+
+    // Cache en disco de programas ya enlazados (glGetProgramBinary / glProgramBinary, OpenGL 4.1
+    // o ARB_get_program_binary). Cada programa tiene un solo fichero en el directorio de la cache,
+    // con su nombre, y dentro una clave con el hash de sus fuentes y del driver (fabricante,
+    // renderer y version). Si la clave no coincide (se ha cambiado un shader o el driver) el
+    // binario se borra y al volver a enlazar se escribe en el mismo fichero, asi que no se
+    // acumulan binarios antiguos por mucho que se recarguen los shaders.
+    //
+    // Uso al crear un programa (ver Shader_Compiler):
+    //   key = cache.make_key(sources);
+    //   program = cache.load(name, key);        // 0 si no hay binario o el driver lo rechaza
+    //   si es 0: compilar, cache.prepare(program), enlazar y cache.store(name, key, program)
+    //
+    // Si el driver no ofrece binarios la cache queda desactivada: load devuelve siempre 0 y
+    // prepare y store no hacen nada.
+
+    class Program_Cache
+    {
+    public:
+
+        typedef uint64_t Key;
+
+        static const uint32_t version = 1;
+
+    private:
+
+        struct Header
+        {
+            char     magic[4];
+            uint32_t version;
+            Key      key;                       // Comprueba que el fichero es el esperado
+            uint32_t binary_format;             // Formato que devolvio glGetProgramBinary
+            uint32_t binary_size;
+        };
+
+    private:
+
+        std::string directory;                  // Prefijo de los ficheros (con la barra final; se crea al guardar el primero)
+        Key         driver_hash;
+        bool        enabled;
+
+    public:
+
+        explicit Program_Cache(const std::string & directory);
+
+    private:
+
+        Program_Cache(const Program_Cache & ) = delete;
+        Program_Cache & operator = (const Program_Cache & ) = delete;
+
+    public:
+
+        bool is_enabled () const { return enabled; }
+
+        // Clave de un programa: todas sus fuentes en orden de etapa, mas el driver actual
+        Key  make_key   (const std::vector< const std::string * > & sources) const;
+
+        // Crea el programa a partir del binario guardado. Devuelve 0 si no esta o no vale.
+        GLuint load     (const std::string & name, Key key) const;
+
+        // Pide al driver que conserve el binario (hay que llamarlo antes de glLinkProgram)
+        void prepare    (GLuint program_id) const;
+
+        // Guarda el binario de un programa enlazado correctamente
+        void store      (const std::string & name, Key key, GLuint program_id) const;
+
+    private:
+
+        // Fichero del programa: el nombre sin los caracteres que no valen en una ruta
+        std::string file_path   (const std::string & name) const;
+
+        // Crea el programa con el binario de un fichero ya validado
+        GLuint      load_binary (const Mapped_File & file) const;
+
+    };
+
+}
+
+#endif
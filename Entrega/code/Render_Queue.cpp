@@ -0,0 +1,192 @@
+// Render_Queue.cpp
+// angel.rodriguez@udit.es
+
+#include "Render_Queue.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace udit
+{
+
+    namespace
+    {
+        // Capas (los 2 bits altos de la clave)
+        constexpr uint64_t opaque_layer      = 0;
+        constexpr uint64_t transparent_layer = 1;
+
+        constexpr unsigned layer_shift       = 62;
+
+        constexpr unsigned program_bits      = 10;
+        constexpr unsigned material_bits     = 12;
+        constexpr unsigned vao_bits          = 12;
+        constexpr unsigned distance_bits     = 24;
+
+        constexpr uint64_t max_distance      = (uint64_t(1) << distance_bits) - 1;
+
+        // Si hay mas estados distintos de los que caben en su campo, los que sobran comparten el
+        // ultimo numero: el orden sigue siendo correcto, solo se agrupan peor
+        template< typename TYPE >
+        uint64_t intern (std::vector< TYPE > & values, const TYPE & value, unsigned bits)
+        {
+            auto found = std::find (values.begin (), values.end (), value);
+
+            size_t index = size_t(found - values.begin ());
+
+            if (found == values.end ()) values.push_back (value);
+
+            return std::min< uint64_t > (index, (uint64_t(1) << bits) - 1);
+        }
+    }
+
+    Render_Queue::Draw_Packet::Draw_Packet()
+    :
+        program      (nullptr),
+        vao_id       (0),
+        textures     (),
+        texture_count(0),
+        blend        (false),
+        depth_write  (true),
+        center       (0.f, 0.f, 0.f)
+    {
+    }
+
+    void Render_Queue::Draw_Packet::add_texture(GLuint unit, GLenum target, GLuint id, GLuint sampler)
+    {
+        assert(texture_count < max_textures);
+
+        textures[texture_count++] = { unit, target, id, sampler };
+    }
+
+    Render_Queue::Render_Queue(GL_State & gl_state)
+    :
+        gl_state       (gl_state),
+        camera_location(0.f, 0.f, 0.f),
+        far_distance   (1.f)
+    {
+    }
+
+    void Render_Queue::begin(const glm::vec3 & camera_location, float far_distance)
+    {
+        this->camera_location = camera_location;
+        this->far_distance    = far_distance > 0.f ? far_distance : 1.f;
+
+        packets  .clear ();
+        items    .clear ();
+        programs .clear ();
+        materials.clear ();
+        vaos     .clear ();
+    }
+
+    void Render_Queue::submit(const Draw_Packet & packet)
+    {
+        assert(packet.program && packet.draw);
+
+        items.push_back ({ make_key (packet), uint32_t(packets.size ()) });
+
+        packets.push_back (packet);
+    }
+
+    Render_Queue::Sort_Key Render_Queue::make_key(const Draw_Packet & packet)
+    {
+        uint64_t material = hash_combine (fnv_offset_basis, uint64_t(packet.blend) << 1 | uint64_t(packet.depth_write));
+
+        for (unsigned index = 0; index < packet.texture_count; ++index)
+        {
+            const Texture & texture = packet.textures[index];
+
+            material = hash_combine (material, uint64_t(texture.unit) << 32 | texture.target);
+            material = hash_combine (material, uint64_t(texture.sampler) << 32 | texture.id);
+        }
+
+        uint64_t program_number  = intern (programs,  static_cast< const Shader_Program * >(packet.program), program_bits );
+        uint64_t material_number = intern (materials, material,                                               material_bits);
+        uint64_t vao_number      = intern (vaos,      packet.vao_id,                                          vao_bits     );
+
+        float    distance        = std::min (glm::length (packet.center - camera_location) / far_distance, 1.f);
+        uint64_t depth           = uint64_t(distance * float(max_distance));
+
+        uint64_t state = program_number << (material_bits + vao_bits) | material_number << vao_bits | vao_number;
+
+        if (!packet.blend)
+        {
+            // Opacos: primero el estado y luego la distancia de delante hacia atras
+            return opaque_layer << layer_shift | state << distance_bits | depth;
+        }
+
+        // Transparentes: la distancia de atras hacia delante manda sobre el estado
+        unsigned state_bits = program_bits + material_bits + vao_bits;
+
+        return transparent_layer << layer_shift | (max_distance - depth) << state_bits | state;
+    }
+
+    void Render_Queue::radix_sort()
+    {
+        // LSD de 8 pasadas de 8 bits. Cada pasada es estable, asi que los paquetes con la misma
+        // clave se dibujan en el orden en que se enviaron.
+        size_t count = items.size ();
+
+        scratch.resize (count);
+
+        for (unsigned shift = 0; shift < 64; shift += 8)
+        {
+            size_t histogram[256] = {};
+
+            for (const Sort_Item & item : items) ++histogram[(item.key >> shift) & 0xFF];
+
+            // Si todas las claves tienen el mismo byte la pasada no cambiaria nada (pasa mucho con
+            // los campos altos cuando hay pocos estados)
+            if (histogram[(items[0].key >> shift) & 0xFF] == count) continue;
+
+            size_t offset = 0;
+
+            for (size_t & bucket : histogram)
+            {
+                size_t bucket_size = bucket;
+                bucket  = offset;
+                offset += bucket_size;
+            }
+
+            for (const Sort_Item & item : items) scratch[histogram[(item.key >> shift) & 0xFF]++] = item;
+
+            items.swap (scratch);
+        }
+    }
+
+    void Render_Queue::flush()
+    {
+        if (items.empty ()) return;
+
+        radix_sort ();
+
+        for (const Sort_Item & item : items)
+        {
+            Draw_Packet & packet = packets[item.packet_index];
+
+            gl_state.use_program (packet.program->get_id ());
+
+            gl_state.set_blend (packet.blend);
+
+            if (packet.blend) gl_state.set_blend_function (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+            gl_state.set_depth_write (packet.depth_write);
+
+            for (unsigned index = 0; index < packet.texture_count; ++index)
+            {
+                const Texture & texture = packet.textures[index];
+
+                gl_state.bind_texture (texture.unit, texture.target, texture.id);
+                gl_state.bind_sampler (texture.unit, texture.sampler);
+            }
+
+            if (packet.vao_id) gl_state.bind_vertex_array (packet.vao_id);
+
+            packet.draw (*packet.program);
+        }
+
+        gl_state.set_blend          (false);
+        gl_state.set_depth_write    (true );
+        gl_state.set_active_texture (0    );
+    }
+
+}
@@ -0,0 +1,127 @@
+// Render_Queue.hpp
+// angel.rodriguez@udit.es
+
+#ifndef RENDER_QUEUE_HEADER
+#define RENDER_QUEUE_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "GL_State.hpp"
+#include "Shader_Program.hpp"
+
+namespace udit
+{
+
+    // Cola de dibujo de un frame. Cada objeto deja un paquete con el estado que necesita
+    // (programa, VAO, texturas, mezcla y escritura de profundidad) y la llamada que lo dibuja;
+    // al final se ordenan todos por una clave de 64 bits y se envian a traves de GL_State, que
+    // descarta los cambios que no cambian nada (el orden hace que sean la mayoria).
+    //
+    // Clave (de mayor a menor peso):
+    //
+    //   opacos:       capa (2) | programa (10) | texturas y estado (12) | VAO (12) | distancia (24)
+    //   transparentes: capa (2) | distancia invertida (24) | programa (10) | texturas y estado (12) | VAO (12)
+    //
+    // Los opacos quedan agrupados por estado y, dentro de cada grupo, de delante hacia atras (el
+    // test de profundidad descarta antes los fragmentos tapados). Los transparentes van de atras
+    // hacia delante, que es lo que exige la mezcla, y solo se agrupan por estado si empatan.
+    //
+    // Programas, conjuntos de texturas y VAOs se numeran en el orden en que aparecen en el frame,
+    // asi que la clave no depende de los ids de OpenGL.
+
+    class Render_Queue
+    {
+    public:
+
+        typedef uint64_t Sort_Key;
+
+        static const unsigned max_textures = 4;
+
+        struct Texture
+        {
+            GLuint unit;                        // 0, 1, 2... (no GL_TEXTUREi)
+            GLenum target;                      // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY...
+            GLuint id;
+            GLuint sampler;                     // 0 = los parametros de la propia textura
+        };
+
+        struct Draw_Packet
+        {
+            Shader_Program * program;
+            GLuint           vao_id;            // 0 si lo activa la propia llamada de dibujo
+            Texture          textures[max_textures];
+            unsigned         texture_count;
+            bool             blend;             // Mezcla con alfa (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA): capa transparente
+            bool             depth_write;
+            glm::vec3        center;            // En el mundo, para ordenar por distancia a la camara
+
+            // Sube los uniforms propios del objeto y dibuja. Con vao_id 0 activa sus propios VAO y
+            // texturas, siempre a traves del mismo GL_State que la cola.
+            std::function< void (Shader_Program &) > draw;
+
+            Draw_Packet();
+
+            void add_texture (GLuint unit, GLenum target, GLuint id, GLuint sampler = 0);
+        };
+
+    private:
+
+        struct Sort_Item
+        {
+            Sort_Key key;
+            uint32_t packet_index;
+        };
+
+    private:
+
+        GL_State                 & gl_state;
+
+        std::vector< Draw_Packet > packets;
+        std::vector< Sort_Item   > items;
+        std::vector< Sort_Item   > scratch;              // Destino de cada pasada del radix sort
+
+        // Numeracion de los estados del frame (la posicion en el vector es el numero)
+        std::vector< const Shader_Program * > programs;
+        std::vector< uint64_t >               materials;  // Hash de texturas, mezcla y profundidad
+        std::vector< GLuint >                 vaos;
+
+        glm::vec3 camera_location;
+        float     far_distance;
+
+    public:
+
+        // El estado de OpenGL tiene que vivir tanto como la cola
+        explicit Render_Queue(GL_State & gl_state);
+
+    private:
+
+        Render_Queue(const Render_Queue & ) = delete;
+        Render_Queue & operator = (const Render_Queue & ) = delete;
+
+    public:
+
+        // Empieza un frame (vacia la cola). La distancia se mide desde la camara y se cuantiza
+        // hasta far_distance (lo que quede mas lejos se ordena como si estuviera ahi).
+        void begin  (const glm::vec3 & camera_location, float far_distance);
+
+        void submit (const Draw_Packet & packet);
+
+        // Ordena y dibuja todo lo enviado. Deja la mezcla desactivada, la escritura de profundidad
+        // activada y la unidad de textura 0 activa.
+        void flush  ();
+
+        size_t   get_packet_count  () const { return packets.size (); }
+
+    private:
+
+        Sort_Key make_key   (const Draw_Packet & packet);
+        void     radix_sort ();
+
+    };
+
+}
+
+#endif
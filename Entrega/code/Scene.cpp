@@ -2,10 +2,13 @@
 // angel.rodriguez@udit.es
 
 #include "Scene.hpp"
+#include "File_System.hpp"
+#include "Height_Database.hpp"
 #include <glm.hpp>                          
 #include <gtc/matrix_transform.hpp>         
 #include <gtc/type_ptr.hpp>                 
 #include <SOIL2.h>
+#include <cmath>
 #include <string>
 #include <iostream>
 #include <vector>
@@ -14,118 +17,92 @@
 namespace udit
 {
 
-    // SHADERS ESCENA 3D
-    const std::string Scene::vertex_shader_code =
-        "#version 330\n"
-        "layout (location = 0) in vec3 a_position;\n"
-        "layout (location = 1) in vec2 a_tex_coord;\n"
-        "layout (location = 2) in vec3 a_normal;\n"
-        "uniform mat4 u_model_view;\n"
-        "uniform mat4 u_projection;\n"
-        "out vec2 v_tex_coord;\n"
-        "out vec3 v_normal;\n"
-        "out vec3 v_frag_pos;\n"
-        "void main() {\n"
-        "    v_tex_coord = a_tex_coord;\n"
-        "    // IMPORTANTE: Transformamos la normal al 'Espacio de la Vista' (View Space)\n"
-        "    // Esto permite que la luz reaccione correctamente cuando la cmara se mueve.\n"
-        "    v_normal = mat3(u_model_view) * a_normal;\n"
-        "    v_frag_pos = vec3(u_model_view * vec4(a_position, 1.0));\n"
-        "    gl_Position = u_projection * u_model_view * vec4(a_position, 1.0);\n"
-        "}";
-
-    const std::string Scene::fragment_shader_code =
-        "#version 330\n"
-        "uniform sampler2D u_texture;\n"
-        "uniform vec3 u_light_dir;\n"     // Direccin de donde viene la luz
-        "uniform vec3 u_light_color;\n"   // Color de la luz (Blanco/Amarillo)
-        "uniform vec3 u_ambient_color;\n" // Luz base para que nada sea negro puro
-        "uniform float u_alpha; \n"       // Transparencia (1.0 = opaco, <1.0 = transparente)
-        "in vec2 v_tex_coord;\n"
-        "in vec3 v_normal;\n"
-        "in vec3 v_frag_pos;\n"
-        "out vec4 f_color;\n"
-        "void main() {\n"
-        "    vec4 tex_color = texture(u_texture, v_tex_coord);\n"
-        "    vec3 norm = normalize(v_normal);\n"
-        "    vec3 light_dir = normalize(-u_light_dir);\n"
-        "    float diff = max(dot(norm, light_dir), 0.0);\n"
-        "    vec3 diffuse = diff * u_light_color;\n"
-        "    vec3 ambient = u_ambient_color;\n"
-        "    vec3 result = (ambient + diffuse) * tex_color.rgb;\n"
-        "    f_color = vec4(result, tex_color.a * u_alpha);\n"
-        "}";
-
-    // SHADERS POSTPROCESO
-
-    // Vertex Shader: Simplemente dibuja un cuadrado que cubre toda la pantalla (-1 a 1)
-    const std::string Scene::post_vs_code =
-        "#version 330 core\n"
-        "layout (location = 0) in vec2 aPos;\n"
-        "layout (location = 1) in vec2 aTexCoords;\n"
-        "out vec2 TexCoords;\n"
-        "void main() {\n"
-        "    gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);\n"
-        "    TexCoords = aTexCoords;\n"
-        "}";
-
-    // Fragment Shader
-    const std::string Scene::post_fs_code =
-        "#version 330 core\n"
-        "out vec4 FragColor;\n"
-        "in vec2 TexCoords;\n"
-        "uniform sampler2D screenTexture;\n" // La imagen renderizada en el paso 1
-        "void main() {\n"
-        "    vec4 col = texture(screenTexture, TexCoords);\n"
-
-        "    // Filtro SEPIA: Multiplicacion canales RGB por matriz de conversin estndar\n"
-        "    float r = dot(col.rgb, vec3(0.393, 0.769, 0.189));\n"
-        "    float g = dot(col.rgb, vec3(0.349, 0.686, 0.168));\n"
-        "    float b = dot(col.rgb, vec3(0.272, 0.534, 0.131));\n"
-        "    vec3 sepia = vec3(r, g, b);\n"
-
-        "    // Oscurecer bordes\n"
-        "    // Calculo distancia al centro multiplicando coordenadas\n"
-        "    vec2 uv = TexCoords * (1.0 - TexCoords.yx);\n"
-        "    float vig = uv.x * uv.y * 15.0;\n"
-        "    vig = pow(vig, 0.25);\n"
-        "    FragColor = vec4(sepia * vig, 1.0);\n"
-        "}";
+    namespace
+    {
+        // Ficheros generados al ejecutar: programas enlazados, mallas de terreno y bases de datos
+        // de alturas (fuera de shared/assets, que solo tiene los originales)
+        const std::string cache_directory = "../../cache/";
+
+        const std::string heightmap_path = "../../../shared/assets/height-map.png";
+
+        // Devuelve la base de datos troceada que corresponde a la imagen, creandola (a partir de
+        // la imagen ya cargada) la primera vez o si la imagen ha cambiado.
+        std::string height_database_path(const std::string& image_path, const Height_Map& image)
+        {
+            std::string database_path = cache_directory + file_stem(image_path) + ".udht";
 
+            Height_Database::update(image_path, image, database_path);
+
+            return database_path;
+        }
+
+        // Materiales del suelo: tierra en lo llano, roca en las pendientes y nieve en lo alto
+        std::vector< Terrain_Splatting::Material > terrain_materials()
+        {
+            return
+            {
+                { "../../../shared/assets/ground.jpg", glm::vec3(0.35f, 0.45f, 0.2f ), 0.00f, 0.60f, 0.00f, 0.06f },
+                { "../../../shared/assets/Stone.jpg",  glm::vec3(0.45f, 0.42f, 0.4f ), 0.00f, 1.00f, 0.06f, 1.00f },
+                { "",                                  glm::vec3(0.95f, 0.95f, 1.0f ), 0.60f, 1.00f, 0.00f, 0.15f },
+            };
+        }
+    }
 
     // CONSTRUCTOR & INIT
 
-    Scene::Scene(int width, int height)
+    Scene::Scene(int width, int height, const Window::OpenGL_Context_Settings& context_settings)
         : // Inicializacion objetos
-        skybox("../../../shared/assets/sky-cube-map-"),
-        terrain("../../../shared/assets/height-map.png", 200.0f, 200.0f, 100, 100, 15.0f),
+        program_cache(cache_directory),
+        shader_compiler(&program_cache),
+        shader_library(shader_compiler, "../../shaders/"),
+        skybox("../../../shared/assets/sky-cube-map-", shader_library),
+        height_map(heightmap_path),
+        terrain(heightmap_path, height_map, 200.0f, 200.0f, 100, 100, 15.0f, Terrain::CPU_DISPLACEMENT, Terrain::TRIANGLE_STRIPS, cache_directory),
+        tessellation_supported(context_settings.version_major >= 4 && Tessellated_Terrain::is_supported()),
+        terrain_normal_map(height_map, 200.0f, 200.0f, 15.0f),
+        terrain_splatting(height_map, 200.0f, 200.0f, 15.0f, terrain_materials()),
         cube(5.0f),
+        render_queue(gl_state),
         width(width), height(height)
     {
-        glEnable(GL_DEPTH_TEST); // Activar Z-Buffer
+        gl_state.set_depth_test(true); // Activar Z-Buffer
 
-        // Configuracin inicial de cmara
+        // Configuración inicial de cámara
         angle_around_x = 0.4f; angle_around_y = 0.0f;
         angle_delta_x = 0.0f;  angle_delta_y = 0.0f;
         pointer_pressed = false;
+        press_pointer_x = press_pointer_y = 0.0f;
+        cube_location = glm::vec3(0.0f, 40.0f, 0.0f);
         camera.set_location(0.0f, 30.0f, 0.0f);
 
         move_forward = move_backward = move_left = move_right = move_up = move_down = false;
         camera_speed = 0.5f;
+        camera_ground_clearance = 1.5f;
+
+        brush_mode = NO_BRUSH;
+        brush_radius = 8.0f;
+        brush_strength = 0.15f;
+
+        terrain_mode = CHUNKED_TERRAIN;
+        use_normal_map = true;
+        terrain_edited = false;
+        use_fog = false;
+
+        // COMPILACIÓN DE SHADERS (ficheros de Entrega/shaders)
+        // Se envían todos ahora y el driver los compila mientras se cargan las texturas. Cada uno
+        // se recoge la primera vez que se usa, así que los modos de terreno que no se llegan a ver
+        // no retrasan el arranque.
+
+        // Las permutaciones con las opciones iniciales: el cubo y el terreno en cada modo (los
+        // terrenos reutilizan la iluminación de la escena con su propio vertex shader). Las demás
+        // se crean la primera vez que se cambia de opción.
+        get_lit_program(CHUNKED_TERRAIN, get_cube_features());
+        for (int mode = 0; mode < TERRAIN_MODE_COUNT; ++mode) {
+            get_lit_program(Terrain_Mode(mode), get_terrain_features(Terrain_Mode(mode)));
+        }
 
-        // COMPILACIN DE SHADERS
-        GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-        const char* vs_c = vertex_shader_code.c_str(); glShaderSource(vs, 1, &vs_c, nullptr); glCompileShader(vs);
-        GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-        const char* fs_c = fragment_shader_code.c_str(); glShaderSource(fs, 1, &fs_c, nullptr); glCompileShader(fs);
-
-        program_id = glCreateProgram();
-        glAttachShader(program_id, vs); glAttachShader(program_id, fs); glLinkProgram(program_id);
-
-        // IDs de las variables uniformes
-        model_view_matrix_id = glGetUniformLocation(program_id, "u_model_view");
-        projection_matrix_id = glGetUniformLocation(program_id, "u_projection");
-        glDeleteShader(vs); glDeleteShader(fs);
+        post_program_id = 0;
+        post_program = shader_library.add("post-proceso", { { GL_VERTEX_SHADER, "post.vert" }, { GL_FRAGMENT_SHADER, "post.frag" } });
 
         // CARGA DE TEXTURAS
         there_is_texture = false;
@@ -134,8 +111,9 @@ namespace udit
         if (px) {
             glGenTextures(1, &texture_id);
             glBindTexture(GL_TEXTURE_2D, texture_id);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            // Se repite para el terreno con clipmaps, que no tiene bordes
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, px);
@@ -161,8 +139,10 @@ namespace udit
 
         // INICIALIZAR POST-PROCESO
         init_framebuffer(width, height);    // Crear pantalla virtual
-        init_screen_quad();                 // Crear rectngulo de pantalla
-        compile_postprocess_shader();       // Compilar shader de efectos
+        init_screen_quad();                 // Crear rectángulo de pantalla
+
+        // Las texturas y los VAOs se han creado sin pasar por gl_state
+        gl_state.forget_bindings();
 
         resize(width, height);
     }
@@ -182,7 +162,7 @@ namespace udit
         glGenFramebuffers(1, &fbo_id);
         glBindFramebuffer(GL_FRAMEBUFFER, fbo_id);
 
-        // Aqu es donde OpenGL dibuja la escena 3D
+        // Aquí es donde OpenGL dibuja la escena 3D
         glGenTextures(1, &fbo_texture_id);
         glBindTexture(GL_TEXTURE_2D, fbo_texture_id);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
@@ -196,7 +176,7 @@ namespace udit
         glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo_id);
 
-        // Verificacin de errores
+        // Verificación de errores
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
             std::cerr << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
 
@@ -216,7 +196,7 @@ namespace udit
              1.0f,  1.0f,  1.0f, 1.0f
         };
 
-        // Geometra a la GPU
+        // Geometría a la GPU
         glGenVertexArrays(1, &screen_vao_id);
         glGenBuffers(1, &screen_vbo_id);
         glBindVertexArray(screen_vao_id);
@@ -227,22 +207,107 @@ namespace udit
         glEnableVertexAttribArray(1); glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     }
 
-    void Scene::compile_postprocess_shader()
+    Scene::Lit_Program& Scene::get_lit_program(Terrain_Mode vertex_shader, unsigned features)
+    {
+        unsigned key = unsigned(vertex_shader) << LIT_FEATURE_COUNT | features;
+
+        auto found = lit_programs.find(key);
+        if (found != lit_programs.end()) return found->second;
+
+        // Cada característica activa se convierte en un #define de scene.frag
+        static const char* const feature_defines[LIT_FEATURE_COUNT] = { "ALPHA_BLENDING", "LIGHTING", "NORMAL_MAPPING", "FOG", "SPLATTING" };
+
+        std::vector<std::string> defines;
+        std::string variant;
+        for (unsigned feature = 0; feature < LIT_FEATURE_COUNT; ++feature) {
+            if (features & (1u << feature)) {
+                defines.push_back(feature_defines[feature]);
+                variant += variant.empty() ? " [" : " ";
+                variant += feature_defines[feature];
+            }
+        }
+        if (!variant.empty()) variant += "]";
+
+        Lit_Program& lit_program = lit_programs[key];
+
+        switch (vertex_shader)
+        {
+        case CDLOD_TERRAIN:
+            lit_program.program = shader_library.add("terreno CDLOD" + variant, { { GL_VERTEX_SHADER, "cdlod_terrain.vert" }, { GL_FRAGMENT_SHADER, "scene.frag" } }, defines);
+            break;
+        case GPU_TERRAIN:
+            lit_program.program = shader_library.add("terreno en GPU" + variant, { { GL_VERTEX_SHADER, "terrain_displacement.vert" }, { GL_FRAGMENT_SHADER, "scene.frag" } }, defines);
+            break;
+        case CLIPMAP_TERRAIN:
+            // Sus coordenadas de textura se repiten con el mundo (ver baked_uv en scene.frag)
+            defines.push_back("TILED_TERRAIN");
+            lit_program.program = shader_library.add("terreno con clipmaps" + variant, { { GL_VERTEX_SHADER, "clipmap_terrain.vert" }, { GL_FRAGMENT_SHADER, "scene.frag" } }, defines);
+            break;
+        case TESSELLATED_TERRAIN:
+            // Sin contexto 4.x no hay programa (el modo se salta)
+            lit_program.program = !tessellation_supported ? -1 : shader_library.add("terreno teselado" + variant,
+                { { GL_VERTEX_SHADER, "tessellated_terrain.vert" }, { GL_TESS_CONTROL_SHADER, "tessellated_terrain.tesc" },
+                  { GL_TESS_EVALUATION_SHADER, "tessellated_terrain.tese" }, { GL_FRAGMENT_SHADER, "scene.frag" } }, defines);
+            break;
+        default:
+            lit_program.program = shader_library.add("escena" + variant, { { GL_VERTEX_SHADER, "scene.vert" }, { GL_FRAGMENT_SHADER, "scene.frag" } }, defines);
+            break;
+        }
+
+        return lit_program;
+    }
+
+    unsigned Scene::get_terrain_features(Terrain_Mode mode) const
     {
-        GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-        const char* vs_c = post_vs_code.c_str(); glShaderSource(vs, 1, &vs_c, nullptr); glCompileShader(vs);
-        GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-        const char* fs_c = post_fs_code.c_str(); glShaderSource(fs, 1, &fs_c, nullptr); glCompileShader(fs);
-        post_program_id = glCreateProgram();
-        glAttachShader(post_program_id, vs); glAttachShader(post_program_id, fs); glLinkProgram(post_program_id);
-        glDeleteShader(vs); glDeleteShader(fs);
+        // Opaco. El clipmap repite el mundo con otro origen y usa sus normales por vértice.
+        unsigned features = LIGHTING;
+        if (use_normal_map && mode != CLIPMAP_TERRAIN) features |= NORMAL_MAPPING;
+        if (terrain_splatting.get_material_count() > 0) features |= SPLATTING;
+        if (use_fog) features |= FOG;
+        return features;
+    }
+
+    unsigned Scene::get_cube_features() const
+    {
+        return ALPHA_BLENDING | LIGHTING | (use_fog ? unsigned(FOG) : 0u);
+    }
+
+    Shader_Program& Scene::get_lit_shader(Lit_Program& lit_program)
+    {
+        GLuint program_id;
+
+        if (!shader_library.take(lit_program.program, program_id)) return *lit_program.shader;
+
+        // El programa anterior (si lo había) se borra al sustituirlo
+        Shader_Program* shader = new Shader_Program(program_id);
+        lit_program.shader.reset(shader);
+
+        lit_program.model_view_id      = shader->get_uniform_id("u_model_view");
+        lit_program.alpha_id           = shader->get_uniform_id("u_alpha");
+        lit_program.material_count_id  = shader->get_uniform_id("u_material_count");
+        lit_program.material_tiling_id = shader->get_uniform_id("u_material_tiling");
+
+        // La cámara y la luz las lee del uniform buffer común (se escribe una vez por frame)
+        Frame_Uniforms::bind_block(program_id);
+
+        // Unidades fijas de las texturas del terreno (los samplers de distinto tipo no pueden
+        // compartir unidad y la 0 es la de u_texture). Se asignan una sola vez.
+        gl_state.use_program(program_id);
+        shader->set(shader->get_uniform_id("u_normal_map"), 2);
+        shader->set(shader->get_uniform_id("u_materials"), 3);
+        shader->set(shader->get_uniform_id("u_splat_weights"), 4);
+
+        return *shader;
     }
 
     // UPDATE & RENDER
 
     void Scene::update()
     {
-        // Lgica de Rotacin de cmara basada en el ratn
+        // Shaders modificados en disco: se recompilan mientras la escena sigue funcionando
+        shader_library.reload_changed();
+
+        // Lógica de Rotación de cámara basada en el ratón
         angle_around_x += angle_delta_x;
         angle_around_y += angle_delta_y;
         if (angle_around_x < -1.5f) angle_around_x = -1.5f; else if (angle_around_x > 1.5f) angle_around_x = 1.5f;
@@ -256,7 +321,7 @@ namespace udit
         camera.set_target(loc.x, loc.y, loc.z - 1.0f);
         camera.rotate(cam_rot);
 
-        // Lgica de Movimiento WASD
+        // Lógica de Movimiento WASD
         glm::vec3 f = glm::normalize(glm::vec3(camera.get_target()) - glm::vec3(camera.get_location()));
         glm::vec3 r = glm::normalize(glm::cross(f, glm::vec3(0, 1, 0)));
         glm::vec3 m(0);
@@ -265,74 +330,151 @@ namespace udit
         if (move_up) m += glm::vec3(0, 1, 0); if (move_down) m -= glm::vec3(0, 1, 0);
         if (glm::length(m) > 0) camera.move(m * camera_speed);
 
-        // Animacin: Rotar el cubo
+        // La cámara no puede bajar del suelo mientras esté sobre el terreno
+        loc = camera.get_location();
+        if (terrain.get_height_field().contains(loc.x, loc.z)) {
+            float ground = terrain.height_at(loc.x, loc.z) + camera_ground_clearance;
+            if (loc.y < ground) camera.move(glm::vec3(0, ground - loc.y, 0));
+        }
+
+        // Edición: mientras se arrastra con un pincel activo se esculpe el terreno bajo el cursor
+        // (solo la malla por trozos tiene los vértices en la CPU)
+        glm::vec3 brush_point;
+        if (brush_mode != NO_BRUSH && pointer_pressed && terrain_mode == CHUNKED_TERRAIN && pick_terrain(last_pointer_x, last_pointer_y, brush_point)) {
+            // El normal map horneado ya no corresponde al terreno editado: se vuelve a las normales por vértice
+            if (terrain.apply_brush(brush_point.x, brush_point.z, brush_radius, brush_mode == RAISE_BRUSH ? brush_strength : -brush_strength)) {
+                use_normal_map = false;
+                terrain_edited = true;
+            }
+        }
+
+        // Animación: Rotar el cubo
         cube_angle += 0.01f;
     }
 
     void Scene::render()
     {
+        // Todos los cambios de estado pasan por gl_state, asi que lo que recuerda sigue valiendo
+        // de un frame al siguiente
+        gl_state.begin_frame();
+
         // PASE 1: PINTAR LA ESCENA EN EL FRAMEBUFFER
         // Redirigir el renderizado a memoria
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo_id);
+        gl_state.bind_framebuffer(fbo_id);
 
-        glEnable(GL_DEPTH_TEST);
+        gl_state.set_depth_test(true);
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Render Skybox
-        glDepthMask(GL_FALSE); // Desactivar escritura en Depth
-        skybox.render(camera);
-        glDepthMask(GL_TRUE);
-
-        // --- Render Objetos 3D ---
-        glUseProgram(program_id);
-
+        // Cámara y luz del frame: se suben una sola vez y las leen todos los programas
         glm::mat4 view = camera.get_transform_matrix_inverse();
         glm::mat4 proj = camera.get_projection_matrix();
-
-        // Configuracin de Luz
         glm::vec3 light_dir_world = glm::vec3(0.5f, -1.0f, 0.5f);
-        glm::vec3 light_dir_view = glm::vec3(view * glm::vec4(light_dir_world, 0.0f));
 
-        glUniform3fv(glGetUniformLocation(program_id, "u_light_dir"), 1, glm::value_ptr(light_dir_view));
-        glUniform3f(glGetUniformLocation(program_id, "u_light_color"), 1.0f, 0.95f, 0.9f);
-        glUniform3f(glGetUniformLocation(program_id, "u_ambient_color"), 0.2f, 0.2f, 0.3f);
-        glUniformMatrix4fv(projection_matrix_id, 1, GL_FALSE, glm::value_ptr(proj));
+        Frame_Uniforms::Data frame;
+        frame.view            = view;
+        frame.projection      = proj;
+        frame.view_projection = proj * view;
+        frame.light_dir       = view * glm::vec4(light_dir_world, 0.0f);
+        frame.light_color     = glm::vec4(1.0f, 0.95f, 0.9f, 1.0f);
+        frame.ambient_color   = glm::vec4(0.2f, 0.2f, 0.3f, 1.0f);
+        frame.fog             = glm::vec4(0.55f, 0.6f, 0.7f, 0.012f);
+        frame_uniforms.update(frame);
 
-        // Render Terreno
-        glUniform1f(glGetUniformLocation(program_id, "u_alpha"), 1.0f);
-        glUniformMatrix4fv(model_view_matrix_id, 1, GL_FALSE, glm::value_ptr(view));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture_id);
-        terrain.render();
+        // Render Skybox (sin escribir en el Z-buffer)
+        skybox.render(gl_state);
+
+        // --- Render Objetos 3D ---
+        // Cada objeto deja un paquete en la cola, que los ordena por estado (opacos) y por
+        // distancia (transparentes al final, de atrás hacia delante) antes de dibujarlos
+        glm::vec3 camera_location(camera.get_location());
+        render_queue.begin(camera_location, camera.get_far_z());
+
+        // Terreno (cada modo tiene su propio vertex shader, salvo el de trozos, y la permutación
+        // de scene.frag con lo que necesita: opaco, con su normal map y sus materiales). Sus
+        // render activan sus propios VAOs y la textura de alturas, así que el paquete no lleva VAO.
+        unsigned terrain_features = get_terrain_features(terrain_mode);
+        Lit_Program& terrain_program = get_lit_program(terrain_mode, terrain_features);
+
+        Render_Queue::Draw_Packet terrain_packet;
+        terrain_packet.program = &get_lit_shader(terrain_program);
+        terrain_packet.center  = camera_location; // Rodea a la cámara: siempre el más cercano
+
+        // Normal map horneado. La unidad 1 es la de las alturas de los terrenos desplazados en la GPU.
+        if (terrain_features & NORMAL_MAPPING) terrain_packet.add_texture(2, GL_TEXTURE_2D, terrain_normal_map.get_texture_id());
+
+        // Materiales mezclados con el splat map: siempre las mismas dos texturas array y una sola llamada
+        if (terrain_features & SPLATTING) {
+            terrain_packet.add_texture(3, GL_TEXTURE_2D_ARRAY, terrain_splatting.get_materials_texture_id());
+            // El clipmap repite el mundo: sus pesos se leen con GL_REPEAT (los demás modos, con GL_CLAMP_TO_EDGE)
+            terrain_packet.add_texture(4, GL_TEXTURE_2D_ARRAY, terrain_splatting.get_weights_texture_id(),
+                terrain_mode == CLIPMAP_TERRAIN ? terrain_splatting.get_tiled_weights_sampler_id() : 0);
+        }
+        else
+            terrain_packet.add_texture(0, GL_TEXTURE_2D, texture_id);
+
+        terrain_packet.draw = [this, &terrain_program, terrain_features, view](Shader_Program& terrain_shader)
+        {
+            if (terrain_features & SPLATTING) {
+                terrain_shader.set(terrain_program.material_count_id, GLint(terrain_splatting.get_material_count()));
+                terrain_shader.set(terrain_program.material_tiling_id, 24.0f);
+            }
+            terrain_shader.set(terrain_program.model_view_id, view);
+
+            switch (terrain_mode)
+            {
+            case CDLOD_TERRAIN:   cdlod_terrain->render(camera, gl_state, terrain_shader);   break;
+            case GPU_TERRAIN:     gpu_terrain->render(camera, gl_state, &terrain_shader);    break;
+            case CLIPMAP_TERRAIN: clipmap_terrain->render(camera, gl_state, terrain_shader); break;
+            case TESSELLATED_TERRAIN: tessellated_terrain->render(gl_state, terrain_shader, height); break;
+            default:              terrain.render(camera, gl_state);                         break;
+            }
+        };
+        render_queue.submit(terrain_packet);
 
-        // Render Cubo
-        glEnable(GL_BLEND); // mezcla de transparencia
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glUniform1f(glGetUniformLocation(program_id, "u_alpha"), 0.75f); // 75% opacidad
+        // Cubo (con el vertex shader de la escena: transparente, sin normal map ni materiales).
+        // Sigue escribiendo en el Z-buffer, como antes de la cola.
+        Lit_Program& cube_program = get_lit_program(CHUNKED_TERRAIN, get_cube_features());
 
         // Matriz de Modelo del cubo
         glm::mat4 model_cube(1.0f);
-        model_cube = glm::translate(model_cube, glm::vec3(0.0f, 40.0f, 0.0f));
+        model_cube = glm::translate(model_cube, cube_location);
         model_cube = glm::rotate(model_cube, cube_angle, glm::vec3(1.0f, 1.0f, 0.0f));
         model_cube = glm::scale(model_cube, glm::vec3(4.0f, 4.0f, 4.0f));
 
         glm::mat4 model_view_cube = view * model_cube;
-        glUniformMatrix4fv(model_view_matrix_id, 1, GL_FALSE, glm::value_ptr(model_view_cube));
-        glBindTexture(GL_TEXTURE_2D, cube_texture_id);
-        cube.render();
-        glDisable(GL_BLEND);
+
+        Render_Queue::Draw_Packet cube_packet;
+        cube_packet.program = &get_lit_shader(cube_program);
+        cube_packet.vao_id  = cube.get_vao_id();
+        cube_packet.blend   = true; // mezcla de transparencia
+        cube_packet.center  = cube_location;
+        cube_packet.add_texture(0, GL_TEXTURE_2D, cube_texture_id);
+        cube_packet.draw = [this, &cube_program, model_view_cube](Shader_Program& shader)
+        {
+            shader.set(cube_program.alpha_id, 0.75f); // 75% opacidad
+            shader.set(cube_program.model_view_id, model_view_cube);
+            cube.draw();
+        };
+        render_queue.submit(cube_packet);
+
+        render_queue.flush();
 
         // PASE 2: PINTAR EL QUAD EN LA PANTALLA CON EFECTOS
-        glBindFramebuffer(GL_FRAMEBUFFER, 0); // Framebuffer por defecto
-        glDisable(GL_DEPTH_TEST);
+        gl_state.bind_framebuffer(0); // Framebuffer por defecto
+        gl_state.set_depth_test(false);
         glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glUseProgram(post_program_id);
-        glBindVertexArray(screen_vao_id);
+        GLuint new_post_program_id;
+        if (shader_library.take(post_program, new_post_program_id)) {
+            glDeleteProgram(post_program_id);
+            post_program_id = new_post_program_id;
+        }
+        gl_state.use_program(post_program_id);
+        gl_state.bind_vertex_array(screen_vao_id);
 
-        glBindTexture(GL_TEXTURE_2D, fbo_texture_id);
+        gl_state.bind_texture(0, GL_TEXTURE_2D, fbo_texture_id);
 
         glDrawArrays(GL_TRIANGLES, 0, 6);
     }
@@ -341,22 +483,120 @@ namespace udit
     {
         width = w; height = h;
         camera.set_ratio((float)w / h);
-        glViewport(0, 0, w, h);
+        gl_state.set_viewport(0, 0, w, h);
 
-        glBindTexture(GL_TEXTURE_2D, fbo_texture_id);
+        // glTexImage2D usa la unidad activa, que bind_texture no cambia si la textura ya estaba
+        gl_state.bind_texture(0, GL_TEXTURE_2D, fbo_texture_id);
+        gl_state.set_active_texture(0);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
 
         glBindRenderbuffer(GL_RENDERBUFFER, rbo_id);
         glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
     }
 
-    void Scene::on_drag(float x, float y) { if (pointer_pressed) { angle_delta_x = 1.025f * (last_pointer_y - y) / height; angle_delta_y = 1.025f * (last_pointer_x - x) / width; last_pointer_x = x; last_pointer_y = y; } }
-    void Scene::on_click(float x, float y, bool d) { last_pointer_x = x; last_pointer_y = y; pointer_pressed = d; }
+    void Scene::on_drag(float x, float y) { if (pointer_pressed && brush_mode != NO_BRUSH) { last_pointer_x = x; last_pointer_y = y; return; } if (pointer_pressed) { angle_delta_x = 1.025f * (last_pointer_y - y) / height; angle_delta_y = 1.025f * (last_pointer_x - x) / width; last_pointer_x = x; last_pointer_y = y; } }
+    void Scene::on_click(float x, float y, bool d)
+    {
+        last_pointer_x = x; last_pointer_y = y; pointer_pressed = d;
+
+        if (d) { press_pointer_x = x; press_pointer_y = y; return; }
+        if (brush_mode != NO_BRUSH) return;
+
+        // Si al soltar el cursor casi no se ha movido es un clic (no un giro de camara):
+        // el cubo se coloca flotando sobre el punto del terreno que hay bajo el cursor
+        glm::vec3 point;
+
+        if (std::abs(x - press_pointer_x) + std::abs(y - press_pointer_y) < 4.0f && pick_terrain(x, y, point))
+        {
+            cube_location = point + glm::vec3(0.0f, 20.0f, 0.0f);
+        }
+    }
+
+    void Scene::prepare_terrain(Terrain_Mode mode)
+    {
+        bool is_new = false;
+
+        switch (mode)
+        {
+        case GPU_TERRAIN:
+            if (!gpu_terrain) {
+                gpu_terrain.reset(new Terrain(heightmap_path, height_map, 200.0f, 200.0f, 100, 100, 15.0f, Terrain::GPU_DISPLACEMENT, Terrain::TRIANGLE_STRIPS, cache_directory));
+                is_new = true;
+            }
+            break;
+        case CDLOD_TERRAIN:
+            if (!cdlod_terrain) {
+                cdlod_terrain.reset(new Cdlod_Terrain(height_map, 200.0f, 200.0f, 15.0f));
+                is_new = true;
+            }
+            break;
+        case CLIPMAP_TERRAIN:
+            // Con él arranca también el hilo que carga sus tiles
+            if (!clipmap_terrain) {
+                clipmap_terrain.reset(new Clipmap_Terrain(height_database_path(heightmap_path, height_map), 200.0f, 15.0f));
+                is_new = true;
+            }
+            break;
+        case TESSELLATED_TERRAIN:
+            if (!tessellated_terrain && tessellation_supported) {
+                tessellated_terrain.reset(new Tessellated_Terrain(height_map, 200.0f, 200.0f, 15.0f));
+                is_new = true;
+            }
+            break;
+        default:
+            break;
+        }
+
+        // El constructor crea sus texturas y su VAO sin pasar por gl_state
+        if (is_new) gl_state.forget_bindings();
+    }
+
+    bool Scene::pick_terrain(float pointer_x, float pointer_y, glm::vec3& point) const
+    {
+        // Pixel -> coordenadas normalizadas -> puntos en los planos near y far en el mundo
+        glm::vec2 ndc(2.0f * pointer_x / float(width) - 1.0f, 1.0f - 2.0f * pointer_y / float(height));
+        glm::mat4 inverse_view_projection = glm::inverse(camera.get_projection_matrix() * camera.get_transform_matrix_inverse());
+
+        glm::vec4 near_point = inverse_view_projection * glm::vec4(ndc, -1.0f, 1.0f);
+        glm::vec4 far_point  = inverse_view_projection * glm::vec4(ndc,  1.0f, 1.0f);
+
+        glm::vec3 from = glm::vec3(near_point) / near_point.w;
+        glm::vec3 to   = glm::vec3(far_point ) / far_point.w;
+
+        // La malla por trozos es la referencia: los otros modos dibujan el mismo suelo
+        // (salvo el clipmap, que lo repite; ahi solo coincide la copia central)
+        Terrain_Ray_Caster::Ray ray = { from, to - from, glm::length(to - from) };
+        Terrain_Ray_Caster::Hit hit;
+
+        if (!terrain.intersect(ray, hit)) return false;
+
+        point = hit.point;
+        return true;
+    }
     void Scene::on_key(int k, bool p) {
         switch (k) {
         case 'w':case 'W': move_forward = p; break; case 's':case 'S': move_backward = p; break;
         case 'a':case 'A': move_left = p; break;    case 'd':case 'D': move_right = p; break;
         case 'e':case 'E': move_up = p; break;      case 'q':case 'Q': move_down = p; break;
+        case 't':case 'T':
+            if (p) {
+                terrain_mode = Terrain_Mode((terrain_mode + 1) % TERRAIN_MODE_COUNT);
+                if (terrain_mode == TESSELLATED_TERRAIN && !tessellation_supported) terrain_mode = CHUNKED_TERRAIN;
+                prepare_terrain(terrain_mode);
+            }
+            break;
+        case 'n':case 'N':
+            if (p && !terrain_edited) use_normal_map = !use_normal_map;
+            break;
+        case 'f':case 'F':
+            if (p) use_fog = !use_fog;
+            break;
+        case 'b':case 'B':
+            if (p) brush_mode = Brush_Mode((brush_mode + 1) % BRUSH_MODE_COUNT);
+            break;
+        case 'g':case 'G':
+            if (p) std::cerr << "Llamadas de estado OpenGL en el ultimo frame: " << gl_state.get_issued_calls() << " enviadas, " << gl_state.get_skipped_calls() << " ahorradas" << std::endl;
+            break;
         }
     }
 }
\ No newline at end of file
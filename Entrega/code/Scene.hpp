@@ -7,8 +7,22 @@
 #include "Camera.hpp"
 #include "Skybox.hpp"
 #include "Terrain.hpp"
+#include "Cdlod_Terrain.hpp"
+#include "Clipmap_Terrain.hpp"
 #include "Cube.hpp"
+#include "Normal_Map.hpp"
+#include "Terrain_Splatting.hpp"
+#include "Tessellated_Terrain.hpp"
+#include "Shader_Program.hpp"
+#include "Frame_Uniforms.hpp"
+#include "Program_Cache.hpp"
+#include "Shader_Compiler.hpp"
+#include "Shader_Library.hpp"
+#include "GL_State.hpp"
+#include "Render_Queue.hpp"
+#include <Window.hpp>
 #include <map>
+#include <memory>
 
 namespace udit
 {
@@ -17,40 +31,104 @@ namespace udit
     private:
         // --- ELEMENTOS 3D ---
         Camera camera;    // Gestiona la vista y la proyeccion (perspectiva)
+        GL_State gl_state; // Estado de OpenGL ya enviado, para no repetir llamadas que no cambian nada (se declara antes que render_queue, que lo usa)
+        Frame_Uniforms frame_uniforms; // Cámara y luz del frame, compartidas por todos los programas (uniform buffer)
+        Program_Cache program_cache;   // Programas enlazados en arranques anteriores (en Entrega/cache)
+        Shader_Compiler shader_compiler; // Compila todos los programas sin esperar al driver
+        Shader_Library shader_library;   // Shaders leídos de Entrega/shaders y recargados al guardarlos (se declara antes que skybox, que la usa)
         Skybox skybox;    // El cubo de fondo (cielo)
+        Height_Map height_map; // El heightmap del suelo, decodificado una sola vez para todos los modos de terreno
         Terrain terrain;  // La malla del suelo generada por heightmap
+        // Los demás modos de terreno se construyen la primera vez que se eligen (ver prepare_terrain)
+        std::unique_ptr<Terrain> gpu_terrain;         // El mismo suelo como rejilla plana desplazada en el vertex shader
+        std::unique_ptr<Cdlod_Terrain> cdlod_terrain; // El mismo suelo con nivel de detalle continuo (CDLOD)
+        std::unique_ptr<Clipmap_Terrain> clipmap_terrain; // Mundo infinito (heightmap repetido) con geometry clipmaps
+        std::unique_ptr<Tessellated_Terrain> tessellated_terrain; // Teselado en la GPU (solo con un contexto OpenGL 4.x)
+        bool tessellation_supported; // Contexto 4.x con teselación: el modo teselado existe
+        Normal_Map terrain_normal_map; // Normales del suelo horneadas del heightmap (más detalle que la malla)
+        Terrain_Splatting terrain_splatting; // Materiales del suelo mezclados por altura y pendiente
         Cube cube;        // El cubo flotante
+        Render_Queue render_queue; // Dibujos del frame ordenados por estado y distancia
+
+        // Forma de dibujar el suelo (se cambia con la tecla T)
+        enum Terrain_Mode
+        {
+            CHUNKED_TERRAIN,  // Malla completa por trozos con descarte por frustum
+            CDLOD_TERRAIN,    // Parche compartido a varias escalas segun la distancia
+            GPU_TERRAIN,      // Rejilla plana + textura de alturas
+            CLIPMAP_TERRAIN,  // Anillos centrados en la camara sobre un mundo sin limites
+            TESSELLATED_TERRAIN, // Parches gruesos subdivididos en la GPU segun su tamaño en pantalla (se salta sin OpenGL 4.x)
+            TERRAIN_MODE_COUNT
+        };
+        Terrain_Mode terrain_mode;
+        bool use_normal_map; // Iluminar el suelo con el normal map (tecla N) o con las normales por vértice
+        bool terrain_edited; // Se ha esculpido el terreno: el normal map horneado ya no le corresponde y N no lo vuelve a activar
+        bool use_fog;        // Niebla según la distancia a la cámara (tecla F)
 
         // Dimensiones de la ventana (para ajustar el viewport y texturas)
         int    width;
         int    height;
 
-        // --- CONTROL DE CMARA (RATN) ---
-        float  angle_around_x, angle_around_y; // Angulos actuales de la cmara
-        float  angle_delta_x, angle_delta_y;   // Cunto se ha movido el ratn en este frame
-        bool   pointer_pressed;                // Esta el botn del raton pulsado?
-        float  last_pointer_x, last_pointer_y; // ltima posicion conocida del cursor
+        // --- CONTROL DE CÁMARA (RATÓN) ---
+        float  angle_around_x, angle_around_y; // Angulos actuales de la cámara
+        float  angle_delta_x, angle_delta_y;   // Cuánto se ha movido el ratón en este frame
+        bool   pointer_pressed;                // ¿Esta el botón del raton pulsado?
+        float  last_pointer_x, last_pointer_y; // Última posicion conocida del cursor
+        float  press_pointer_x, press_pointer_y; // Posicion del cursor al pulsar (para distinguir clic de arrastre)
+
+        // --- EDICIÓN DEL TERRENO (tecla B: sin pincel -> subir -> bajar) ---
+        enum Brush_Mode
+        {
+            NO_BRUSH,         // El ratón gira la cámara
+            RAISE_BRUSH,      // Arrastrar sube el terreno bajo el cursor
+            LOWER_BRUSH,      // Arrastrar baja el terreno bajo el cursor
+            BRUSH_MODE_COUNT
+        };
+        Brush_Mode brush_mode;
+        float  brush_radius;                   // Radio del pincel en unidades de mundo
+        float  brush_strength;                 // Altura que se añade en el centro en cada frame
 
         // --- SHADERS PRINCIPALES (GEOMETRIA 3D) ---
-        // Cdigo fuente GLSL y los IDs del programa compilado
-        static const std::string vertex_shader_code;
-        static const std::string fragment_shader_code;
-        GLuint  program_id;
-        // Localizaciones de las variables 'uniform' para enviar matrices al shader
-        GLint   model_view_matrix_id, projection_matrix_id;
+        // Partes opcionales del fragment shader de la escena (scene.frag), cada una un #define.
+        // Cada combinación que se usa es un programa propio (permutación): un objeto opaco no
+        // paga la transparencia, el cubo no paga los materiales del terreno, etc.
+        enum Lit_Feature
+        {
+            ALPHA_BLENDING = 1 << 0, // Transparencia con u_alpha
+            LIGHTING       = 1 << 1, // Luz difusa y ambiente
+            NORMAL_MAPPING = 1 << 2, // Normales del normal map horneado del terreno
+            FOG            = 1 << 3, // Niebla según la distancia
+            SPLATTING      = 1 << 4, // Materiales del terreno mezclados con el splat map
+            LIT_FEATURE_COUNT = 5
+        };
+
+        // Programa con scene.frag y los uniforms que se actualizan en cada frame, localizados una
+        // sola vez al recogerlo (en render no se busca nada por nombre)
+        struct Lit_Program
+        {
+            Shader_Library::Program program;        // Ficheros del programa (-1 si no existe)
+            std::unique_ptr<Shader_Program> shader; // Nulo hasta que se usa por primera vez; se sustituye al recargarlo
+            Shader_Program::Uniform_Id model_view_id, alpha_id;
+            Shader_Program::Uniform_Id material_count_id, material_tiling_id;
+        };
+        // Permutaciones creadas, por vertex shader (el de cada modo de terreno; el del terreno por
+        // trozos es también el del cubo) y características
+        std::map<unsigned, Lit_Program> lit_programs;
 
         // --- TEXTURAS ---
         GLuint  texture_id;       // ID de la textura del suelo
         GLuint  cube_texture_id;  // ID de la textura del cubo
         bool    there_is_texture; // Flag de control
 
-        // --- ANIMACIN ---
-        float cube_angle = 0.0f; // Angulo de rotacin del cubo (se incrementa en update)
+        // --- ANIMACIÓN ---
+        float cube_angle = 0.0f; // Angulo de rotación del cubo (se incrementa en update)
+        glm::vec3 cube_location; // Posición del cubo (se mueve haciendo clic sobre el terreno)
 
         // --- CONTROL DE CAMARA (TECLADO) ---
-        // Flags para saber qu teclas (WASD + EQ) estan pulsadas
+        // Flags para saber qué teclas (WASD + EQ) estan pulsadas
         bool move_forward, move_backward, move_left, move_right, move_up, move_down;
         float camera_speed; // Velocidad de desplazamiento
+        float camera_ground_clearance; // Altura mínima de la cámara sobre el terreno
 
         // --- VARIABLES PARA POST-PROCESO (Filtros de pantalla) ---
         GLuint fbo_id;         // Framebuffer Object: Memoria donde dibujamos "off-screen"
@@ -60,13 +138,13 @@ namespace udit
         GLuint screen_vao_id;  // VAO del cuadrado plano que cubre la pantalla
         GLuint screen_vbo_id;  // VBO del cuadrado
 
-        GLuint post_program_id; // Programa de Shader para el efecto final (Sepia/Vieta)
-        static const std::string post_vs_code; // Vertex shader del post-proceso
-        static const std::string post_fs_code; // Fragment shader del post-proceso
+        GLuint post_program_id; // Programa de Shader para el efecto final (Sepia/Viñeta)
+        Shader_Library::Program post_program; // post.vert y post.frag
 
     public:
         // Constructor: Inicializa todo (shaders, buffers, carga archivos...)
-        Scene(int width, int height);
+        // La versión del contexto decide si se puede usar la teselación (4.0 o superior)
+        Scene(int width, int height, const Window::OpenGL_Context_Settings& context_settings = Window::OpenGL_Context_Settings());
 
         // Destructor: Limpia memoria de OpenGL (buffers, texturas) al cerrar
         ~Scene();
@@ -77,19 +155,31 @@ namespace udit
         // Dibuja la escena. Aqui ocurre el renderizado en 2 pasos (Off-screen -> Pantalla)
         void render();
 
-        // Se llama cuando cambia el tamao de la ventana para reajustar texturas y cmara
+        // Se llama cuando cambia el tamaño de la ventana para reajustar texturas y cámara
         void resize(int width, int height);
 
         // --- GESTION DE EVENTOS (Input) ---
         void on_drag(float pointer_x, float pointer_y);             // Movimiento del raton
         void on_click(float pointer_x, float pointer_y, bool down); // Clics
-        void on_key(int key_code, bool pressed);                    // Pulsacin de teclas
+        void on_key(int key_code, bool pressed);                    // Pulsación de teclas
 
     private:
         // Funciones auxiliares internas para configurar el Post-Proceso
         void init_framebuffer(int width, int height); // Crea el FBO y texturas asociadas
-        void init_screen_quad();                      // Crea la geometra del cuadrado de pantalla completa
-        void compile_postprocess_shader();            // Compila los shaders de efectos visuales
+        void init_screen_quad();                      // Crea la geometría del cuadrado de pantalla completa
+
+        // Construye el terreno de un modo si todavía no existe (el de trozos se crea siempre)
+        void prepare_terrain(Terrain_Mode mode);
+        // Rayo desde la camara por el pixel indicado contra el terreno (picking)
+        bool pick_terrain(float pointer_x, float pointer_y, glm::vec3& point) const;
+        // Devuelve la permutación pedida, enviándola al compilador si aún no existía
+        Lit_Program& get_lit_program(Terrain_Mode vertex_shader, unsigned features);
+        // Características que necesita el terreno en un modo (con las opciones actuales) y el cubo
+        unsigned get_terrain_features(Terrain_Mode mode) const;
+        unsigned get_cube_features() const;
+        // Recoge el programa la primera vez y cada vez que se recompila: localiza sus uniforms y
+        // lo asocia a frame_uniforms
+        Shader_Program& get_lit_shader(Lit_Program& lit_program);
     };
 }
 #endif
\ No newline at end of file
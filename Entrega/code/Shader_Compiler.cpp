@@ -0,0 +1,242 @@
+// Shader_Compiler.cpp
+// angel.rodriguez@udit.es
+
+#include "Shader_Compiler.hpp"
+#include <SDL3/SDL_video.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+// GL_KHR_parallel_shader_compile no esta en el GLAD de OpenGL 3.3: la constante se define aqui y
+// la funcion se obtiene en tiempo de ejecucion (como los binarios en Program_Cache)
+
+#ifndef GL_COMPLETION_STATUS_KHR
+    #define GL_COMPLETION_STATUS_KHR    0x91B1
+#endif
+
+namespace udit
+{
+
+    namespace
+    {
+        typedef void (GLAD_API_PTR * Max_Shader_Compiler_Threads_Function)(GLuint count);
+
+        bool has_extension(const char * name)
+        {
+            GLint extension_count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+
+            for (GLint index = 0; index < extension_count; ++index)
+            {
+                const GLubyte * extension = glGetStringi(GL_EXTENSIONS, GLuint(index));
+
+                if (extension && std::strcmp(reinterpret_cast< const char * >(extension), name) == 0) return true;
+            }
+
+            return false;
+        }
+    }
+
+    Shader_Compiler::Shader_Compiler(Program_Cache * program_cache)
+        : program_cache(program_cache), parallel(false)
+    {
+        // Con la extension el driver compila en sus propios hilos y se puede preguntar si ha
+        // terminado sin bloquear. Sin ella, enviarlo todo antes de consultar nada sigue dejando
+        // que los drivers que compilan en otro hilo lo adelanten.
+        if (has_extension("GL_KHR_parallel_shader_compile"))
+        {
+            Max_Shader_Compiler_Threads_Function max_shader_compiler_threads =
+                reinterpret_cast< Max_Shader_Compiler_Threads_Function >(SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR"));
+
+            if (max_shader_compiler_threads)
+            {
+                max_shader_compiler_threads(0xFFFFFFFFu);       // Tantos hilos como quiera el driver
+                parallel = true;
+            }
+        }
+    }
+
+    Shader_Compiler::~Shader_Compiler()
+    {
+        for (Pending_Program & program : programs)
+        {
+            if (program.is_finished) continue;
+
+            for (GLuint shader_id : program.shader_ids) glDeleteShader(shader_id);
+
+            glDeleteProgram(program.program_id);
+        }
+    }
+
+    Shader_Compiler::Job Shader_Compiler::submit(const std::string & name, const std::vector< Stage > & stages)
+    {
+        Pending_Program program;
+        program.name        = name;
+        program.program_id  = 0;
+        program.key         = 0;
+        program.is_finished = false;
+
+        if (program_cache)
+        {
+            std::vector< const std::string * > sources;
+
+            for (const Stage & stage : stages) sources.push_back(stage.code);
+
+            program.key        = program_cache->make_key(sources);
+            program.program_id = program_cache->load(program.name, program.key);
+        }
+
+        if (!program.program_id)
+        {
+            // Ninguna llamada de aqui espera al compilador: se consulta todo en finish()
+            for (const Stage & stage : stages)
+            {
+                GLuint      shader_id = glCreateShader(stage.type);
+                const char * code     = stage.code->c_str();
+                GLint        size     = GLint(stage.code->size());
+
+                glShaderSource (shader_id, 1, &code, &size);
+                glCompileShader(shader_id);
+
+                program.shader_ids.push_back(shader_id);
+            }
+
+            program.program_id = glCreateProgram();
+
+            if (program_cache) program_cache->prepare(program.program_id);
+
+            for (GLuint shader_id : program.shader_ids) glAttachShader(program.program_id, shader_id);
+
+            glLinkProgram(program.program_id);
+        }
+
+        if (free_jobs.empty())
+        {
+            programs.push_back(program);
+
+            return Job(programs.size() - 1);
+        }
+
+        Job job = free_jobs.back();
+        free_jobs.pop_back();
+
+        programs[size_t(job)] = program;
+
+        return job;
+    }
+
+    bool Shader_Compiler::is_ready(Job job) const
+    {
+        const Pending_Program & program = programs[size_t(job)];
+
+        if (program.is_finished || program.shader_ids.empty() || !parallel) return true;
+
+        GLint completed = GL_FALSE;
+        glGetProgramiv(program.program_id, GL_COMPLETION_STATUS_KHR, &completed);
+
+        return completed == GL_TRUE;
+    }
+
+    GLuint Shader_Compiler::finish(Job job)
+    {
+        if (job < 0) return 0;
+
+        Pending_Program & program = programs[size_t(job)];
+
+        assert(!program.is_finished);                   // Cada programa se entrega una sola vez
+
+        program.is_finished = true;
+        free_jobs.push_back(job);
+
+        // Los programas de la cache ya estan enlazados (Program_Cache::load lo ha comprobado)
+        if (program.shader_ids.empty()) return program.program_id;
+
+        GLint succeeded = GL_FALSE;
+        glGetProgramiv(program.program_id, GL_LINK_STATUS, &succeeded);
+
+        if (!succeeded)
+        {
+            // Primero los errores de compilacion, que suelen ser la causa del fallo al enlazar
+            bool compilation_failed = false;
+
+            for (GLuint shader_id : program.shader_ids)
+            {
+                GLint compiled = GL_FALSE;
+                glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled);
+
+                if (!compiled)
+                {
+                    show_compilation_error(program, shader_id);
+                    compilation_failed = true;
+                }
+            }
+
+            if (!compilation_failed) show_linkage_error(program);
+        }
+        else if (program_cache)
+        {
+            program_cache->store(program.name, program.key, program.program_id);
+        }
+
+        // Los shaders ya no hacen falta una vez enlazado el programa
+        for (GLuint shader_id : program.shader_ids) glDeleteShader(shader_id);
+
+        program.shader_ids.clear();
+
+        if (!succeeded)
+        {
+            glDeleteProgram(program.program_id);
+            program.program_id = 0;
+        }
+
+        return program.program_id;
+    }
+
+    void Shader_Compiler::discard(Job job)
+    {
+        if (job < 0) return;
+
+        Pending_Program & program = programs[size_t(job)];
+
+        if (program.is_finished) return;
+
+        program.is_finished = true;
+        free_jobs.push_back(job);
+
+        for (GLuint shader_id : program.shader_ids) glDeleteShader(shader_id);
+
+        program.shader_ids.clear();
+
+        glDeleteProgram(program.program_id);
+    }
+
+    void Shader_Compiler::show_compilation_error(const Pending_Program & program, GLuint shader_id)
+    {
+        std::string info_log;
+        GLint       info_log_length = 0;
+
+        glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
+
+        info_log.resize(size_t(std::max(info_log_length, 1)));
+
+        glGetShaderInfoLog(shader_id, info_log_length, nullptr, &info_log.front());
+
+        std::cerr << "ERROR: No se pudo compilar un shader de '" << program.name << "':\n" << info_log.c_str() << std::endl;
+    }
+
+    void Shader_Compiler::show_linkage_error(const Pending_Program & program)
+    {
+        std::string info_log;
+        GLint       info_log_length = 0;
+
+        glGetProgramiv(program.program_id, GL_INFO_LOG_LENGTH, &info_log_length);
+
+        info_log.resize(size_t(std::max(info_log_length, 1)));
+
+        glGetProgramInfoLog(program.program_id, info_log_length, nullptr, &info_log.front());
+
+        std::cerr << "ERROR: No se pudo enlazar el programa '" << program.name << "':\n" << info_log.c_str() << std::endl;
+    }
+
+}
@@ -0,0 +1,95 @@
+// Shader_Compiler.hpp
+// angel.rodriguez@udit.es
+
+#ifndef SHADER_COMPILER_HEADER
+#define SHADER_COMPILER_HEADER
+
+#include <glad/gl.h>
+#include <string>
+#include <vector>
+#include "Program_Cache.hpp"
+
+namespace udit
+{
+
+    // Compilacion de todos los programas de la aplicacion. Se hace en dos pasos:
+    //
+    //   submit() crea los shaders, los compila y enlaza el programa sin preguntar nunca por el
+    //   resultado, asi que el driver puede compilar en segundo plano (con varios hilos si tiene
+    //   GL_KHR_parallel_shader_compile) mientras la aplicacion sigue cargando.
+    //
+    //   finish() se llama cuando de verdad hace falta el programa (normalmente al usarlo por
+    //   primera vez): solo entonces se consulta el estado, se muestran los errores y se guarda
+    //   el binario en la cache de programas.
+    //
+    // Entremedias is_ready() dice, sin bloquear, si el driver ya ha terminado.
+
+    class Shader_Compiler
+    {
+    public:
+
+        typedef int Job;                        // Indice del programa enviado (-1 = ninguno). Deja de valer tras finish() o discard()
+
+        struct Stage
+        {
+            GLenum              type;           // GL_VERTEX_SHADER, GL_FRAGMENT_SHADER...
+            const std::string * code;
+        };
+
+    private:
+
+        struct Pending_Program
+        {
+            std::string           name;         // Para los mensajes de error
+            GLuint                program_id;
+            std::vector< GLuint > shader_ids;   // Vacio si el programa viene de la cache
+            Program_Cache::Key    key;
+            bool                  is_finished;  // Entregado o abandonado: la entrada se puede reutilizar
+        };
+
+    private:
+
+        Program_Cache                 * program_cache;
+        std::vector< Pending_Program >  programs;
+        std::vector< Job >              free_jobs;          // Entradas terminadas (con cada recarga no crece programs)
+        bool                            parallel;           // El driver tiene GL_KHR_parallel_shader_compile
+
+    public:
+
+        explicit Shader_Compiler(Program_Cache * program_cache = nullptr);
+
+        // Libera los programas enviados que no se han llegado a terminar
+       ~Shader_Compiler();
+
+    private:
+
+        Shader_Compiler(const Shader_Compiler & ) = delete;
+        Shader_Compiler & operator = (const Shader_Compiler & ) = delete;
+
+    public:
+
+        bool is_parallel () const { return parallel; }
+
+        // Empieza a compilar y enlazar un programa con las etapas indicadas (o lo carga de la cache)
+        Job    submit   (const std::string & name, const std::vector< Stage > & stages);
+
+        // true si el programa ya se puede terminar sin esperar al driver
+        bool   is_ready (Job job) const;
+
+        // Espera al programa si hace falta y lo entrega: a partir de aqui es de quien lo pide.
+        // Devuelve 0 si no se ha podido compilar o enlazar (el error se escribe en std::cerr).
+        GLuint finish   (Job job);
+
+        // Abandona un programa enviado que ya no se va a usar (una version anterior de sus fuentes)
+        void   discard  (Job job);
+
+    private:
+
+        void   show_compilation_error (const Pending_Program & program, GLuint shader_id);
+        void   show_linkage_error     (const Pending_Program & program);
+
+    };
+
+}
+
+#endif
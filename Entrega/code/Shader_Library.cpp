@@ -0,0 +1,196 @@
+// Shader_Library.cpp
+// angel.rodriguez@udit.es
+
+#include "Shader_Library.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace udit
+{
+
+    namespace
+    {
+        // Limite de #include anidados (evita la recursion infinita si un fichero se incluye a si mismo)
+        constexpr unsigned max_include_depth = 8;
+    }
+
+    Shader_Library::Shader_Library(Shader_Compiler & shader_compiler, const std::string & directory)
+        : shader_compiler(shader_compiler), directory(directory)
+    {
+    }
+
+    Shader_Library::Program Shader_Library::add(const std::string & name, std::initializer_list< Stage > stages, const std::vector< std::string > & defines)
+    {
+        Entry entry;
+        entry.name         = name;
+        entry.stages       = stages;
+        entry.defines      = defines;
+        entry.job          = -1;
+        entry.is_delivered = false;
+
+        submit(entry);
+
+        programs.push_back(entry);
+
+        return Program(programs.size() - 1);
+    }
+
+    bool Shader_Library::take(Program program, GLuint & program_id)
+    {
+        if (program < 0) return false;
+
+        Entry & entry = programs[size_t(program)];
+
+        if (entry.job < 0)
+        {
+            if (entry.is_delivered) return false;
+
+            // No se pudo leer algun fichero: se entrega un programa vacio para que quien lo usa
+            // pueda seguir, y se reemplazara en cuanto el fichero aparezca
+            entry.is_delivered = true;
+            program_id         = 0;
+            return true;
+        }
+
+        // Las recargas no detienen el frame: se recogen cuando el driver ya las ha terminado
+        if (entry.is_delivered && !shader_compiler.is_ready(entry.job)) return false;
+
+        GLuint new_program_id = shader_compiler.finish(entry.job);
+        entry.job = -1;
+
+        if (entry.is_delivered)
+        {
+            if (!new_program_id)
+            {
+                std::cerr << "AVISO: Se sigue usando la version anterior de '" << entry.name << "'" << std::endl;
+                return false;
+            }
+
+            std::cerr << "Programa '" << entry.name << "' recargado" << std::endl;
+        }
+
+        entry.is_delivered = true;
+        program_id         = new_program_id;
+        return true;
+    }
+
+    void Shader_Library::reload_changed()
+    {
+        std::vector< std::string > changed = watcher.poll();
+
+        if (changed.empty()) return;
+
+        for (Entry & entry : programs)
+        {
+            bool is_affected = false;
+
+            for (const std::string & path : changed)
+            {
+                if (std::find(entry.files.begin(), entry.files.end(), path) != entry.files.end()) is_affected = true;
+            }
+
+            if (!is_affected) continue;
+
+            // Si la version anterior aun se estaba compilando ya no sirve
+            shader_compiler.discard(entry.job);
+            entry.job = -1;
+
+            submit(entry);
+        }
+    }
+
+    void Shader_Library::submit(Entry & entry)
+    {
+        std::vector< std::string >             sources(entry.stages.size());
+        std::vector< Shader_Compiler::Stage >  stages;
+
+        entry.files.clear();
+
+        bool is_loaded = true;
+
+        for (size_t index = 0; index < entry.stages.size() && is_loaded; ++index)
+        {
+            is_loaded = load_source(directory + entry.stages[index].file, sources[index], entry.files, 0);
+
+            if (is_loaded && !entry.defines.empty()) insert_defines(sources[index], entry.defines);
+
+            stages.push_back({ entry.stages[index].type, &sources[index] });
+        }
+
+        // Tambien se vigilan los ficheros que faltan, para compilar en cuanto se creen
+        for (const std::string & path : entry.files) watcher.add(path);
+
+        if (!is_loaded)
+        {
+            std::cerr << "ERROR: No se pudo cargar el programa '" << entry.name << "'" << std::endl;
+            return;
+        }
+
+        entry.job = shader_compiler.submit(entry.name, stages);
+    }
+
+    void Shader_Library::insert_defines(std::string & code, const std::vector< std::string > & defines)
+    {
+        // Tienen que ir despues del #version, que es siempre la primera linea
+        size_t line_end = code.find('\n');
+        size_t position = line_end == std::string::npos ? code.size() : line_end + 1;
+
+        std::string lines;
+
+        for (const std::string & define : defines) lines += "#define " + define + "\n";
+
+        lines += "#line 2\n";
+
+        code.insert(position, lines);
+    }
+
+    bool Shader_Library::load_source(const std::string & path, std::string & code, std::vector< std::string > & files, unsigned depth)
+    {
+        if (std::find(files.begin(), files.end(), path) == files.end()) files.push_back(path);
+
+        std::ifstream file(path);
+
+        if (!file)
+        {
+            std::cerr << "ERROR: No se pudo leer el shader " << path << std::endl;
+            return false;
+        }
+
+        std::string line;
+        unsigned    line_number = 0;
+
+        while (std::getline(file, line))
+        {
+            ++line_number;
+
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            if (line.compare(0, 8, "#include") != 0)
+            {
+                code += line;
+                code += '\n';
+                continue;
+            }
+
+            size_t open  = line.find('"');
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+
+            if (close == std::string::npos || depth >= max_include_depth)
+            {
+                std::cerr << "ERROR: #include no valido en " << path << " (linea " << line_number << ")" << std::endl;
+                return false;
+            }
+
+            // Con #line los errores del driver siguen indicando las lineas de cada fichero
+            code += "#line 1\n";
+
+            if (!load_source(directory + line.substr(open + 1, close - open - 1), code, files, depth + 1)) return false;
+
+            code += "#line " + std::to_string(line_number + 1) + "\n";
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,97 @@
+// Shader_Library.hpp
+// angel.rodriguez@udit.es
+
+#ifndef SHADER_LIBRARY_HEADER
+#define SHADER_LIBRARY_HEADER
+
+#include <glad/gl.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "File_Watcher.hpp"
+#include "Shader_Compiler.hpp"
+
+namespace udit
+{
+
+    // Programas cuyos shaders se leen de ficheros (uno por etapa) y se recompilan solos cuando
+    // alguno cambia en disco, sin reiniciar la aplicacion.
+    //
+    // Los ficheros pueden usar #include "nombre" (relativo al directorio de la biblioteca) para
+    // compartir codigo, como el bloque de frame_uniforms.glsl. Cambiar un fichero incluido
+    // recompila todos los programas que lo usan.
+    //
+    // Un mismo conjunto de ficheros puede dar varios programas (permutaciones) anadiendolo con
+    // distintas listas de #define, que se insertan tras el #version de cada etapa. Cada
+    // permutacion es un programa aparte para la cache de programas y para las recargas.
+    //
+    // Quien usa un programa lo recoge con take(): la primera vez espera a que este compilado y
+    // despues solo devuelve algo cuando hay una version nueva ya enlazada. Si la version nueva
+    // tiene errores se muestran y se sigue usando la anterior.
+
+    class Shader_Library
+    {
+    public:
+
+        typedef int Program;                    // Indice del programa (-1 = ninguno)
+
+        struct Stage
+        {
+            GLenum      type;                   // GL_VERTEX_SHADER, GL_FRAGMENT_SHADER...
+            std::string file;                   // Relativo al directorio de la biblioteca
+        };
+
+    private:
+
+        struct Entry
+        {
+            std::string                name;            // Para los mensajes
+            std::vector< Stage >       stages;
+            std::vector< std::string > defines;         // Se anaden como "#define NOMBRE" a todas las etapas
+            std::vector< std::string > files;           // Rutas de las etapas y de sus #include
+            Shader_Compiler::Job       job;             // Version enviada al compilador y aun no recogida (-1 = ninguna)
+            bool                       is_delivered;    // Ya se ha entregado alguna version con take()
+        };
+
+    private:
+
+        Shader_Compiler      & shader_compiler;
+        std::string            directory;               // Prefijo de los ficheros (con la barra final)
+        File_Watcher           watcher;
+        std::vector< Entry >   programs;
+
+    public:
+
+        Shader_Library(Shader_Compiler & shader_compiler, const std::string & directory);
+
+    private:
+
+        Shader_Library(const Shader_Library & ) = delete;
+        Shader_Library & operator = (const Shader_Library & ) = delete;
+
+    public:
+
+        // Lee los ficheros y envia el programa al compilador (sin esperar por el)
+        Program add  (const std::string & name, std::initializer_list< Stage > stages, const std::vector< std::string > & defines = std::vector< std::string >());
+
+        // Si hay una version del programa que todavia no se ha entregado la devuelve en program_id
+        // (que pasa a ser de quien lo pide: tiene que borrar la anterior) y retorna true. La
+        // primera vez espera al compilador y entrega el programa aunque sea 0 (no compila).
+        bool    take (Program program, GLuint & program_id);
+
+        // Vuelve a enviar al compilador los programas con algun fichero modificado. Se llama una
+        // vez por frame; no bloquea.
+        void    reload_changed ();
+
+    private:
+
+        void    submit      (Entry & entry);
+        bool    load_source (const std::string & path, std::string & code, std::vector< std::string > & files, unsigned depth);
+
+        static void insert_defines (std::string & code, const std::vector< std::string > & defines);
+
+    };
+
+}
+
+#endif
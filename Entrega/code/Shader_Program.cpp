@@ -0,0 +1,152 @@
+// Shader_Program.cpp
+// angel.rodriguez@udit.es
+
+#include "Shader_Program.hpp"
+#include <cassert>
+#include <cstring>
+#include <gtc/type_ptr.hpp>
+
+namespace udit
+{
+
+    namespace
+    {
+        // glUniform1i sirve para int, bool y cualquier sampler; el resto de setters solo
+        // para su propio tipo
+        bool is_compatible(GLenum uniform_type, GLenum setter_type)
+        {
+            if (uniform_type == setter_type) return true;
+
+            if (setter_type == GL_INT)
+            {
+                switch (uniform_type)
+                {
+                case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+                case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+                    return false;
+                default:
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    }
+
+    Shader_Program::Shader_Program(GLuint program_id)
+        : program_id(program_id)
+    {
+        reflect_uniforms ();
+    }
+
+    Shader_Program::~Shader_Program()
+    {
+        glDeleteProgram (program_id);
+    }
+
+    void Shader_Program::reflect_uniforms()
+    {
+        uniforms.clear ();
+
+        if (program_id == 0) return;                    // Programa que no se pudo compilar: sin uniforms
+
+        GLint uniform_count = 0;
+        GLint max_length    = 0;
+
+        glGetProgramiv (program_id, GL_ACTIVE_UNIFORMS,           &uniform_count);
+        glGetProgramiv (program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length   );
+
+        std::vector< GLchar > name(size_t(max_length) + 1);
+
+        uniforms.reserve (size_t(uniform_count));
+
+        for (GLint index = 0; index < uniform_count; ++index)
+        {
+            GLsizei length = 0;
+            GLint   size   = 0;
+            GLenum  type   = 0;
+
+            glGetActiveUniform (program_id, GLuint(index), GLsizei(name.size ()), &length, &size, &type, name.data ());
+
+            Uniform uniform;
+            uniform.name.assign (name.data (), size_t(length));
+
+            // Los arrays se devuelven como "nombre[0]": se guardan por el nombre que usa el codigo
+            if (uniform.name.size () > 3 && uniform.name.compare (uniform.name.size () - 3, 3, "[0]") == 0)
+            {
+                uniform.name.resize (uniform.name.size () - 3);
+            }
+
+            uniform.type     = type;
+            uniform.location = glGetUniformLocation (program_id, name.data ());
+            uniform.is_set   = false;
+
+            // Los miembros de los uniform blocks no tienen localizacion (se actualizan con su buffer)
+            if (uniform.location < 0) continue;
+
+            uniforms.push_back (uniform);
+        }
+    }
+
+    Shader_Program::Uniform_Id Shader_Program::get_uniform_id(const std::string & name) const
+    {
+        for (size_t index = 0; index < uniforms.size (); ++index)
+        {
+            if (uniforms[index].name == name) return Uniform_Id(index);
+        }
+
+        return -1;
+    }
+
+    bool Shader_Program::update_value(Uniform_Id id, GLenum type, const void * data, size_t size)
+    {
+        if (id < 0) return false;
+
+        Uniform & uniform = uniforms[size_t(id)];
+
+        assert(is_compatible (uniform.type, type));
+
+        if (uniform.is_set && std::memcmp (uniform.value, data, size) == 0) return false;
+
+        std::memcpy (uniform.value, data, size);
+        uniform.is_set = true;
+
+        return true;
+    }
+
+    void Shader_Program::set(Uniform_Id id, GLint value)
+    {
+        if (update_value (id, GL_INT, &value, sizeof(value))) glUniform1i (uniforms[size_t(id)].location, value);
+    }
+
+    void Shader_Program::set(Uniform_Id id, GLfloat value)
+    {
+        if (update_value (id, GL_FLOAT, &value, sizeof(value))) glUniform1f (uniforms[size_t(id)].location, value);
+    }
+
+    void Shader_Program::set(Uniform_Id id, const glm::vec2 & value)
+    {
+        if (update_value (id, GL_FLOAT_VEC2, glm::value_ptr (value), sizeof(value))) glUniform2fv (uniforms[size_t(id)].location, 1, glm::value_ptr (value));
+    }
+
+    void Shader_Program::set(Uniform_Id id, const glm::vec3 & value)
+    {
+        if (update_value (id, GL_FLOAT_VEC3, glm::value_ptr (value), sizeof(value))) glUniform3fv (uniforms[size_t(id)].location, 1, glm::value_ptr (value));
+    }
+
+    void Shader_Program::set(Uniform_Id id, const glm::vec4 & value)
+    {
+        if (update_value (id, GL_FLOAT_VEC4, glm::value_ptr (value), sizeof(value))) glUniform4fv (uniforms[size_t(id)].location, 1, glm::value_ptr (value));
+    }
+
+    void Shader_Program::set(Uniform_Id id, const glm::mat3 & value)
+    {
+        if (update_value (id, GL_FLOAT_MAT3, glm::value_ptr (value), sizeof(value))) glUniformMatrix3fv (uniforms[size_t(id)].location, 1, GL_FALSE, glm::value_ptr (value));
+    }
+
+    void Shader_Program::set(Uniform_Id id, const glm::mat4 & value)
+    {
+        if (update_value (id, GL_FLOAT_MAT4, glm::value_ptr (value), sizeof(value))) glUniformMatrix4fv (uniforms[size_t(id)].location, 1, GL_FALSE, glm::value_ptr (value));
+    }
+
+}
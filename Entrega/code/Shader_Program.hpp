@@ -0,0 +1,83 @@
+// Shader_Program.hpp
+// angel.rodriguez@udit.es
+
+#ifndef SHADER_PROGRAM_HEADER
+#define SHADER_PROGRAM_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <string>
+#include <vector>
+
+namespace udit
+{
+
+    // Programa enlazado con la tabla de sus uniforms activos, leida una sola vez con
+    // glGetActiveUniform al crearlo. Quien lo usa busca cada uniform por nombre al principio
+    // (get_uniform_id) y en cada frame solo usa el indice que le devuelve: no hay busquedas por
+    // cadena ni consultas al driver en el bucle de render.
+    //
+    // Los setters recuerdan el ultimo valor subido y no vuelven a llamar a glUniform si no ha
+    // cambiado. Como con glUniform, el programa tiene que estar activo (glUseProgram) al llamarlos.
+
+    class Shader_Program
+    {
+    public:
+
+        typedef GLint Uniform_Id;                       // Indice en la tabla (-1 = no existe: los setters no hacen nada)
+
+    private:
+
+        struct Uniform
+        {
+            std::string name;                           // Sin el "[0]" final en los arrays
+            GLenum      type;
+            GLint       location;
+            bool        is_set;                         // Se ha subido algun valor desde el programa
+            GLfloat     value[16];                      // Ultimo valor subido (bytes de floats o ints, hasta una mat4)
+        };
+
+    private:
+
+        GLuint                 program_id;
+        std::vector< Uniform > uniforms;
+
+    public:
+
+        // Toma posesion del programa (ya enlazado) y lee sus uniforms activos
+        explicit Shader_Program(GLuint program_id);
+       ~Shader_Program();
+
+    private:
+
+        Shader_Program(const Shader_Program & ) = delete;
+        Shader_Program & operator = (const Shader_Program & ) = delete;
+
+    public:
+
+        GLuint get_id            () const { return program_id; }
+        size_t get_uniform_count () const { return uniforms.size (); }
+
+        // Busqueda lineal por nombre: para hacerla una vez al crear el programa, no en cada frame
+        Uniform_Id get_uniform_id (const std::string & name) const;
+
+        void set (Uniform_Id id, GLint              value);   // int, bool y samplers
+        void set (Uniform_Id id, GLfloat            value);
+        void set (Uniform_Id id, const glm::vec2  & value);
+        void set (Uniform_Id id, const glm::vec3  & value);
+        void set (Uniform_Id id, const glm::vec4  & value);
+        void set (Uniform_Id id, const glm::mat3  & value);
+        void set (Uniform_Id id, const glm::mat4  & value);
+
+    private:
+
+        void reflect_uniforms ();
+
+        // Guarda el valor y devuelve true si es distinto del ultimo subido (hay que subirlo)
+        bool update_value (Uniform_Id id, GLenum type, const void * data, size_t size);
+
+    };
+
+}
+
+#endif
@@ -1,11 +1,10 @@
-// Este cdigo es de dominio pblico.
+// Este código es de dominio público.
 // angel.rodriguez@esne.edu
 // 2014.03+
 
-#include <cassert>
-#include <iostream>
 #include <glad/gl.h>
 #include "Skybox.hpp"
+#include "Frame_Uniforms.hpp"
 #include <glm.hpp>
 #include <gtc/type_ptr.hpp>
 
@@ -55,51 +54,20 @@ namespace udit
         +1.0f, -1.0f, +1.0f,
     };
 
-    const std::string Skybox::vertex_shader_code =
-
-        "#version 330\n"
-        ""
-        "uniform mat4 model_view_matrix;"
-        "uniform mat4 projection_matrix;"
-        ""
-        "layout (location = 0) in vec3 vertex_coordinates;"
-        ""
-        "out vec3 texture_coordinates;"
-        ""
-        "void main()"
-        "{"
-        "   texture_coordinates = vec3(vertex_coordinates.x, -vertex_coordinates.y, vertex_coordinates.z);"
-        "   gl_Position = projection_matrix * model_view_matrix * vec4(vertex_coordinates, 1.0);"
-        "}";
-
-    const std::string Skybox::fragment_shader_code =
-
-        "#version 330\n"
-        ""
-        "in  vec3 texture_coordinates;"
-        "out vec4 fragment_color;"
-        ""
-        "uniform samplerCube sampler;"
-        ""
-        "void main()"
-        "{"
-        "    fragment_color = texture (sampler, texture_coordinates);"
-        "}";
-
-    Skybox::Skybox(const std::string& texture_base_path)
+    Skybox::Skybox(const std::string& texture_base_path, Shader_Library& shader_library)
         :
+        shader_library(&shader_library),
+        shader_program_id(0),
         texture_cube(texture_base_path)
     {
         // assert(texture_cube.is_ok ()); // Comentado por si falla la textura que no crashee, se vea negro pero funcione
 
-        // Se compilan y linkan los shaders:
+        // Se envían los shaders a compilar. El programa se recoge al pintar por primera vez,
+        // así que mientras tanto el driver puede compilarlo en segundo plano:
 
-        shader_program_id = compile_shaders();
+        shader_program = shader_library.add("skybox", { { GL_VERTEX_SHADER, "skybox.vert" }, { GL_FRAGMENT_SHADER, "skybox.frag" } });
 
-        model_view_matrix_id = glGetUniformLocation(shader_program_id, "model_view_matrix");
-        projection_matrix_id = glGetUniformLocation(shader_program_id, "projection_matrix");
-
-        // Se generan ndices para los VBOs del cubo:
+        // Se generan índices para los VBOs del cubo:
 
         glGenBuffers(1, &vbo_id);
         glGenVertexArrays(1, &vao_id);
@@ -125,125 +93,40 @@ namespace udit
 
         glDeleteVertexArrays(1, &vao_id);
         glDeleteBuffers(1, &vbo_id);
+        glDeleteProgram(shader_program_id);
     }
 
-    void Skybox::render(const Camera& camera)
+    void Skybox::render(GL_State & gl_state)
     {
-        glUseProgram(shader_program_id);
-
-        texture_cube.bind();
-
-        // --- CORRECCIN IMPORTANTE AQU ---
-        // Obtenemos la matriz de vista
-        glm::mat4 model_view_matrix = camera.get_transform_matrix_inverse();
-
-        // ELIMINAMOS LA TRASLACIN
-        // Esto hace que el Skybox se quede "pegado" a la cmara en el (0,0,0) relativo
-        // Dejamos solo la rotacin.
-        model_view_matrix[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-
-        const glm::mat4& projection_matrix = camera.get_projection_matrix();
-
-        glUniformMatrix4fv(model_view_matrix_id, 1, GL_FALSE, glm::value_ptr(model_view_matrix));
-        glUniformMatrix4fv(projection_matrix_id, 1, GL_FALSE, glm::value_ptr(projection_matrix));
-
-        glDepthMask(GL_FALSE);
-
-        glBindVertexArray(vao_id);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        glDepthMask(GL_TRUE);
-
-        glBindVertexArray(0);
-        glUseProgram(0);
-    }
-
-    GLuint Skybox::compile_shaders()
-    {
-        GLint succeeded = GL_FALSE;
-
-        // Se crean objetos para los shaders:
-
-        GLuint   vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-        GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-
-        // Se carga el cdigo de los shaders:
-
-        const char* vertex_shaders_code[] = { vertex_shader_code.c_str() };
-        const char* fragment_shaders_code[] = { fragment_shader_code.c_str() };
-        const GLint    vertex_shaders_size[] = { (GLint)vertex_shader_code.size() };
-        const GLint  fragment_shaders_size[] = { (GLint)fragment_shader_code.size() };
-
-        glShaderSource(vertex_shader_id, 1, vertex_shaders_code, vertex_shaders_size);
-        glShaderSource(fragment_shader_id, 1, fragment_shaders_code, fragment_shaders_size);
+        // La primera vez, o si se ha recompilado tras cambiar los ficheros, se cambia de programa:
 
-        // Se compilan los shaders:
+        GLuint new_program_id;
 
-        glCompileShader(vertex_shader_id);
-        glCompileShader(fragment_shader_id);
+        if (shader_library->take(shader_program, new_program_id))
+        {
+            glDeleteProgram(shader_program_id);
 
-        // Se comprueba que si la compilacin ha tenido xito:
+            shader_program_id = new_program_id;
 
-        glGetShaderiv(vertex_shader_id, GL_COMPILE_STATUS, &succeeded);
-        if (!succeeded) show_compilation_error(vertex_shader_id);
+            // La vista y la proyección se leen del bloque común de la escena (Frame_Uniforms):
 
-        glGetShaderiv(fragment_shader_id, GL_COMPILE_STATUS, &succeeded);
-        if (!succeeded) show_compilation_error(fragment_shader_id);
+            Frame_Uniforms::bind_block(shader_program_id);
+        }
 
-        // Se crea un objeto para un programa:
+        gl_state.use_program(shader_program_id);
 
-        GLuint program_id = glCreateProgram();
+        if (texture_cube.is_ok()) gl_state.bind_texture(0, GL_TEXTURE_CUBE_MAP, texture_cube.get_texture_id());
 
-        // Se cargan los shaders compilados en el programa:
+        // La matriz de vista llega sin traslación (mat4(mat3(u_view)) en el vertex shader):
+        // el Skybox se queda "pegado" a la cámara en el (0,0,0) relativo y solo gira con ella.
+        // No escribe en el Z-buffer para que todo lo demás quede delante.
 
-        glAttachShader(program_id, vertex_shader_id);
-        glAttachShader(program_id, fragment_shader_id);
+        gl_state.set_depth_write(false);
 
-        // Se linkan los shaders:
-
-        glLinkProgram(program_id);
-
-        // Se comprueba si el linkage ha tenido xito:
-
-        glGetProgramiv(program_id, GL_LINK_STATUS, &succeeded);
-        if (!succeeded) show_linkage_error(program_id);
-
-        // Se liberan los shaders compilados una vez se han linkado:
-
-        glDeleteShader(vertex_shader_id);
-        glDeleteShader(fragment_shader_id);
-
-        return program_id;
-    }
-
-    void Skybox::show_compilation_error(GLuint shader_id)
-    {
-        string info_log;
-        GLint  info_log_length;
-
-        glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
-
-        info_log.resize(info_log_length);
-
-        glGetShaderInfoLog(shader_id, info_log_length, NULL, &info_log.front());
-
-        cerr << info_log.c_str() << endl;
-        assert(false);
-    }
-
-    void Skybox::show_linkage_error(GLuint program_id)
-    {
-        string info_log;
-        GLint  info_log_length;
-
-        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_log_length);
-
-        info_log.resize(info_log_length);
-
-        glGetProgramInfoLog(program_id, info_log_length, NULL, &info_log.front());
+        gl_state.bind_vertex_array(vao_id);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
 
-        cerr << info_log.c_str() << endl;
-        assert(false);
+        gl_state.set_depth_write(true);
     }
 
 }
\ No newline at end of file
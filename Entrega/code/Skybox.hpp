@@ -1,5 +1,5 @@
 
-// Este cdigo es de dominio pblico
+// Este código es de dominio público
 // angel.rodriguez@udit.es
 
 #ifndef SKYBOX_HEADER
@@ -9,6 +9,8 @@
     #include <memory>
     #include "Camera.hpp"
     #include "Texture_Cube.hpp"
+    #include "Shader_Library.hpp"
+    #include "GL_State.hpp"
 
     namespace udit
     {
@@ -18,33 +20,27 @@
         private:
 
             static const GLfloat              coordinates[];
-            static const std::string   vertex_shader_code;
-            static const std::string fragment_shader_code;
 
             GLuint       vbo_id;                                // Id del VBO de las coordenadas
             GLuint       vao_id;                                // Id del VAO del cubo
 
+            Shader_Library         * shader_library;
+            Shader_Library::Program  shader_program;    // shaders/skybox.vert y skybox.frag (se recargan al cambiar)
             GLuint       shader_program_id;
 
-            GLint        model_view_matrix_id;
-            GLint        projection_matrix_id;
-
             Texture_Cube texture_cube;
 
         public:
 
-            Skybox(const std::string & texture_path);
+            // La biblioteca de shaders tiene que vivir tanto como el Skybox
+            Skybox(const std::string & texture_path, Shader_Library & shader_library);
            ~Skybox();
 
         public:
 
-            void render (const Camera & camera);
-
-        private:
-
-            GLuint compile_shaders        ();
-            void   show_compilation_error (GLuint  shader_id);
-            void   show_linkage_error     (GLuint program_id);
+            // La cámara se toma del bloque Frame_Uniforms, que ya debe estar actualizado en este frame.
+            // Los cambios de estado pasan por gl_state (solo llegan al driver los que cambian algo).
+            void render (GL_State & gl_state);
 
         };
 
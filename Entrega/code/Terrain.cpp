@@ -2,12 +2,17 @@
 // angel.rodriguez@udit.es
 
 #include "Terrain.hpp"
+#include "Terrain_Mesh.hpp"
+#include "Terrain_Cache.hpp"
 #include <glm.hpp>
 #include <half.hpp>
+#include <cassert>
 #include <vector>
 #include <SOIL2.h>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <limits>
 
 using glm::vec3;
 using std::vector;
@@ -16,147 +21,543 @@ using half_float::half;
 namespace udit
 {
 
-    Terrain::Terrain(const std::string& heightmap_path, float width, float depth, unsigned x_slices, unsigned z_slices, float max_height)
+    namespace
     {
-        // 1. CARGA DEL HEIGHTMAP
-        int tex_w = 0, tex_h = 0, tex_ch = 0;
-        unsigned char* image = SOIL_load_image(heightmap_path.c_str(), &tex_w, &tex_h, &tex_ch, SOIL_LOAD_RGB);
+        // Lado de cada trozo (chunk) del terreno en quads. Es la unidad minima que se descarta
+        // contra el frustum: trozos mas pequenos recortan mejor pero generan mas nodos.
+        constexpr unsigned chunk_size = 16;
 
-        if (!image) std::cerr << "ERROR: No se pudo cargar heightmap." << std::endl;
+        // Índice que corta las tiras (TRIANGLE_STRIPS)
+        constexpr GLushort restart_index = 0xFFFF;
+    }
+
+    Terrain::Terrain(const std::string& heightmap_path, const Height_Map& height_map, float width, float depth, unsigned x_slices, unsigned z_slices, float max_height, Displacement displacement, Index_Mode index_mode, const std::string& cache_directory)
+        : width(width), depth(depth), x_slices(x_slices), z_slices(z_slices), max_height(max_height), displacement(displacement), index_mode(index_mode), program_id(0)
+    {
+        // Con tiras de 16 bits el mayor índice relativo de un trozo (chunk_size filas más abajo)
+        // tiene que quedar por debajo del índice de reinicio
+        if (index_mode == TRIANGLE_STRIPS && size_t(chunk_size) * (x_slices + 1) + chunk_size >= restart_index)
+        {
+            std::cerr << "AVISO: Terreno demasiado ancho para índices de 16 bits, se usa una lista de triángulos." << std::endl;
+            this->index_mode = TRIANGLE_LIST;
+        }
+
+        // 0. CACHÉ DE LA MALLA GENERADA
+        // Si coincide con el contenido del heightmap y con los parámetros no hace falta decodificar
+        // la imagen ni recalcular vértices, índices o el quadtree: se sube directamente desde el fichero.
+        Terrain_Cache::Key cache_key =
+        {
+            Terrain_Cache::hash_file(heightmap_path), width, depth, max_height, x_slices, z_slices,
+            uint32_t(displacement) | uint32_t(this->index_mode) << 1 | chunk_size << 8 | uint32_t(sizeof(Quadtree_Node)) << 16
+        };
+        bool        use_cache  = !cache_directory.empty() && cache_key.source_hash != 0;
+        std::string cache_path = Terrain_Cache::cache_path(cache_directory, heightmap_path, cache_key);
+
+        bool is_cached = use_cache && load_cache(cache_path, cache_key);
+
+        // 1. HEIGHTMAP (un solo canal, con la precisión del fichero: 8 o 16 bits o float)
+        // Con la malla en caché solo hace falta para la textura de alturas del modo GPU.
+        // En modo GPU el heightmap se sube una sola vez como textura de un canal
+        if (displacement == GPU_DISPLACEMENT)
+        {
+            if (!height_map.is_empty())
+            {
+                height_texture.reset(new Height_Texture(height_map));
+            }
+            else
+            {
+                unsigned char flat_height = 0;
+                height_texture.reset(new Height_Texture(1, 1, &flat_height));
+            }
+        }
+
+        if (is_cached) return;
+
+        // --- PASES 1 Y 2: alturas, geometria y normales (en paralelo) ---
+        // Con GPU_DISPLACEMENT solo hacen falta las alturas (para las cajas del quadtree):
+        // el vertex shader calcula las normales a partir de la textura.
+        Terrain_Mesh mesh(&height_map, width, depth, x_slices, z_slices, max_height, displacement == CPU_DISPLACEMENT);
 
         unsigned n_verts_x = x_slices + 1;
         unsigned n_verts_z = z_slices + 1;
-        unsigned total_vertices = n_verts_x * n_verts_z;
 
-        // Buffers temporales
-        vector< half > coordinates;
-        vector< half > texture_uvs;
-        vector< half > normals;         // <--- NUEVO
+        vector< Packed_Vertex > & vertices     = mesh.vertices;
+        vector< float         > & temp_heights = mesh.heights;
+        vector< GLushort      >   grid;         // Solo con GPU_DISPLACEMENT: (x, z) normalizados
 
-        coordinates.reserve(total_vertices * 3);
-        texture_uvs.reserve(total_vertices * 2);
-        normals.reserve(total_vertices * 3);
+        // Las alturas se quedan en la CPU (en 16 bits) para poder consultar el suelo
+        height_field = Height_Field(temp_heights, n_verts_x, n_verts_z, glm::vec2(-width * 0.5f, -depth * 0.5f),
+                                    glm::vec2(width / float(x_slices), depth / float(z_slices)));
+        ray_caster   = Terrain_Ray_Caster(height_field);
 
-        // Guardamos las alturas en un vector temporal de floats para poder calcular normales despus
-        vector<float> temp_heights(total_vertices);
+        if (displacement == GPU_DISPLACEMENT)
+        {
+            grid.reserve(size_t(n_verts_x) * n_verts_z * 2);
 
-        float x_step = width / float(x_slices);
-        float z_step = depth / float(z_slices);
+            for (unsigned z = 0; z < n_verts_z; ++z)
+            {
+                for (unsigned x = 0; x < n_verts_x; ++x)
+                {
+                    grid.push_back(GLushort(x * 65535ull / x_slices));
+                    grid.push_back(GLushort(z * 65535ull / z_slices));
+                }
+            }
+        }
 
-        // --- PASE 1: Generar Geometra y guardar alturas ---
-        for (unsigned z = 0; z < n_verts_z; ++z)
+        // --- PASE 3: Índices por trozos ---
+        // La malla se parte en trozos de chunk_size x chunk_size quads organizados en un quadtree.
+        // Los índices se emiten en el orden del recorrido del quadtree para que cada nodo ocupe
+        // un rango contiguo del EBO.
+        vector< GLuint   > indices;           // TRIANGLE_LIST
+        vector< GLushort > strip_indices;     // TRIANGLE_STRIPS
+
+        if (this->index_mode == TRIANGLE_LIST) indices      .reserve(size_t(x_slices) * z_slices * 6);
+        else                                   strip_indices.reserve(size_t(x_slices + chunk_size) * z_slices * 2);
+
+        unsigned chunks_x = (x_slices + chunk_size - 1) / chunk_size;
+        unsigned chunks_z = (z_slices + chunk_size - 1) / chunk_size;
+
+        quadtree.clear();
+        build_quadtree(0, 0, chunks_x, chunks_z, temp_heights, indices, strip_indices);
+
+        number_of_indices = GLsizei(this->index_mode == TRIANGLE_LIST ? indices.size() : strip_indices.size());
+
+        const void * index_data  = this->index_mode == TRIANGLE_LIST ? (const void *)indices.data() : (const void *)strip_indices.data();
+        size_t       index_bytes = this->index_mode == TRIANGLE_LIST ? indices.size() * sizeof(GLuint) : strip_indices.size() * sizeof(GLushort);
+
+        const void * vertex_data  = displacement == GPU_DISPLACEMENT ? (const void *)grid.data() : (const void *)vertices.data();
+        size_t       vertex_bytes = displacement == GPU_DISPLACEMENT ? grid.size() * sizeof(GLushort) : vertices.size() * sizeof(Packed_Vertex);
+
+        upload_buffers(vertex_data, vertex_bytes, index_data, index_bytes);
+
+        // Se guarda todo tal cual se ha subido (y las consultas ya construidas) para que el próximo
+        // arranque sea una sola lectura. Las alturas en float solo hacen falta para editar.
+        if (use_cache)
         {
-            for (unsigned x = 0; x < n_verts_x; ++x)
-            {
-                float x_pos = -width * 0.5f + x * x_step;
-                float z_pos = -depth * 0.5f + z * z_step;
-                float y_pos = 0.0f;
+            float            field_range[2] = { height_field.get_min_height(), height_field.get_height_scale() };
+            vector< unsigned char > pyramid(ray_caster.get_memory_size());
 
-                if (image)
+            ray_caster.copy_pyramid(pyramid.data());
+
+            Terrain_Cache::write
+            (
+                cache_path, cache_key,
                 {
-                    int img_x = (int)((float)x / x_slices * (tex_w - 1));
-                    int img_y = (int)((float)z / z_slices * (tex_h - 1));
-                    int pixel_idx = (img_y * tex_w + img_x) * 3; // Asumimos 3 canales por SOIL_LOAD_RGB
+                    { temp_heights.data(),  displacement == CPU_DISPLACEMENT ? temp_heights.size() * sizeof(float) : 0 },
+                    { vertex_data,          vertex_bytes },
+                    { index_data,           index_bytes  },
+                    { quadtree.data(),      quadtree.size() * sizeof(Quadtree_Node) },
+                    { height_field.get_samples(), height_field.get_memory_size() },
+                    { field_range,          sizeof(field_range) },
+                    { pyramid.data(),       pyramid.size() },
+                }
+            );
+        }
+
+        // Las alturas en float se guardan para poder editar el terreno (ver apply_brush)
+        if (displacement == CPU_DISPLACEMENT) heights = std::move(temp_heights);
+    }
+
+    bool Terrain::load_cache(const std::string& cache_path, const Terrain_Cache::Key& cache_key)
+    {
+        Terrain_Cache cache(cache_path, cache_key);
+
+        if (!cache.is_valid() || cache.get_section_count() != CACHE_SECTION_COUNT) return false;
+
+        size_t vertex_count = size_t(x_slices + 1) * (z_slices + 1);
+        size_t vertex_size  = displacement == GPU_DISPLACEMENT ? 2 * sizeof(GLushort) : sizeof(Packed_Vertex);
+        size_t index_size   = index_mode   == TRIANGLE_LIST    ? sizeof(GLuint)       : sizeof(GLushort);
+
+        // Las secciones tienen que tener el tamaño que corresponde a los parámetros de la clave
+        if (cache.get_section_size(CACHED_HEIGHTS) != (displacement == CPU_DISPLACEMENT ? vertex_count * sizeof(float) : 0)
+         || cache.get_section_size(CACHED_VERTICES) != vertex_count * vertex_size
+         || cache.get_section_size(CACHED_INDICES) % index_size != 0
+         || cache.get_section_size(CACHED_QUADTREE) % sizeof(Quadtree_Node) != 0
+         || cache.get_section_size(CACHED_QUADTREE) == 0
+         || cache.get_section_size(CACHED_FIELD_SAMPLES) != vertex_count * sizeof(uint16_t)
+         || cache.get_section_size(CACHED_FIELD_RANGE) != 2 * sizeof(float))
+        {
+            return false;
+        }
+
+        const float * cached_heights = static_cast< const float         * >(cache.get_section_data(CACHED_HEIGHTS));
+        const auto  * cached_nodes   = static_cast< const Quadtree_Node * >(cache.get_section_data(CACHED_QUADTREE));
+        const float * field_range    = static_cast< const float         * >(cache.get_section_data(CACHED_FIELD_RANGE));
+
+        // Las consultas se copian ya construidas (sin volver a cuantizar ni a montar la pirámide)
+        height_field = Height_Field(static_cast< const uint16_t * >(cache.get_section_data(CACHED_FIELD_SAMPLES)), x_slices + 1, z_slices + 1,
+                                    glm::vec2(-width * 0.5f, -depth * 0.5f), glm::vec2(width / float(x_slices), depth / float(z_slices)),
+                                    field_range[0], field_range[1]);
+        ray_caster   = Terrain_Ray_Caster(height_field, cache.get_section_data(CACHED_PYRAMID), cache.get_section_size(CACHED_PYRAMID));
+
+        quadtree.assign(cached_nodes, cached_nodes + cache.get_section_size(CACHED_QUADTREE) / sizeof(Quadtree_Node));
 
-                    unsigned char val = image[pixel_idx];
-                    y_pos = (float)val / 255.0f * max_height;
-                    y_pos -= max_height * 0.15f;
+        number_of_indices = GLsizei(cache.get_section_size(CACHED_INDICES) / index_size);
+
+        upload_buffers(cache.get_section_data(CACHED_VERTICES), cache.get_section_size(CACHED_VERTICES),
+                       cache.get_section_data(CACHED_INDICES),  cache.get_section_size(CACHED_INDICES));
+
+        if (displacement == CPU_DISPLACEMENT) heights.assign(cached_heights, cached_heights + vertex_count);
+
+        return true;
+    }
+
+    void Terrain::upload_buffers(const void * vertex_data, size_t vertex_bytes, const void * index_data, size_t index_bytes)
+    {
+        glGenVertexArrays(1, &vao_id);
+        glGenBuffers(VBO_COUNT, vbo_ids);
+
+        glBindVertexArray(vao_id);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[VERTICES_VBO]);
+
+        if (displacement == GPU_DISPLACEMENT)
+        {
+            // Solo la rejilla plana: 4 bytes por vértice en lugar de 16
+            glBufferData(GL_ARRAY_BUFFER, vertex_bytes, vertex_data, GL_STATIC_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_TRUE, 0, 0);
+        }
+        else
+        {
+            // Vértices entrelazados (posición, UV y normal en un solo buffer, ver Packed_Vertex).
+            // Dinámico porque se puede editar el terreno.
+            glBufferData(GL_ARRAY_BUFFER, vertex_bytes, vertex_data, GL_DYNAMIC_DRAW);
+            Packed_Vertex::enable_attributes();
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_ids[INDICES_EBO]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, index_data, GL_STATIC_DRAW);
+    }
+
+    Terrain::~Terrain()
+    {
+        glDeleteVertexArrays(1, &vao_id);
+        glDeleteBuffers(VBO_COUNT, vbo_ids);
+    }
+
+    int Terrain::build_quadtree(unsigned chunk_x0, unsigned chunk_z0, unsigned chunk_x1, unsigned chunk_z1, const vector<float>& heights, vector<GLuint>& list_indices, vector<GLushort>& strip_indices)
+    {
+        int node_index = (int)quadtree.size();
+        quadtree.emplace_back();
+
+        auto index_count = [&] { return index_mode == TRIANGLE_LIST ? list_indices.size() : strip_indices.size(); };
+
+        Quadtree_Node node;
+        node.first_index = (GLuint)index_count();
+        node.base_vertex = 0;
+        node.x0 = chunk_x0 * chunk_size; node.x1 = std::min(chunk_x1 * chunk_size, x_slices);
+        node.z0 = chunk_z0 * chunk_size; node.z1 = std::min(chunk_z1 * chunk_size, z_slices);
+        node.children[0] = node.children[1] = node.children[2] = node.children[3] = -1;
+
+        if (chunk_x1 - chunk_x0 == 1 && chunk_z1 - chunk_z0 == 1)
+        {
+            // Hoja: un único trozo. Se emiten sus quads y se calcula su caja con las alturas reales.
+            unsigned x0 = chunk_x0 * chunk_size, x1 = std::min(x0 + chunk_size, x_slices);
+            unsigned z0 = chunk_z0 * chunk_size, z1 = std::min(z0 + chunk_size, z_slices);
+            unsigned n_verts_x = x_slices + 1;
+            float    x_step    = width / float(x_slices);
+            float    z_step    = depth / float(z_slices);
+
+            float min_y = heights[z0 * n_verts_x + x0];
+            float max_y = min_y;
+
+            for (unsigned z = z0; z <= z1; ++z)
+            {
+                for (unsigned x = x0; x <= x1; ++x)
+                {
+                    float y = heights[z * n_verts_x + x];
+                    min_y = std::min(min_y, y);
+                    max_y = std::max(max_y, y);
                 }
+            }
+
+            if (index_mode == TRIANGLE_LIST)
+            {
+                Terrain_Mesh::append_optimized_triangles(list_indices, n_verts_x, x0, z0, x1, z1, heights, x_step, z_step);
+            }
+            else
+            {
+                Terrain_Mesh::append_strips(strip_indices, n_verts_x, x0, z0, x1, z1, restart_index);
+                node.base_vertex = GLint(z0 * n_verts_x + x0);
+            }
+
+            // Las posiciones se suben como half, así que la caja se amplía un poco para cubrir el redondeo
+            float margin = std::max(width, depth) / 1024.0f;
+
+            node.box_min = vec3(-width * 0.5f + x0 * x_step - margin, min_y - margin, -depth * 0.5f + z0 * z_step - margin);
+            node.box_max = vec3(-width * 0.5f + x1 * x_step + margin, max_y + margin, -depth * 0.5f + z1 * z_step + margin);
+        }
+        else
+        {
+            // Nodo interior: se divide el rectángulo de trozos en (hasta) cuatro cuadrantes
+            unsigned mid_x = chunk_x1 - chunk_x0 > 1 ? (chunk_x0 + chunk_x1) / 2 : chunk_x1;
+            unsigned mid_z = chunk_z1 - chunk_z0 > 1 ? (chunk_z0 + chunk_z1) / 2 : chunk_z1;
+
+            const unsigned quadrants[4][4] =
+            {
+                { chunk_x0, chunk_z0, mid_x,    mid_z    },
+                { mid_x,    chunk_z0, chunk_x1, mid_z    },
+                { chunk_x0, mid_z,    mid_x,    chunk_z1 },
+                { mid_x,    mid_z,    chunk_x1, chunk_z1 },
+            };
+
+            node.box_min = vec3( std::numeric_limits< float >::max());
+            node.box_max = vec3(-std::numeric_limits< float >::max());
 
-                temp_heights[z * n_verts_x + x] = y_pos;
+            for (int i = 0; i < 4; ++i)
+            {
+                const unsigned * q = quadrants[i];
 
-                coordinates.push_back(half(x_pos));
-                coordinates.push_back(half(y_pos));
-                coordinates.push_back(half(z_pos));
+                if (q[0] < q[2] && q[1] < q[3])
+                {
+                    int child = build_quadtree(q[0], q[1], q[2], q[3], heights, list_indices, strip_indices);
 
-                float u = (float)x / (float)x_slices;
-                float v = (float)z / (float)z_slices;
-                texture_uvs.push_back(half(u));
-                texture_uvs.push_back(half(v));
+                    node.children[i] = child;
+                    node.box_min     = glm::min(node.box_min, quadtree[child].box_min);
+                    node.box_max     = glm::max(node.box_max, quadtree[child].box_max);
+                }
             }
         }
 
-        if (image) SOIL_free_image_data(image);
+        node.index_count = GLsizei(index_count() - node.first_index);
+
+        quadtree[node_index] = node;
+
+        return node_index;
+    }
+
+    bool Terrain::apply_brush(float center_x, float center_z, float radius, float strength)
+    {
+        if (displacement != CPU_DISPLACEMENT || heights.empty() || radius <= 0.0f) return false;
+
+        float x_step = width / float(x_slices);
+        float z_step = depth / float(z_slices);
+
+        // Rectángulo de vértices que alcanza el pincel
+        int x0 = std::max(0,             int(std::ceil ((center_x - radius + width * 0.5f) / x_step)));
+        int x1 = std::min(int(x_slices), int(std::floor((center_x + radius + width * 0.5f) / x_step)));
+        int z0 = std::max(0,             int(std::ceil ((center_z - radius + depth * 0.5f) / z_step)));
+        int z1 = std::min(int(z_slices), int(std::floor((center_z + radius + depth * 0.5f) / z_step)));
+
+        if (x0 > x1 || z0 > z1) return false;
+
+        unsigned n_verts_x      = x_slices + 1;
+        float    inverse_radius = 1.0f / radius;
 
-        // --- PASE 2: Calcular Normales ---
-        for (unsigned z = 0; z < n_verts_z; ++z)
+        for (int z = z0; z <= z1; ++z)
         {
-            for (unsigned x = 0; x < n_verts_x; ++x)
+            for (int x = x0; x <= x1; ++x)
             {
-                // Obtenemos las alturas de los vecinos (Left, Right, Down, Up)
-                // Si estamos en el borde, usamos la propia altura para no salirnos
-                float h_L = (x > 0) ? temp_heights[z * n_verts_x + (x - 1)] : temp_heights[z * n_verts_x + x];
-                float h_R = (x < n_verts_x - 1) ? temp_heights[z * n_verts_x + (x + 1)] : temp_heights[z * n_verts_x + x];
-                float h_D = (z > 0) ? temp_heights[(z - 1) * n_verts_x + x] : temp_heights[z * n_verts_x + x];
-                float h_U = (z < n_verts_z - 1) ? temp_heights[(z + 1) * n_verts_x + x] : temp_heights[z * n_verts_x + x];
-
-                // Calculamos vectores tangentes
-                // Tangente en X: (step*2, delta_height_x, 0)
-                // Tangente en Z: (0, delta_height_z, step*2)
-                glm::vec3 normal(h_L - h_R, 2.0f * x_step, h_D - h_U); // Simplificacin del producto cruz
-                normal = glm::normalize(normal);
-
-                normals.push_back(half(normal.x));
-                normals.push_back(half(normal.y));
-                normals.push_back(half(normal.z));
+                float dx = (-width * 0.5f + x * x_step - center_x) * inverse_radius;
+                float dz = (-depth * 0.5f + z * z_step - center_z) * inverse_radius;
+                float d2 = dx * dx + dz * dz;
+
+                // Caída suave: máxima en el centro y con pendiente nula en el borde del pincel
+                if (d2 < 1.0f) heights[size_t(z) * n_verts_x + x] += strength * (1.0f - d2) * (1.0f - d2);
             }
         }
 
-        // --- PASE 3: ndices ---
-        vector< GLuint > indices;
-        for (unsigned z = 0; z < z_slices; ++z)
+        update_region(unsigned(x0), unsigned(z0), unsigned(x1), unsigned(z1));
+
+        return true;
+    }
+
+    void Terrain::update_region(unsigned x0, unsigned z0, unsigned x1, unsigned z1)
+    {
+        unsigned n_verts_x = x_slices + 1;
+
+        // Las normales dependen de las alturas vecinas, así que cambian también en un vértice más por cada lado
+        unsigned vx0 = x0 > 0 ? x0 - 1 : 0, vx1 = std::min(x1 + 1, x_slices);
+        unsigned vz0 = z0 > 0 ? z0 - 1 : 0, vz1 = std::min(z1 + 1, z_slices);
+        unsigned columns = vx1 - vx0 + 1;
+
+        edited_vertices.resize(size_t(columns) * (vz1 - vz0 + 1));
+
+        Terrain_Mesh::build_vertices(heights, width, depth, x_slices, z_slices, vx0, vz0, vx1, vz1, edited_vertices.data());
+
+        // Solo se suben los tramos de las filas que han cambiado
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[VERTICES_VBO]);
+
+        for (unsigned z = vz0; z <= vz1; ++z)
         {
-            for (unsigned x = 0; x < x_slices; ++x)
-            {
-                GLuint tl = (z * n_verts_x) + x;
-                GLuint tr = (z * n_verts_x) + (x + 1);
-                GLuint bl = ((z + 1) * n_verts_x) + x;
-                GLuint br = ((z + 1) * n_verts_x) + (x + 1);
+            glBufferSubData
+            (
+                GL_ARRAY_BUFFER,
+                GLintptr(size_t(z) * n_verts_x + vx0) * sizeof(Packed_Vertex),
+                GLsizeiptr(columns * sizeof(Packed_Vertex)),
+                &edited_vertices[size_t(z - vz0) * columns]
+            );
+        }
+
+        // Consultas: si una altura se sale del rango cuantizado se rehacen enteras, con margen
+        // para que al seguir esculpiendo no vuelva a pasar enseguida
+        if (height_field.update(heights, x0, z0, x1, z1))
+        {
+            ray_caster.update(x0 > 0 ? x0 - 1 : 0, z0 > 0 ? z0 - 1 : 0, x1, z1);
+        }
+        else
+        {
+            float headroom = std::max(1.0f, 0.25f * (height_field.get_max_height() - height_field.get_min_height()));
+            height_field = Height_Field(heights, n_verts_x, z_slices + 1, height_field.get_origin(), height_field.get_step(), headroom);
+            ray_caster   = Terrain_Ray_Caster(height_field);
+        }
+
+        update_boxes(0, x0, z0, x1, z1);
+    }
+
+    void Terrain::update_boxes(int node_index, unsigned x0, unsigned z0, unsigned x1, unsigned z1)
+    {
+        Quadtree_Node & node = quadtree[node_index];
+
+        // El nodo usa los vértices [node.x0, node.x1] x [node.z0, node.z1]
+        if (node.x0 > x1 || node.x1 < x0 || node.z0 > z1 || node.z1 < z0) return;
+
+        bool is_leaf = node.children[0] < 0 && node.children[1] < 0 && node.children[2] < 0 && node.children[3] < 0;
 
-                indices.push_back(tl); indices.push_back(bl); indices.push_back(tr);
-                indices.push_back(tr); indices.push_back(bl); indices.push_back(br);
+        if (is_leaf)
+        {
+            unsigned n_verts_x = x_slices + 1;
+            float    min_y     = heights[node.z0 * n_verts_x + node.x0];
+            float    max_y     = min_y;
+
+            for (unsigned z = node.z0; z <= node.z1; ++z)
+            {
+                for (unsigned x = node.x0; x <= node.x1; ++x)
+                {
+                    float y = heights[z * n_verts_x + x];
+                    min_y = std::min(min_y, y);
+                    max_y = std::max(max_y, y);
+                }
             }
+
+            // Mismo margen que en build_quadtree
+            float margin = std::max(width, depth) / 1024.0f;
+
+            node.box_min.y = min_y - margin;
+            node.box_max.y = max_y + margin;
+
+            return;
         }
-        number_of_indices = (GLsizei)indices.size();
 
-        // --- OPENGL CONFIG ---
-        glGenVertexArrays(1, &vao_id);
-        glGenBuffers(VBO_COUNT, vbo_ids);
+        node.box_min.y =  std::numeric_limits< float >::max();
+        node.box_max.y = -std::numeric_limits< float >::max();
 
-        glBindVertexArray(vao_id);
+        for (int child : node.children)
+        {
+            if (child < 0) continue;
 
-        // 1. Position
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[COORDINATES_VBO]);
-        glBufferData(GL_ARRAY_BUFFER, coordinates.size() * sizeof(half), coordinates.data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, 0, 0);
-
-        // 2. UVs
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[TEXTURE_UVS_VBO]);
-        glBufferData(GL_ARRAY_BUFFER, texture_uvs.size() * sizeof(half), texture_uvs.data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, 0, 0);
-
-        // 3. NORMALS (Location 2) <--- IMPORTANTE
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_ids[NORMALS_VBO]);
-        glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(half), normals.data(), GL_STATIC_DRAW);
-        glEnableVertexAttribArray(2); // Location 2 en el shader
-        glVertexAttribPointer(2, 3, GL_HALF_FLOAT, GL_FALSE, 0, 0);
-
-        // 4. Indices
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_ids[INDICES_EBO]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+            update_boxes(child, x0, z0, x1, z1);
+
+            // quadtree[node_index] sigue siendo válido: el vector no cambia de tamaño
+            node.box_min.y = std::min(node.box_min.y, quadtree[child].box_min.y);
+            node.box_max.y = std::max(node.box_max.y, quadtree[child].box_max.y);
+        }
     }
 
-    Terrain::~Terrain()
+    void Terrain::collect_visible(int node_index, const Frustum& frustum, bool is_inside)
     {
-        glDeleteVertexArrays(1, &vao_id);
-        glDeleteBuffers(VBO_COUNT, vbo_ids);
+        const Quadtree_Node& node = quadtree[node_index];
+
+        Frustum::Result result = is_inside ? Frustum::INSIDE : frustum.classify(node.box_min, node.box_max);
+
+        if (result == Frustum::OUTSIDE) return;
+
+        bool is_leaf = node.children[0] < 0 && node.children[1] < 0 && node.children[2] < 0 && node.children[3] < 0;
+
+        if (index_mode == TRIANGLE_STRIPS && is_leaf)
+        {
+            // Cada trozo tiene su propio base vertex, así que no se pueden fusionar rangos
+            draw_counts       .push_back(node.index_count);
+            draw_offsets      .push_back(reinterpret_cast<const void*>(size_t(node.first_index) * sizeof(GLushort)));
+            draw_base_vertices.push_back(node.base_vertex);
+
+            return;
+        }
+
+        if (result == Frustum::INSIDE && index_mode == TRIANGLE_STRIPS)
+        {
+            // Nodo completamente dentro: se añaden todas sus hojas sin volver a comprobarlas
+            for (int child : node.children)
+            {
+                if (child >= 0) collect_visible(child, frustum, true);
+            }
+
+            return;
+        }
+
+        if (result == Frustum::INSIDE || is_leaf)
+        {
+            // Si el rango empieza justo donde acaba el anterior se fusionan en una sola llamada
+            size_t offset = size_t(node.first_index) * sizeof(GLuint);
+
+            if (!draw_counts.empty() && reinterpret_cast<size_t>(draw_offsets.back()) + size_t(draw_counts.back()) * sizeof(GLuint) == offset)
+            {
+                draw_counts.back() += node.index_count;
+            }
+            else
+            {
+                draw_counts .push_back(node.index_count);
+                draw_offsets.push_back(reinterpret_cast<const void*>(offset));
+            }
+
+            return;
+        }
+
+        for (int child : node.children)
+        {
+            if (child >= 0) collect_visible(child, frustum);
+        }
     }
 
-    void Terrain::render()
+    void Terrain::render(const Camera& camera, GL_State& gl_state, Shader_Program* program)
     {
-        glBindVertexArray(vao_id);
-        glDrawElements(GL_TRIANGLES, number_of_indices, GL_UNSIGNED_INT, 0);
+        // El terreno se dibuja con matriz de modelo identidad, así que el frustum en
+        // coordenadas de mundo sale directamente de proyección * vista.
+        Frustum frustum(camera.get_projection_matrix() * camera.get_transform_matrix_inverse());
+
+        draw_counts       .clear();
+        draw_offsets      .clear();
+        draw_base_vertices.clear();
+
+        if (!quadtree.empty()) collect_visible(0, frustum);
+
+        if (draw_counts.empty()) return;
+
+        if (displacement == GPU_DISPLACEMENT)
+        {
+            assert(program);
+
+            if (program->get_id() != program_id)
+            {
+                program_id      = program->get_id();
+                terrain_id      = program->get_uniform_id("u_terrain");
+                height_scale_id = program->get_uniform_id("u_height_scale");
+                grid_step_id    = program->get_uniform_id("u_grid_step");
+                height_map_id   = program->get_uniform_id("u_height_map");
+            }
+
+            // Son constantes: Shader_Program solo los sube la primera vez
+            program->set(terrain_id, glm::vec4(-width * 0.5f, -depth * 0.5f, width, depth));
+            program->set(height_scale_id, glm::vec2(max_height, -max_height * 0.15f));
+            program->set(grid_step_id, glm::vec2(1.0f / x_slices, 1.0f / z_slices));
+            program->set(height_map_id, GLint(1));
+
+            height_texture->bind(gl_state, 1);
+        }
+
+        gl_state.bind_vertex_array(vao_id);
+
+        if (index_mode == TRIANGLE_STRIPS)
+        {
+            gl_state.set_primitive_restart(true);
+            gl_state.set_restart_index(restart_index);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLE_STRIP, draw_counts.data(), GL_UNSIGNED_SHORT, draw_offsets.data(), (GLsizei)draw_counts.size(), draw_base_vertices.data());
+            gl_state.set_primitive_restart(false);
+        }
+        else
+        {
+            glMultiDrawElements(GL_TRIANGLES, draw_counts.data(), GL_UNSIGNED_INT, draw_offsets.data(), (GLsizei)draw_counts.size());
+        }
     }
 }
\ No newline at end of file
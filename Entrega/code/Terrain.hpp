@@ -5,42 +5,164 @@
 #define GROUND_HEADER
 
 #include <glad/gl.h>
+#include <glm.hpp>
+#include <memory>
 #include <string>
 #include <vector>
+#include "Camera.hpp"
+#include "Frustum.hpp"
+#include "GL_State.hpp"
+#include "Height_Field.hpp"
+#include "Height_Map.hpp"
+#include "Height_Texture.hpp"
+#include "Packed_Vertex.hpp"
+#include "Shader_Program.hpp"
+#include "Terrain_Cache.hpp"
+#include "Terrain_Ray_Caster.hpp"
 
 namespace udit
 {
 
     class Terrain
     {
+    public:
+
+        // Donde se aplica la altura a los vertices
+        enum Displacement
+        {
+            CPU_DISPLACEMENT,   // Posiciones y normales calculadas en la CPU (vertices Packed_Vertex)
+            GPU_DISPLACEMENT    // Rejilla plana (2 x unorm16 por vertice) desplazada en el vertex shader
+        };
+
+        // Como se generan los indices de cada trozo
+        enum Index_Mode
+        {
+            TRIANGLE_LIST,      // GL_UNSIGNED_INT, 6 indices por quad
+            TRIANGLE_STRIPS     // GL_UNSIGNED_SHORT, una tira por fila con primitive restart (base vertex por trozo)
+        };
+
     private:
 
         enum
         {
-            COORDINATES_VBO,
-            TEXTURE_UVS_VBO,
-            NORMALS_VBO,      // <--- NUEVO: Buffer para las normales
+            VERTICES_VBO,     // Vértices entrelazados (Packed_Vertex) o rejilla plana con GPU_DISPLACEMENT
             INDICES_EBO,
             VBO_COUNT
         };
 
+        // Secciones de la caché de la malla (ver Terrain_Cache), en este orden
+        enum
+        {
+            CACHED_HEIGHTS,         // float por vértice (solo CPU_DISPLACEMENT, para editar)
+            CACHED_VERTICES,        // Contenido del VBO
+            CACHED_INDICES,         // Contenido del EBO
+            CACHED_QUADTREE,        // Quadtree_Node
+            CACHED_FIELD_SAMPLES,   // Alturas cuantizadas de height_field
+            CACHED_FIELD_RANGE,     // Altura mínima y escala de height_field
+            CACHED_PYRAMID,         // Pirámide min/max de ray_caster
+            CACHE_SECTION_COUNT
+        };
+
+        // Nodo del quadtree de trozos (chunks). Los indices de todos los trozos que cuelgan
+        // de un nodo estan seguidos en el EBO, asi que un nodo entero se pinta con un solo rango.
+        struct Quadtree_Node
+        {
+            glm::vec3 box_min;
+            glm::vec3 box_max;
+            GLuint    first_index;
+            GLsizei   index_count;
+            GLint     base_vertex;    // Primer vertice del trozo (solo hojas, con TRIANGLE_STRIPS)
+            unsigned  x0, z0, x1, z1; // Quads que cubre el nodo (para rehacer la caja al editar)
+            int       children[4];    // -1 si no hay hijo (las hojas son trozos)
+        };
+
     private:
 
         GLuint  vao_id;
         GLuint  vbo_ids[VBO_COUNT];
         GLsizei number_of_indices;
 
+        float    width, depth;
+        unsigned x_slices, z_slices;
+        float    max_height;
+
+        Displacement                      displacement;
+        Index_Mode                        index_mode;
+        std::unique_ptr< Height_Texture > height_texture;   // Solo con GPU_DISPLACEMENT
+
+        std::vector< float > heights;                       // Alturas de la rejilla (solo CPU_DISPLACEMENT, para editar)
+        std::vector< Packed_Vertex > edited_vertices;       // Vertices recalculados en la ultima edicion
+
+        Height_Field       height_field;                    // Alturas en la CPU para las consultas
+        Terrain_Ray_Caster ray_caster;                      // Piramide min/max sobre height_field
+
+        GLuint  program_id;                                 // Programa para el que estan buscados los uniforms
+        Shader_Program::Uniform_Id terrain_id, height_scale_id, grid_step_id, height_map_id;
+
+        std::vector< Quadtree_Node > quadtree;      // quadtree[0] es la raiz
+
+        // Rangos visibles del frame actual (se reutilizan para no reservar memoria cada frame):
+        std::vector< GLsizei      > draw_counts;
+        std::vector< const void * > draw_offsets;
+        std::vector< GLint        > draw_base_vertices;     // Solo con TRIANGLE_STRIPS
+
     public:
 
-        Terrain(const std::string& heightmap_path, float width, float depth, unsigned x_slices, unsigned z_slices, float max_height);
+        // heightmap_path solo se usa para la clave de la cache; las alturas salen de height_map (ya
+        // cargado, ver Height_Map). cache_directory: donde se guarda la malla generada (con la
+        // barra final). Vacio = sin cache.
+        Terrain(const std::string& heightmap_path, const Height_Map& height_map, float width, float depth, unsigned x_slices, unsigned z_slices, float max_height,
+                Displacement displacement = CPU_DISPLACEMENT, Index_Mode index_mode = TRIANGLE_LIST, const std::string& cache_directory = "");
         ~Terrain();
 
     public:
 
-        void render();
+        // Pinta solo los trozos que quedan dentro del frustum de la camara. Con GPU_DISPLACEMENT
+        // hay que pasar el programa activo (enlazado con shaders/terrain_displacement.vert).
+        void render(const Camera & camera, GL_State & gl_state, Shader_Program * program = nullptr);
+
+        Displacement get_displacement() const { return displacement; }
+        Index_Mode   get_index_mode  () const { return index_mode;   }
+
+        // Consultas del suelo en coordenadas de mundo (interpolacion bilineal, sin tocar la GPU)
+        float     height_at  (float x, float z) const { return height_field.height_at(x, z); }
+        glm::vec3 normal_at  (float x, float z) const { return height_field.normal_at(x, z); }
+        void      heights_at (const float * xs, const float * zs, float * heights, size_t count) const
+        {
+            height_field.heights_at(xs, zs, heights, count);
+        }
+
+        // Primer punto del terreno que toca el rayo (picking, linea de vision...)
+        bool intersect (const Terrain_Ray_Caster::Ray & ray, Terrain_Ray_Caster::Hit & hit) const
+        {
+            return ray_caster.intersect(ray, hit);
+        }
+
+        // Sube (strength > 0) o baja el terreno alrededor de (center_x, center_z) con una caida suave
+        // hasta radius. Solo se recalculan y se suben a la GPU los vertices del rectangulo afectado.
+        // Devuelve false si el terreno no se puede editar (GPU_DISPLACEMENT) o el pincel cae fuera.
+        bool apply_brush (float center_x, float center_z, float radius, float strength);
+
+        const Height_Field       & get_height_field () const { return height_field; }
+        const Terrain_Ray_Caster & get_ray_caster   () const { return ray_caster;   }
+
+    private:
+
+        int  build_quadtree  (unsigned chunk_x0, unsigned chunk_z0, unsigned chunk_x1, unsigned chunk_z1,
+                              const std::vector< float > & heights, std::vector< GLuint > & list_indices, std::vector< GLushort > & strip_indices);
+        void collect_visible (int node_index, const Frustum & frustum, bool is_inside = false);
+
+        // Carga las alturas, el quadtree y los buffers desde la caché (false si no vale)
+        bool load_cache      (const std::string & cache_path, const Terrain_Cache::Key & cache_key);
+        void upload_buffers  (const void * vertex_data, size_t vertex_bytes, const void * index_data, size_t index_bytes);
+
+        // Recalcula y sube los vertices cuyas alturas han cambiado en [x0, x1] x [z0, z1] (incluidos)
+        // y actualiza las consultas y las cajas del quadtree
+        void update_region   (unsigned x0, unsigned z0, unsigned x1, unsigned z1);
+        void update_boxes    (int node_index, unsigned x0, unsigned z0, unsigned x1, unsigned z1);
 
     };
 
 }
 
-#endif
\ No newline at end of file
+#endif
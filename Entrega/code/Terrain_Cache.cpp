@@ -0,0 +1,149 @@
+// Terrain_Cache.cpp
+// angel.rodriguez@udit.es
+
+#include "Terrain_Cache.hpp"
+#include "File_System.hpp"
+#include "Hash.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace udit
+{
+
+    namespace
+    {
+        constexpr uint64_t section_align    = 16;
+
+        uint64_t align(uint64_t offset)
+        {
+            return (offset + section_align - 1) & ~(section_align - 1);
+        }
+
+        bool same_key(const Terrain_Cache::Key & a, const Terrain_Cache::Key & b)
+        {
+            return a.source_hash == b.source_hash
+                && a.width       == b.width
+                && a.depth       == b.depth
+                && a.max_height  == b.max_height
+                && a.x_slices    == b.x_slices
+                && a.z_slices    == b.z_slices
+                && a.layout      == b.layout;
+        }
+    }
+
+    uint64_t Terrain_Cache::hash_file(const std::string& path)
+    {
+        Mapped_File source(path);
+
+        if (!source.is_open()) return 0;
+
+        return fnv1a(source.get_data(), source.get_size());
+    }
+
+    std::string Terrain_Cache::cache_path(const std::string& directory, const std::string& heightmap_path, const Key& key)
+    {
+        // El nombre depende solo de los parametros: si cambia el heightmap se reescribe el mismo fichero
+        uint32_t parameters[6];
+        std::memcpy(&parameters[0], &key.width,      sizeof(float));
+        std::memcpy(&parameters[1], &key.depth,      sizeof(float));
+        std::memcpy(&parameters[2], &key.max_height, sizeof(float));
+        parameters[3] = key.x_slices;
+        parameters[4] = key.z_slices;
+        parameters[5] = key.layout;
+
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%08x.udtc", unsigned(fnv1a(parameters, sizeof(parameters)) & 0xFFFFFFFFu));
+
+        return directory + file_stem(heightmap_path) + suffix;
+    }
+
+    bool Terrain_Cache::write(const std::string& path, const Key& key, const std::vector< Section >& sections)
+    {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "UDTC", 4);
+        header.version       = version;
+        header.key           = key;
+        header.section_count = uint32_t(sections.size());
+
+        std::vector< Section_Entry > entries(sections.size());
+
+        uint64_t offset = align(sizeof(Header) + sections.size() * sizeof(Section_Entry));
+
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            entries[i].offset = offset;
+            entries[i].size   = sections[i].size;
+            offset = align(offset + sections[i].size);
+        }
+
+        // Se escribe en un fichero temporal y se renombra al final: si el programa se cierra a
+        // medias no queda una cache incompleta con la clave correcta
+        std::string temporary_path = path + ".tmp";
+
+        create_parent_directory(path);
+
+        {
+            std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+
+            if (output.good())
+            {
+                static const char padding[section_align] = { };
+
+                output.write(reinterpret_cast< const char * >(&header), sizeof(header));
+                output.write(reinterpret_cast< const char * >(entries.data()), entries.size() * sizeof(Section_Entry));
+
+                uint64_t written = sizeof(Header) + entries.size() * sizeof(Section_Entry);
+
+                for (size_t i = 0; i < sections.size(); ++i)
+                {
+                    output.write(padding, std::streamsize(entries[i].offset - written));
+                    output.write(static_cast< const char * >(sections[i].data), std::streamsize(sections[i].size));
+                    written = entries[i].offset + sections[i].size;
+                }
+            }
+
+            if (!output.good())
+            {
+                std::cerr << "AVISO: No se pudo escribir la cache del terreno " << path << std::endl;
+                output.close();
+                std::remove(temporary_path.c_str());
+                return false;
+            }
+        }
+
+        return replace_file(temporary_path, path);
+    }
+
+    Terrain_Cache::Terrain_Cache(const std::string& path, const Key& key)
+        : file(path), header(nullptr), sections(nullptr)
+    {
+        if (!file.is_open() || file.get_size() < sizeof(Header)) return;
+
+        const Header * candidate = reinterpret_cast< const Header * >(file.get_data());
+
+        if (std::memcmp(candidate->magic, "UDTC", 4) != 0 || candidate->version != version || !same_key(candidate->key, key)) return;
+
+        // Se comprueba que la tabla y todas las secciones caben en el fichero antes de aceptarla
+        size_t section_count = candidate->section_count;
+
+        if (file.get_size() < sizeof(Header) + section_count * sizeof(Section_Entry)) return;
+
+        const Section_Entry * entries = reinterpret_cast< const Section_Entry * >(file.get_data() + sizeof(Header));
+
+        for (size_t i = 0; i < section_count; ++i)
+        {
+            if (entries[i].offset % section_align != 0 || entries[i].offset + entries[i].size > file.get_size())
+            {
+                std::cerr << "AVISO: La cache del terreno " << path << " esta truncada." << std::endl;
+                return;
+            }
+        }
+
+        header   = candidate;
+        sections = entries;
+    }
+
+}
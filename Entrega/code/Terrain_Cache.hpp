@@ -0,0 +1,109 @@
+// Terrain_Cache.hpp
+// angel.rodriguez@udit.es
+
+#ifndef TERRAIN_CACHE_HEADER
+#define TERRAIN_CACHE_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Mapped_File.hpp"
+
+namespace udit
+{
+
+    // Cache en disco de la malla generada de un terreno: guarda los buffers ya listos para subir
+    // a la GPU (vertices, indices, quadtree, alturas...) como secciones binarias y en los
+    // arranques siguientes se proyecta en memoria, asi que no hay que decodificar el heightmap
+    // ni recalcular nada por vertice.
+    //
+    // Formato (little endian):
+    //   Header      magic "UDTC", version, clave, numero de secciones
+    //   Section     offset y tamano de cada seccion desde el principio del fichero
+    //   datos       cada seccion alineada a 16 bytes
+    //
+    // La clave incluye un hash del contenido del heightmap y los parametros de construccion: si
+    // algo no coincide la cache no se usa y quien la lee la vuelve a escribir.
+
+    class Terrain_Cache
+    {
+    public:
+
+        static const uint32_t version = 1;
+
+        struct Key
+        {
+            uint64_t source_hash;               // Hash del fichero del heightmap (ver hash_file)
+            float    width, depth, max_height;
+            uint32_t x_slices, z_slices;
+            uint32_t layout;                    // Modo de construccion y formato de las secciones (lo decide quien usa la cache)
+        };
+
+        struct Section
+        {
+            const void * data;
+            size_t       size;
+        };
+
+    private:
+
+        struct Header
+        {
+            char     magic[4];
+            uint32_t version;
+            Key      key;
+            uint32_t section_count;
+            uint32_t reserved;
+        };
+
+        struct Section_Entry
+        {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+    private:
+
+        Mapped_File           file;
+        const Header        * header;
+        const Section_Entry * sections;
+
+    public:
+
+        // Hash FNV-1a (por palabras de 64 bits) del contenido del fichero, 0 si no se puede abrir.
+        // Solo se leen los bytes, sin decodificar la imagen.
+        static uint64_t hash_file (const std::string & path);
+
+        // Fichero de cache para un heightmap y unos parametros: cada combinacion tiene el suyo
+        // dentro de directory (con la barra final; vacio = el directorio de trabajo), para que
+        // varios terrenos del mismo heightmap no se pisen.
+        static std::string cache_path (const std::string & directory, const std::string & heightmap_path, const Key & key);
+
+        // Escribe la cache completa (creando el directorio si hace falta). Devuelve false si no se
+        // ha podido escribir (no es grave: la proxima vez se vuelve a generar la malla).
+        static bool write (const std::string & path, const Key & key, const std::vector< Section > & sections);
+
+        // Abre y valida la cache. Si la clave no coincide o el fichero esta incompleto, is_valid()
+        // devuelve false.
+        Terrain_Cache(const std::string & path, const Key & key);
+
+    private:
+
+        Terrain_Cache(const Terrain_Cache & ) = delete;
+        Terrain_Cache & operator = (const Terrain_Cache & ) = delete;
+
+    public:
+
+        bool   is_valid          () const { return header != nullptr; }
+        size_t get_section_count () const { return header->section_count; }
+
+        // Datos de una seccion dentro del fichero proyectado (validos mientras viva la cache)
+        const void * get_section_data (size_t index) const { return file.get_data() + sections[index].offset; }
+        size_t       get_section_size (size_t index) const { return size_t(sections[index].size); }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,431 @@
+// Terrain_Mesh.cpp
+// angel.rodriguez@udit.es
+
+#include "Terrain_Mesh.hpp"
+#include "Mesh_Optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define TERRAIN_MESH_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+// Con GCC y Clang las funciones con instrucciones F16C se compilan aparte sin cambiar las
+// opciones de todo el proyecto (MSVC no lo necesita)
+#if defined(TERRAIN_MESH_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define TARGET_F16C __attribute__((target("avx,f16c")))
+#else
+    #define TARGET_F16C
+#endif
+
+using std::vector;
+using half_float::half;
+
+namespace udit
+{
+
+    namespace
+    {
+
+        // Reparte las filas [0, rows) entre varios hilos. El hilo actual procesa el ultimo bloque.
+        template< typename FUNCTION >
+        void for_each_row_block(unsigned rows, unsigned thread_count, FUNCTION function)
+        {
+            thread_count = std::max(1u, std::min(thread_count, rows / 16 + 1));
+
+            vector< std::thread > threads;
+            threads.reserve(thread_count - 1);
+
+            for (unsigned thread = 0; thread < thread_count; ++thread)
+            {
+                unsigned first = unsigned(size_t(rows) *  thread      / thread_count);
+                unsigned last  = unsigned(size_t(rows) * (thread + 1) / thread_count);
+
+                if (thread + 1 < thread_count) threads.emplace_back(function, first, last);
+                else                           function(first, last);
+            }
+
+            for (auto & thread : threads) thread.join();
+        }
+
+        bool cpu_supports_f16c()
+        {
+        #if defined(TERRAIN_MESH_X86) && defined(_MSC_VER)
+            int registers[4];
+            __cpuid(registers, 1);
+            // ECX: bit 29 = F16C, bit 28 = AVX, bit 27 = OSXSAVE (el sistema guarda los registros YMM)
+            bool avx_enabled = (registers[2] & (1 << 27)) && (registers[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+            return avx_enabled && (registers[2] & (1 << 29));
+        #elif defined(TERRAIN_MESH_X86)
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+        #else
+            return false;
+        #endif
+        }
+
+        const bool f16c_enabled = cpu_supports_f16c();
+
+        #ifdef TERRAIN_MESH_X86
+
+            TARGET_F16C void convert_to_half_f16c(const float * source, half * target, size_t count)
+            {
+                size_t i = 0;
+
+                for ( ; i + 8 <= count; i += 8)
+                {
+                    __m128i converted = _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT);
+                    _mm_storeu_si128(reinterpret_cast< __m128i * >(target + i), converted);
+                }
+
+                for ( ; i < count; ++i) target[i] = half(source[i]);
+            }
+
+        #endif
+
+        void convert_to_half(const float * source, half * target, size_t count)
+        {
+        #ifdef TERRAIN_MESH_X86
+            if (f16c_enabled)
+            {
+                convert_to_half_f16c(source, target, count);
+                return;
+            }
+        #endif
+
+            for (size_t i = 0; i < count; ++i) target[i] = half(source[i]);
+        }
+
+        // Normal de un vertice a partir de las alturas vecinas (misma formula que en el shader)
+        inline void scalar_normal(float h_l, float h_r, float h_d, float h_u, float two_x_step, float * normal)
+        {
+            float x = h_l - h_r, y = two_x_step, z = h_d - h_u;
+            float inverse_length = 1.0f / std::sqrt(x * x + y * y + z * z);
+
+            normal[0] = x * inverse_length;
+            normal[1] = y * inverse_length;
+            normal[2] = z * inverse_length;
+        }
+
+    }
+
+    bool Terrain_Mesh::is_f16c_enabled()
+    {
+        return f16c_enabled;
+    }
+
+    void Terrain_Mesh::append_triangles(vector< GLuint >& indices, unsigned n_verts_x, unsigned x0, unsigned z0, unsigned x1, unsigned z1)
+    {
+        for (unsigned z = z0; z < z1; ++z)
+        {
+            for (unsigned x = x0; x < x1; ++x)
+            {
+                GLuint tl = (z * n_verts_x) + x;
+                GLuint tr = (z * n_verts_x) + (x + 1);
+                GLuint bl = ((z + 1) * n_verts_x) + x;
+                GLuint br = ((z + 1) * n_verts_x) + (x + 1);
+
+                indices.push_back(tl); indices.push_back(bl); indices.push_back(tr);
+                indices.push_back(tr); indices.push_back(bl); indices.push_back(br);
+            }
+        }
+    }
+
+    void Terrain_Mesh::append_optimized_triangles
+    (
+        vector< GLuint >& indices, unsigned n_verts_x, unsigned x0, unsigned z0, unsigned x1, unsigned z1,
+        const vector< float >& heights, float x_step, float z_step
+    )
+    {
+        // Se optimiza el trozo con indices locales (compactos) y luego se pasan a la rejilla
+        unsigned local_x = x1 - x0 + 1;
+        unsigned local_z = z1 - z0 + 1;
+
+        vector< glm::vec3 > local_positions(size_t(local_x) * local_z);
+
+        // El orden para la cache solo depende del tamano del trozo (casi todos son iguales), asi
+        // que se calcula una vez por tamano. El de overdraw depende de las alturas de cada uno.
+        thread_local std::map< std::pair< unsigned, unsigned >, vector< GLuint > > cache_orders;
+
+        vector< GLuint > & cache_order = cache_orders[std::make_pair(local_x, local_z)];
+
+        if (cache_order.empty())
+        {
+            append_triangles(cache_order, local_x, 0, 0, x1 - x0, z1 - z0);
+            Mesh_Optimizer::optimize_vertex_cache(cache_order, local_positions.size());
+        }
+
+        vector< GLuint > local_indices(cache_order);
+
+        for (unsigned z = 0; z < local_z; ++z)
+        {
+            for (unsigned x = 0; x < local_x; ++x)
+            {
+                local_positions[z * local_x + x] = glm::vec3(x * x_step, heights[size_t(z0 + z) * n_verts_x + x0 + x], z * z_step);
+            }
+        }
+
+        Mesh_Optimizer::optimize_overdraw(local_indices, local_positions);
+
+        for (GLuint index : local_indices)
+        {
+            indices.push_back((z0 + index / local_x) * n_verts_x + x0 + index % local_x);
+        }
+    }
+
+    void Terrain_Mesh::append_strips(vector< GLushort >& indices, unsigned n_verts_x, unsigned x0, unsigned z0, unsigned x1, unsigned z1, GLushort restart_index, unsigned strip_width)
+    {
+        // El trozo se recorre en bandas verticales de strip_width quads. Dentro de una banda,
+        // cada tira (tl, bl, tr, br...) mete en la cache 2 * (strip_width + 1) vertices y la
+        // siguiente fila reutiliza la mitad inferior, que sigue en una FIFO de ese tamano.
+        // Los triangulos (y su sentido) son los mismos que los de append_triangles.
+        strip_width = std::max(strip_width, 1u);
+
+        bool first_strip = true;
+
+        for (unsigned band_x0 = x0; band_x0 < x1; band_x0 += strip_width)
+        {
+            unsigned band_x1 = std::min(band_x0 + strip_width, x1);
+
+            for (unsigned z = z0; z < z1; ++z)
+            {
+                if (!first_strip) indices.push_back(restart_index);
+
+                first_strip = false;
+
+                for (unsigned x = band_x0; x <= band_x1; ++x)
+                {
+                    indices.push_back(GLushort((z     - z0) * n_verts_x + (x - x0)));
+                    indices.push_back(GLushort((z + 1 - z0) * n_verts_x + (x - x0)));
+                }
+            }
+        }
+    }
+
+    Terrain_Mesh::Terrain_Mesh
+    (
+        const Height_Map * height_map,
+        float width, float depth, unsigned x_slices, unsigned z_slices, float max_height,
+        bool with_attributes, unsigned thread_count
+    )
+    {
+        unsigned n_verts_x = x_slices + 1;
+        unsigned n_verts_z = z_slices + 1;
+        size_t   total_vertices = size_t(n_verts_x) * n_verts_z;
+
+        if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        heights.resize(total_vertices);
+
+        if (with_attributes) vertices.resize(total_vertices);
+
+        float x_step = width / float(x_slices);
+        float z_step = depth / float(z_slices);
+
+        if (height_map && height_map->is_empty()) height_map = nullptr;
+
+        // La columna del heightmap de cada x es la misma en todas las filas
+        vector< int > image_columns(n_verts_x, 0);
+
+        for (unsigned x = 0; x < n_verts_x && height_map; ++x)
+        {
+            image_columns[x] = (int)((float)x / x_slices * (height_map->get_width() - 1));
+        }
+
+        // La u de cada columna tambien es la misma en todas las filas
+        vector< GLushort > u_column(n_verts_x);
+
+        for (unsigned x = 0; x < n_verts_x; ++x)
+        {
+            u_column[x] = Packed_Vertex::pack_unorm16((float)x / (float)x_slices);
+        }
+
+        // --- PASE 1: alturas, posiciones y UVs ---
+        for_each_row_block(n_verts_z, thread_count, [&](unsigned first_row, unsigned last_row)
+        {
+            vector< float > row     (size_t(n_verts_x) * 4);
+            vector< half  > half_row(size_t(n_verts_x) * 4);
+
+            for (unsigned z = first_row; z < last_row; ++z)
+            {
+                float * row_heights = heights.data() + size_t(z) * n_verts_x;
+
+                if (height_map)
+                {
+                    int img_y = (int)((float)z / z_slices * (height_map->get_height() - 1));
+
+                    for (unsigned x = 0; x < n_verts_x; ++x)
+                    {
+                        float y_pos = height_map->value(image_columns[x], img_y) * max_height;
+                        row_heights[x] = y_pos - max_height * 0.15f;
+                    }
+                }
+                else
+                {
+                    std::fill(row_heights, row_heights + n_verts_x, 0.0f);
+                }
+
+                if (!with_attributes) continue;
+
+                float z_pos = -depth * 0.5f + z * z_step;
+
+                // Las posiciones se convierten a half con el relleno incluido (4 valores por vertice)
+                for (unsigned x = 0; x < n_verts_x; ++x)
+                {
+                    row[x * 4 + 0] = -width * 0.5f + x * x_step;
+                    row[x * 4 + 1] = row_heights[x];
+                    row[x * 4 + 2] = z_pos;
+                    row[x * 4 + 3] = 0.0f;
+                }
+
+                convert_to_half(row.data(), half_row.data(), half_row.size());
+
+                Packed_Vertex * row_vertices = vertices.data() + size_t(z) * n_verts_x;
+                GLushort        v            = Packed_Vertex::pack_unorm16((float)z / (float)z_slices);
+
+                for (unsigned x = 0; x < n_verts_x; ++x)
+                {
+                    std::memcpy(row_vertices[x].position, &half_row[x * 4], sizeof(row_vertices[x].position));
+
+                    row_vertices[x].uv[0] = u_column[x];
+                    row_vertices[x].uv[1] = v;
+                }
+            }
+        });
+
+        if (!with_attributes) return;
+
+        // --- PASE 2: normales por diferencias centrales (necesita todas las alturas del pase 1) ---
+        float two_x_step = 2.0f * x_step;
+
+        for_each_row_block(n_verts_z, thread_count, [&](unsigned first_row, unsigned last_row)
+        {
+            vector< float > row(size_t(n_verts_x) * 3);
+
+            for (unsigned z = first_row; z < last_row; ++z)
+            {
+                // En los bordes se usa la propia altura para no salirse de la rejilla
+                const float * center = heights.data() + size_t(z) * n_verts_x;
+                const float * down   = z > 0             ? center - n_verts_x : center;
+                const float * up     = z < n_verts_z - 1 ? center + n_verts_x : center;
+
+                unsigned x = 0;
+
+                if (n_verts_x > 1)
+                {
+                    scalar_normal(center[0], center[1], down[0], up[0], two_x_step, &row[0]);
+                    x = 1;
+                }
+
+            #ifdef TERRAIN_MESH_X86
+                // Cuatro vertices interiores a la vez. Se usa division y raiz exactas (no rsqrt)
+                // para que el resultado coincida con el escalar.
+                __m128 y_value = _mm_set1_ps(two_x_step);
+
+                for ( ; x + 4 < n_verts_x; x += 4)
+                {
+                    __m128 nx = _mm_sub_ps(_mm_loadu_ps(center + x - 1), _mm_loadu_ps(center + x + 1));
+                    __m128 nz = _mm_sub_ps(_mm_loadu_ps(down   + x    ), _mm_loadu_ps(up     + x    ));
+
+                    __m128 length_2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(y_value, y_value)), _mm_mul_ps(nz, nz));
+                    __m128 inverse  = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(length_2));
+
+                    alignas(16) float xs[4], ys[4], zs[4];
+                    _mm_store_ps(xs, _mm_mul_ps(nx, inverse));
+                    _mm_store_ps(ys, _mm_mul_ps(y_value, inverse));
+                    _mm_store_ps(zs, _mm_mul_ps(nz, inverse));
+
+                    for (unsigned i = 0; i < 4; ++i)
+                    {
+                        row[(x + i) * 3 + 0] = xs[i];
+                        row[(x + i) * 3 + 1] = ys[i];
+                        row[(x + i) * 3 + 2] = zs[i];
+                    }
+                }
+            #endif
+
+                for ( ; x < n_verts_x; ++x)
+                {
+                    float h_l = x > 0             ? center[x - 1] : center[x];
+                    float h_r = x < n_verts_x - 1 ? center[x + 1] : center[x];
+
+                    scalar_normal(h_l, h_r, down[x], up[x], two_x_step, &row[x * 3]);
+                }
+
+                Packed_Vertex * row_vertices = vertices.data() + size_t(z) * n_verts_x;
+
+                for (x = 0; x < n_verts_x; ++x)
+                {
+                    row_vertices[x].set_normal(glm::vec3(row[x * 3], row[x * 3 + 1], row[x * 3 + 2]));
+                }
+            }
+        });
+    }
+
+    void Terrain_Mesh::build_vertices
+    (
+        const vector< float > & heights, float width, float depth, unsigned x_slices, unsigned z_slices,
+        unsigned x0, unsigned z0, unsigned x1, unsigned z1, Packed_Vertex * vertices
+    )
+    {
+        unsigned n_verts_x  = x_slices + 1;
+        unsigned n_verts_z  = z_slices + 1;
+        unsigned columns    = x1 - x0 + 1;
+        float    x_step     = width / float(x_slices);
+        float    z_step     = depth / float(z_slices);
+        float    two_x_step = 2.0f * x_step;
+
+        vector< float > row     (size_t(columns) * 4);
+        vector< half  > half_row(size_t(columns) * 4);
+
+        for (unsigned z = z0; z <= z1; ++z)
+        {
+            const float * center = heights.data() + size_t(z) * n_verts_x;
+            const float * down   = z > 0             ? center - n_verts_x : center;
+            const float * up     = z < n_verts_z - 1 ? center + n_verts_x : center;
+
+            float z_pos = -depth * 0.5f + z * z_step;
+
+            for (unsigned x = x0; x <= x1; ++x)
+            {
+                float * position = &row[(x - x0) * 4];
+
+                position[0] = -width * 0.5f + x * x_step;
+                position[1] = center[x];
+                position[2] = z_pos;
+                position[3] = 0.0f;
+            }
+
+            convert_to_half(row.data(), half_row.data(), half_row.size());
+
+            Packed_Vertex * row_vertices = vertices + size_t(z - z0) * columns;
+            GLushort        v            = Packed_Vertex::pack_unorm16((float)z / (float)z_slices);
+
+            for (unsigned x = x0; x <= x1; ++x)
+            {
+                Packed_Vertex & vertex = row_vertices[x - x0];
+
+                std::memcpy(vertex.position, &half_row[(x - x0) * 4], sizeof(vertex.position));
+
+                vertex.uv[0] = Packed_Vertex::pack_unorm16((float)x / (float)x_slices);
+                vertex.uv[1] = v;
+
+                float h_l = x > 0             ? center[x - 1] : center[x];
+                float h_r = x < n_verts_x - 1 ? center[x + 1] : center[x];
+                float normal[3];
+
+                scalar_normal(h_l, h_r, down[x], up[x], two_x_step, normal);
+
+                vertex.set_normal(glm::vec3(normal[0], normal[1], normal[2]));
+            }
+        }
+    }
+
+}
@@ -0,0 +1,69 @@
+// Terrain_Mesh.hpp
+// angel.rodriguez@udit.es
+
+#ifndef TERRAIN_MESH_HEADER
+#define TERRAIN_MESH_HEADER
+
+#include <vector>
+#include "Height_Map.hpp"
+#include "Packed_Vertex.hpp"
+
+namespace udit
+{
+
+    // Genera las alturas, posiciones, UVs y normales de la rejilla del terreno a partir de un
+    // heightmap. Las filas se reparten entre varios hilos; en CPUs x86 las normales se calculan
+    // con SSE (cuatro vertices a la vez) y la conversion de posiciones a half se hace con F16C
+    // (dos vertices a la vez) si la CPU la soporta. El resultado es el mismo que el del bucle escalar.
+
+    class Terrain_Mesh
+    {
+    public:
+
+        std::vector< float         > heights;            // Una altura por vertice (fila a fila)
+        std::vector< Packed_Vertex > vertices;           // Posicion, uv y normal entrelazadas
+
+    public:
+
+        // height_map puede ser nullptr o estar vacio (terreno plano). Con with_attributes = false
+        // solo se calculan las alturas. thread_count = 0 usa todos los hilos de la maquina.
+        Terrain_Mesh
+        (
+            const Height_Map * height_map,
+            float width, float depth, unsigned x_slices, unsigned z_slices, float max_height,
+            bool with_attributes = true, unsigned thread_count = 0
+        );
+
+        // Vuelve a calcular los vertices de las columnas [x0, x1] y filas [z0, z1] (incluidas) a
+        // partir de las alturas de toda la rejilla, con el mismo resultado que el constructor. Se
+        // usa al editar el terreno. vertices recibe (x1 - x0 + 1) * (z1 - z0 + 1) vertices fila a fila.
+        static void build_vertices
+        (
+            const std::vector< float > & heights, float width, float depth, unsigned x_slices, unsigned z_slices,
+            unsigned x0, unsigned z0, unsigned x1, unsigned z1, Packed_Vertex * vertices
+        );
+
+        // Indica si esta maquina convierte a half con F16C
+        static bool is_f16c_enabled ();
+
+        // Indices de los quads [x0, x1) x [z0, z1) de una rejilla de n_verts_x vertices por fila:
+        //  - como lista de triangulos (6 indices por quad, indices globales)
+        //  - como tiras separadas con restart_index (indices relativos al vertice (x0, z0), que se
+        //    pasa como base vertex al dibujar). Cada tira cubre una fila de una banda de
+        //    strip_width quads, estrecha para que la fila anterior siga en la cache de vertices
+        //    transformados (con 8 quads caben en una FIFO de 18 entradas).
+        static void append_triangles (std::vector< GLuint   > & indices, unsigned n_verts_x, unsigned x0, unsigned z0, unsigned x1, unsigned z1);
+        static void append_strips    (std::vector< GLushort > & indices, unsigned n_verts_x, unsigned x0, unsigned z0, unsigned x1, unsigned z1,
+                                      GLushort restart_index, unsigned strip_width = 8);
+
+        // Como append_triangles, pero con los triangulos del trozo reordenados por Mesh_Optimizer
+        // (cache de vertices y overdraw). Los vertices siguen en el orden de la rejilla porque los
+        // comparten los trozos vecinos. heights son las alturas de toda la rejilla.
+        static void append_optimized_triangles (std::vector< GLuint > & indices, unsigned n_verts_x, unsigned x0, unsigned z0, unsigned x1, unsigned z1,
+                                                const std::vector< float > & heights, float x_step, float z_step);
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,391 @@
+// Terrain_Ray_Caster.cpp
+// angel.rodriguez@udit.es
+
+#include "Terrain_Ray_Caster.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+using namespace std;
+
+namespace udit
+{
+
+    namespace
+    {
+
+        // Tramo [t_enter, t_exit] del rayo dentro de la columna [x0, x1] x [z0, z1] (sin limite en y)
+        bool clip_to_column
+        (
+            const glm::vec3 & origin, const glm::vec3 & inverse_direction,
+            float x0, float x1, float z0, float z1, float & t_enter, float & t_exit
+        )
+        {
+            float tx0 = (x0 - origin.x) * inverse_direction.x, tx1 = (x1 - origin.x) * inverse_direction.x;
+            float tz0 = (z0 - origin.z) * inverse_direction.z, tz1 = (z1 - origin.z) * inverse_direction.z;
+
+            // Con la direccion paralela a un eje el tramo es infinito o vacio (y sale NaN en el borde)
+            if (std::isnan(tx0) || std::isnan(tx1)) { tx0 = -numeric_limits< float >::infinity(); tx1 = -tx0; }
+            if (std::isnan(tz0) || std::isnan(tz1)) { tz0 = -numeric_limits< float >::infinity(); tz1 = -tz0; }
+
+            t_enter = std::max(t_enter, std::max(std::min(tx0, tx1), std::min(tz0, tz1)));
+            t_exit  = std::min(t_exit,  std::min(std::max(tx0, tx1), std::max(tz0, tz1)));
+
+            return t_enter <= t_exit;
+        }
+
+        // Moller-Trumbore sin descartar caras traseras
+        bool intersect_triangle
+        (
+            const glm::vec3 & origin, const glm::vec3 & direction,
+            const glm::vec3 & a, const glm::vec3 & b, const glm::vec3 & c, float & t
+        )
+        {
+            glm::vec3 edge_1 = b - a;
+            glm::vec3 edge_2 = c - a;
+            glm::vec3 p      = glm::cross(direction, edge_2);
+            float determinant = glm::dot(edge_1, p);
+
+            if (std::abs(determinant) < 1e-12f) return false;
+
+            float     inverse = 1.0f / determinant;
+            glm::vec3 s       = origin - a;
+            float     u       = glm::dot(s, p) * inverse;
+
+            if (u < 0.0f || u > 1.0f) return false;
+
+            glm::vec3 q = glm::cross(s, edge_1);
+            float     v = glm::dot(direction, q) * inverse;
+
+            if (v < 0.0f || u + v > 1.0f) return false;
+
+            t = glm::dot(edge_2, q) * inverse;
+
+            return t >= 0.0f;
+        }
+
+    }
+
+    Terrain_Ray_Caster::Terrain_Ray_Caster()
+        : height_field(nullptr)
+    {
+    }
+
+    Terrain_Ray_Caster::Terrain_Ray_Caster(const Height_Field& height_field)
+        : height_field(&height_field)
+    {
+        allocate_levels();
+
+        if (!levels.empty()) update(0, 0, levels[0].cells_x - 1, levels[0].cells_z - 1);
+    }
+
+    Terrain_Ray_Caster::Terrain_Ray_Caster(const Height_Field& height_field, const void* pyramid, size_t pyramid_size)
+        : height_field(&height_field)
+    {
+        allocate_levels();
+
+        if (levels.empty()) return;
+
+        if (pyramid_size != get_memory_size())
+        {
+            update(0, 0, levels[0].cells_x - 1, levels[0].cells_z - 1);
+            return;
+        }
+
+        const unsigned char * source = static_cast< const unsigned char * >(pyramid);
+
+        for (auto & level : levels)
+        {
+            std::memcpy(level.bounds.data(), source, level.bounds.size() * sizeof(Bounds));
+            source += level.bounds.size() * sizeof(Bounds);
+        }
+    }
+
+    void Terrain_Ray_Caster::allocate_levels()
+    {
+        if (height_field->get_samples_x() < 2 || height_field->get_samples_z() < 2) return;
+
+        // Nivel 0: una entrada por celda. Cada nivel junta 2 x 2 nodos del anterior hasta que queda uno solo.
+        Level cells = { height_field->get_samples_x() - 1, height_field->get_samples_z() - 1, {} };
+
+        levels.push_back(cells);
+
+        while (levels.back().cells_x > 1 || levels.back().cells_z > 1)
+        {
+            Level parent = { (levels.back().cells_x + 1) / 2, (levels.back().cells_z + 1) / 2, {} };
+            levels.push_back(parent);
+        }
+
+        for (auto & level : levels) level.bounds.resize(size_t(level.cells_x) * level.cells_z);
+    }
+
+    void Terrain_Ray_Caster::update(unsigned i0, unsigned j0, unsigned i1, unsigned j1)
+    {
+        if (levels.empty()) return;
+
+        // Alturas minima y maxima de las cuatro esquinas de cada celda
+        Level & cells = levels[0];
+
+        i1 = std::min(i1, cells.cells_x - 1);
+        j1 = std::min(j1, cells.cells_z - 1);
+
+        for (unsigned j = j0; j <= j1; ++j)
+        {
+            for (unsigned i = i0; i <= i1; ++i)
+            {
+                uint16_t h00 = height_field->quantized_sample(i, j    ), h10 = height_field->quantized_sample(i + 1, j    );
+                uint16_t h01 = height_field->quantized_sample(i, j + 1), h11 = height_field->quantized_sample(i + 1, j + 1);
+
+                Bounds & bounds = cells.bounds[size_t(j) * cells.cells_x + i];
+
+                bounds.min = std::min(std::min(h00, h10), std::min(h01, h11));
+                bounds.max = std::max(std::max(h00, h10), std::max(h01, h11));
+            }
+        }
+
+        // Solo cambian los antepasados de las celdas tocadas
+        for (size_t level = 1; level < levels.size(); ++level)
+        {
+            const Level & child  = levels[level - 1];
+            Level       & parent = levels[level];
+
+            i0 /= 2; j0 /= 2; i1 /= 2; j1 /= 2;
+
+            for (unsigned j = j0; j <= j1; ++j)
+            {
+                for (unsigned i = i0; i <= i1; ++i)
+                {
+                    Bounds bounds = { 0xFFFF, 0 };
+
+                    for (unsigned cj = j * 2; cj < std::min(j * 2 + 2, child.cells_z); ++cj)
+                    {
+                        for (unsigned ci = i * 2; ci < std::min(i * 2 + 2, child.cells_x); ++ci)
+                        {
+                            const Bounds & child_bounds = child.bounds[size_t(cj) * child.cells_x + ci];
+
+                            bounds.min = std::min(bounds.min, child_bounds.min);
+                            bounds.max = std::max(bounds.max, child_bounds.max);
+                        }
+                    }
+
+                    parent.bounds[size_t(j) * parent.cells_x + i] = bounds;
+                }
+            }
+        }
+    }
+
+    size_t Terrain_Ray_Caster::get_memory_size() const
+    {
+        size_t size = 0;
+
+        for (const auto & level : levels) size += level.bounds.size() * sizeof(Bounds);
+
+        return size;
+    }
+
+    void Terrain_Ray_Caster::copy_pyramid(void* destination) const
+    {
+        unsigned char * target = static_cast< unsigned char * >(destination);
+
+        for (const auto & level : levels)
+        {
+            std::memcpy(target, level.bounds.data(), level.bounds.size() * sizeof(Bounds));
+            target += level.bounds.size() * sizeof(Bounds);
+        }
+    }
+
+    bool Terrain_Ray_Caster::intersect_cell
+    (
+        unsigned i, unsigned j, const glm::vec3 & origin, const glm::vec3 & direction, float max_distance, float & distance
+    ) const
+    {
+        const glm::vec2 & grid_origin = height_field->get_origin();
+        const glm::vec2 & step        = height_field->get_step();
+
+        float x0 = grid_origin.x + float(i) * step.x, x1 = grid_origin.x + float(i + 1) * step.x;
+        float z0 = grid_origin.y + float(j) * step.y, z1 = grid_origin.y + float(j + 1) * step.y;
+
+        glm::vec3 tl(x0, height_field->sample(i,     j    ), z0);
+        glm::vec3 tr(x1, height_field->sample(i + 1, j    ), z0);
+        glm::vec3 bl(x0, height_field->sample(i,     j + 1), z1);
+        glm::vec3 br(x1, height_field->sample(i + 1, j + 1), z1);
+
+        // Mismos triangulos que Terrain_Mesh::append_triangles: (tl, bl, tr) y (tr, bl, br)
+        float t, nearest = max_distance;
+        bool  is_hit     = false;
+
+        if (intersect_triangle(origin, direction, tl, bl, tr, t) && t <= nearest) { nearest = t; is_hit = true; }
+        if (intersect_triangle(origin, direction, tr, bl, br, t) && t <= nearest) { nearest = t; is_hit = true; }
+
+        if (is_hit) distance = nearest;
+
+        return is_hit;
+    }
+
+    bool Terrain_Ray_Caster::intersect(const Ray& ray, Hit& hit) const
+    {
+        hit.is_hit = false;
+
+        float length = glm::length(ray.direction);
+
+        if (levels.empty() || length == 0.0f) return false;
+
+        const glm::vec3 direction = ray.direction / length;
+        const glm::vec3 inverse_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+        const glm::vec2 & grid_origin = height_field->get_origin();
+        const glm::vec2 & step        = height_field->get_step();
+        const unsigned    cells_x     = levels[0].cells_x;
+        const unsigned    cells_z     = levels[0].cells_z;
+
+        // Los hijos se visitan de delante hacia atras segun el sentido del rayo en x y z. Los dos
+        // hijos "cruzados" nunca los atraviesa el mismo rayo, asi que su orden no importa.
+        const unsigned near_x = direction.x >= 0.0f ? 0 : 1;
+        const unsigned near_z = direction.z >= 0.0f ? 0 : 1;
+        const unsigned child_x[4] = { near_x, 1 - near_x, near_x, 1 - near_x };
+        const unsigned child_z[4] = { near_z, near_z, 1 - near_z, 1 - near_z };
+
+        struct Node
+        {
+            unsigned level, i, j;
+            float    t_enter, t_exit;
+        };
+
+        // Cada nivel deja como mucho 3 hermanos pendientes en la pila
+        Node     stack[128];
+        unsigned stack_size = 0;
+
+        Node root = { unsigned(levels.size() - 1), 0, 0, 0.0f, ray.max_distance };
+
+        if (!clip_to_column(ray.origin, inverse_direction, grid_origin.x, grid_origin.x + float(cells_x) * step.x,
+                            grid_origin.y, grid_origin.y + float(cells_z) * step.y, root.t_enter, root.t_exit))
+        {
+            return false;
+        }
+
+        stack[stack_size++] = root;
+
+        while (stack_size > 0)
+        {
+            Node node = stack[--stack_size];
+
+            // Parte mas baja del rayo dentro del nodo: si queda por encima de la altura maxima no hay corte
+            float lowest_y = ray.origin.y + direction.y * (direction.y > 0.0f ? node.t_enter : node.t_exit);
+
+            if (lowest_y > height_field->dequantize(levels[node.level].bounds[size_t(node.j) * levels[node.level].cells_x + node.i].max))
+            {
+                continue;
+            }
+
+            if (node.level == 0)
+            {
+                float distance;
+
+                if (intersect_cell(node.i, node.j, ray.origin, direction, ray.max_distance, distance))
+                {
+                    hit.is_hit   = true;
+                    hit.distance = distance;
+                    hit.point    = ray.origin + direction * distance;
+                    return true;
+                }
+
+                continue;
+            }
+
+            const Level & children = levels[node.level - 1];
+            const unsigned child_span = 1u << (node.level - 1);        // Celdas por lado de cada hijo
+
+            // Se apilan al reves para sacar primero el mas cercano
+            for (int child = 3; child >= 0; --child)
+            {
+                unsigned i = node.i * 2 + child_x[child];
+                unsigned j = node.j * 2 + child_z[child];
+
+                if (i >= children.cells_x || j >= children.cells_z) continue;
+
+                float x0 = grid_origin.x + float(i * child_span) * step.x;
+                float x1 = grid_origin.x + float(std::min((i + 1) * child_span, cells_x)) * step.x;
+                float z0 = grid_origin.y + float(j * child_span) * step.y;
+                float z1 = grid_origin.y + float(std::min((j + 1) * child_span, cells_z)) * step.y;
+
+                Node next = { node.level - 1, i, j, node.t_enter, node.t_exit };
+
+                if (clip_to_column(ray.origin, inverse_direction, x0, x1, z0, z1, next.t_enter, next.t_exit))
+                {
+                    stack[stack_size++] = next;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void Terrain_Ray_Caster::intersect(const Ray* rays, Hit* hits, size_t count, unsigned thread_count) const
+    {
+        if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        // No compensa lanzar un hilo para menos de unos cientos de rayos
+        thread_count = unsigned(std::max< size_t >(1, std::min< size_t >(thread_count, count / 256)));
+
+        auto intersect_range = [this, rays, hits](size_t first, size_t last)
+        {
+            for (size_t ray = first; ray < last; ++ray) intersect(rays[ray], hits[ray]);
+        };
+
+        vector< std::thread > threads;
+        threads.reserve(thread_count - 1);
+
+        for (unsigned thread = 0; thread < thread_count; ++thread)
+        {
+            size_t first = count *  thread      / thread_count;
+            size_t last  = count * (thread + 1) / thread_count;
+
+            if (thread + 1 < thread_count) threads.emplace_back(intersect_range, first, last);
+            else                           intersect_range(first, last);
+        }
+
+        for (auto & thread : threads) thread.join();
+    }
+
+    bool Terrain_Ray_Caster::intersect_brute_force(const Ray& ray, Hit& hit) const
+    {
+        hit.is_hit = false;
+
+        float length = glm::length(ray.direction);
+
+        if (levels.empty() || length == 0.0f) return false;
+
+        glm::vec3 direction = ray.direction / length;
+        float     nearest   = ray.max_distance;
+
+        for (unsigned j = 0; j < levels[0].cells_z; ++j)
+        {
+            for (unsigned i = 0; i < levels[0].cells_x; ++i)
+            {
+                float distance;
+
+                if (intersect_cell(i, j, ray.origin, direction, nearest, distance))
+                {
+                    nearest      = distance;
+                    hit.is_hit   = true;
+                    hit.distance = distance;
+                    hit.point    = ray.origin + direction * distance;
+                }
+            }
+        }
+
+        return hit.is_hit;
+    }
+
+    bool Terrain_Ray_Caster::is_visible(const glm::vec3& from, const glm::vec3& to) const
+    {
+        // Se recorta un poco el final para que un punto apoyado en el suelo no se tape a si mismo
+        Ray ray = { from, to - from, glm::length(to - from) * 0.999f };
+        Hit hit;
+
+        return !intersect(ray, hit);
+    }
+
+}
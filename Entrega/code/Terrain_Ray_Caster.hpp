@@ -0,0 +1,104 @@
+// Terrain_Ray_Caster.hpp
+// angel.rodriguez@udit.es
+
+#ifndef TERRAIN_RAY_CASTER_HEADER
+#define TERRAIN_RAY_CASTER_HEADER
+
+#include <glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Height_Field.hpp"
+
+namespace udit
+{
+
+    // Interseccion de rayos con la malla de un Height_Field (picking, linea de vision...).
+    // Se construye una piramide de alturas minima y maxima (min/max mipmap): el nivel 0 tiene una
+    // entrada por celda y cada nivel siguiente junta 2 x 2 celdas del anterior. El rayo recorre
+    // el quadtree de delante hacia atras y solo baja a los nodos cuya altura maxima llega a la
+    // parte mas baja del rayo dentro del nodo; el espacio vacio se salta de un golpe.
+    // En las celdas se prueban los mismos dos triangulos que pinta Terrain.
+
+    class Terrain_Ray_Caster
+    {
+    public:
+
+        struct Ray
+        {
+            glm::vec3 origin;
+            glm::vec3 direction;                // No hace falta que este normalizada
+            float     max_distance;             // En unidades de mundo
+        };
+
+        struct Hit
+        {
+            bool      is_hit;
+            float     distance;                 // Distancia desde el origen del rayo
+            glm::vec3 point;
+        };
+
+    private:
+
+        struct Bounds
+        {
+            uint16_t min, max;                  // Alturas cuantizadas como en el Height_Field
+        };
+
+        struct Level
+        {
+            unsigned               cells_x, cells_z;
+            std::vector< Bounds >  bounds;
+        };
+
+    private:
+
+        const Height_Field * height_field;
+        std::vector< Level > levels;            // levels[0] = celdas; el ultimo tiene un solo nodo
+
+    public:
+
+        Terrain_Ray_Caster();
+
+        // El Height_Field tiene que seguir vivo mientras se use el ray caster (si cambia, ver update)
+        explicit Terrain_Ray_Caster(const Height_Field & height_field);
+
+        // Como el anterior, pero copia una piramide guardada con copy_pyramid (por ejemplo en
+        // Terrain_Cache) en lugar de calcularla. Si el tamano no coincide se calcula.
+        Terrain_Ray_Caster(const Height_Field & height_field, const void * pyramid, size_t pyramid_size);
+
+    public:
+
+        // Actualiza la piramide despues de cambiar en el Height_Field las alturas de las celdas
+        // [i0, i1] x [j0, j1] (incluidas; la celda (i, j) va de la muestra (i, j) a la (i + 1, j + 1))
+        void update (unsigned i0, unsigned j0, unsigned i1, unsigned j1);
+
+        bool is_empty () const { return levels.empty(); }
+
+        size_t get_memory_size () const;
+
+        // Copia todos los niveles seguidos en destination (get_memory_size bytes)
+        void   copy_pyramid    (void * destination) const;
+
+        bool intersect (const Ray & ray, Hit & hit) const;
+
+        // Muchos rayos a la vez (repartidos entre hilos). thread_count = 0 usa todos los de la maquina.
+        void intersect (const Ray * rays, Hit * hits, size_t count, unsigned thread_count = 0) const;
+
+        // Prueba el rayo contra todos los triangulos de la rejilla. Solo para comprobar resultados.
+        bool intersect_brute_force (const Ray & ray, Hit & hit) const;
+
+        // Linea de vision: true si el segmento entre los dos puntos no corta el terreno
+        bool is_visible (const glm::vec3 & from, const glm::vec3 & to) const;
+
+    private:
+
+        void allocate_levels ();
+
+        bool intersect_cell (unsigned i, unsigned j, const glm::vec3 & origin, const glm::vec3 & direction, float max_distance, float & distance) const;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,202 @@
+// Terrain_Splatting.cpp
+// angel.rodriguez@udit.es
+
+#include "Terrain_Splatting.hpp"
+#include <SOIL2.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace udit
+{
+
+    constexpr unsigned Terrain_Splatting::max_materials;
+
+    namespace
+    {
+
+        // 1 dentro de [low, high] con bordes suaves de ancho blend (se solapan con el material vecino)
+        float band(float value, float low, float high, float blend)
+        {
+            float rise = std::min(std::max((value - low ) / blend + 0.5f, 0.0f), 1.0f);
+            float fall = std::min(std::max((high - value) / blend + 0.5f, 0.0f), 1.0f);
+
+            return rise * fall;
+        }
+
+    }
+
+    void Terrain_Splatting::bake_weights
+    (
+        const Height_Map & height_map, float width, float depth, float max_height,
+        const std::vector< Material > & materials, std::vector< GLubyte > & weights
+    )
+    {
+        int      map_width  = height_map.get_width();
+        int      map_height = height_map.get_height();
+        unsigned count      = std::min(unsigned(materials.size()), max_materials);
+        unsigned layers     = (count + 3) / 4;
+        size_t   layer_size = size_t(map_width) * map_height * 4;
+
+        weights.assign(layer_size * layers, 0);
+
+        if (count == 0 || height_map.is_empty()) return;
+
+        float step_x = map_width  > 1 ? width / float(map_width  - 1) : 1.0f;
+        float step_z = map_height > 1 ? depth / float(map_height - 1) : 1.0f;
+
+        float raw[max_materials];
+
+        for (int z = 0; z < map_height; ++z)
+        {
+            int down = std::max(z - 1, 0), up = std::min(z + 1, map_height - 1);
+
+            for (int x = 0; x < map_width; ++x)
+            {
+                int left = std::max(x - 1, 0), right = std::min(x + 1, map_width - 1);
+
+                // Misma pendiente que las normales horneadas (ver Normal_Map::bake)
+                float dh_dx = right > left ? (height_map.value(right, z) - height_map.value(left, z)) * max_height / (float(right - left) * step_x) : 0.0f;
+                float dh_dz = up    > down ? (height_map.value(x, up   ) - height_map.value(x, down)) * max_height / (float(up    - down) * step_z) : 0.0f;
+
+                float height = height_map.value(x, z);
+                float slope  = 1.0f - 1.0f / std::sqrt(dh_dx * dh_dx + 1.0f + dh_dz * dh_dz);
+                float total  = 0.0f;
+
+                for (unsigned material = 0; material < count; ++material)
+                {
+                    const Material & rule = materials[material];
+
+                    raw[material] = band(height, rule.min_height, rule.max_height, 0.05f) * band(slope, rule.min_slope, rule.max_slope, 0.02f);
+                    total        += raw[material];
+                }
+
+                // Sin ningun material que encaje se usa el primero
+                if (total <= 0.0f) { raw[0] = total = 1.0f; }
+
+                // Se cuantiza a bytes y el redondeo que sobra o falta va al material con mas peso
+                size_t   texel     = (size_t(z) * map_width + x) * 4;
+                int      remaining = 255;
+                unsigned strongest = 0;
+
+                for (unsigned material = 0; material < count; ++material)
+                {
+                    int value = int(std::lround(raw[material] / total * 255.0f));
+
+                    weights[layer_size * (material / 4) + texel + material % 4] = GLubyte(value);
+                    remaining -= value;
+
+                    if (raw[material] > raw[strongest]) strongest = material;
+                }
+
+                GLubyte & strongest_weight = weights[layer_size * (strongest / 4) + texel + strongest % 4];
+                strongest_weight = GLubyte(int(strongest_weight) + remaining);
+            }
+        }
+    }
+
+    void Terrain_Splatting::load_layer(const Material & material, GLsizei layer_size, std::vector< GLubyte > & texels)
+    {
+        texels.resize(size_t(layer_size) * layer_size * 4);
+
+        int width = 0, height = 0, channels = 0;
+        unsigned char * image = material.texture_path.empty() ? nullptr :
+                                SOIL_load_image(material.texture_path.c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+
+        if (!image)
+        {
+            if (!material.texture_path.empty()) std::cerr << "AVISO: No se pudo cargar " << material.texture_path << ", se usa un color." << std::endl;
+
+            for (size_t texel = 0; texel < texels.size(); texel += 4)
+            {
+                texels[texel + 0] = GLubyte(std::lround(glm::clamp(material.color.r, 0.0f, 1.0f) * 255.0f));
+                texels[texel + 1] = GLubyte(std::lround(glm::clamp(material.color.g, 0.0f, 1.0f) * 255.0f));
+                texels[texel + 2] = GLubyte(std::lround(glm::clamp(material.color.b, 0.0f, 1.0f) * 255.0f));
+                texels[texel + 3] = 255;
+            }
+
+            return;
+        }
+
+        // Todas las capas de una textura array tienen el mismo tamano: se reescala (vecino mas cercano)
+        for (GLsizei y = 0; y < layer_size; ++y)
+        {
+            const unsigned char * source_row = image + size_t(y * height / layer_size) * width * 4;
+
+            for (GLsizei x = 0; x < layer_size; ++x)
+            {
+                const unsigned char * source = source_row + size_t(x * width / layer_size) * 4;
+
+                std::copy(source, source + 4, &texels[(size_t(y) * layer_size + x) * 4]);
+            }
+        }
+
+        SOIL_free_image_data(image);
+    }
+
+    Terrain_Splatting::Terrain_Splatting
+    (
+        const Height_Map & height_map, float width, float depth, float max_height,
+        const std::vector< Material > & materials, GLsizei layer_size
+    )
+        : material_count(std::max(1u, std::min(unsigned(materials.size()), max_materials)))
+    {
+        std::vector< Material > used(materials.begin(), materials.begin() + std::min< size_t >(materials.size(), max_materials));
+
+        if (used.empty()) used.push_back(Material{ "", glm::vec3(0.5f), 0.0f, 1.0f, 0.0f, 1.0f });
+
+        // 1. MATERIALES: una capa por material
+        std::vector< GLubyte > layers, texels;
+
+        for (const Material & material : used)
+        {
+            load_layer(material, layer_size, texels);
+            layers.insert(layers.end(), texels.begin(), texels.end());
+        }
+
+        glGenTextures(1, &materials_texture_id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, materials_texture_id);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layer_size, layer_size, GLsizei(material_count), 0, GL_RGBA, GL_UNSIGNED_BYTE, layers.data());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+        // 2. PESOS: cuatro materiales por capa RGBA
+        Height_Map flat(1, 1, Height_Map::UNORM8);
+        const Height_Map & source = height_map.is_empty() ? flat : height_map;
+
+        std::vector< GLubyte > weights;
+
+        bake_weights(source, width, depth, max_height, used, weights);
+
+        glGenTextures(1, &weights_texture_id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, weights_texture_id);
+        // Un texel por muestra del heightmap: en el borde del terreno no se mezclan los pesos del
+        // borde opuesto (el clipmap, que si se repite, usa tiled_weights_sampler_id)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, source.get_width(), source.get_height(), GLsizei((material_count + 3) / 4), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, weights.data());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenSamplers(1, &tiled_weights_sampler_id);
+        glSamplerParameteri(tiled_weights_sampler_id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glSamplerParameteri(tiled_weights_sampler_id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glSamplerParameteri(tiled_weights_sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glSamplerParameteri(tiled_weights_sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    Terrain_Splatting::~Terrain_Splatting()
+    {
+        glDeleteTextures(1, &materials_texture_id);
+        glDeleteTextures(1, &weights_texture_id);
+        glDeleteSamplers(1, &tiled_weights_sampler_id);
+    }
+
+}
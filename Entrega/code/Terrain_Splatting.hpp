@@ -0,0 +1,82 @@
+// Terrain_Splatting.hpp
+// angel.rodriguez@udit.es
+
+#ifndef TERRAIN_SPLATTING_HEADER
+#define TERRAIN_SPLATTING_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <string>
+#include <vector>
+#include "Height_Map.hpp"
+
+namespace udit
+{
+
+    // Texturizado del terreno mezclando varios materiales (splatting). Todos los materiales van
+    // en las capas de una sola GL_TEXTURE_2D_ARRAY y los pesos de cada uno en otra textura array
+    // RGBA (cuatro materiales por capa), asi que el suelo se sigue pintando en una llamada y con
+    // las mismas texturas enlazadas tenga los materiales que tenga.
+    //
+    // Los pesos se calculan al arrancar a partir de la altura y la pendiente del heightmap.
+
+    class Terrain_Splatting
+    {
+    public:
+
+        static constexpr unsigned max_materials = 8;
+
+        struct Material
+        {
+            std::string texture_path;           // Si esta vacio o no se puede cargar se usa color
+            glm::vec3   color;
+            float       min_height, max_height; // Rango de alturas normalizadas (0..1 del heightmap)
+            float       min_slope,  max_slope;  // Rango de pendientes (0 = llano, 1 = vertical)
+        };
+
+    private:
+
+        GLuint   materials_texture_id;          // GL_TEXTURE_2D_ARRAY, una capa por material
+        GLuint   weights_texture_id;            // GL_TEXTURE_2D_ARRAY RGBA8, una capa por cada 4 materiales (GL_CLAMP_TO_EDGE)
+        GLuint   tiled_weights_sampler_id;      // Los pesos con GL_REPEAT, para el terreno que se repite (clipmap)
+        unsigned material_count;
+
+    public:
+
+        // Peso de cada material en cada pixel del heightmap, normalizados para que sumen 255.
+        // weights recibe (material_count + 3) / 4 capas de width * height texels RGBA.
+        static void bake_weights
+        (
+            const Height_Map & height_map, float width, float depth, float max_height,
+            const std::vector< Material > & materials, std::vector< GLubyte > & weights
+        );
+
+        // layer_size es el lado de las capas de materiales (las imagenes se reescalan a el)
+        Terrain_Splatting
+        (
+            const Height_Map & height_map, float width, float depth, float max_height,
+            const std::vector< Material > & materials, GLsizei layer_size = 512
+        );
+       ~Terrain_Splatting();
+
+    private:
+
+        Terrain_Splatting(const Terrain_Splatting & ) = delete;
+        Terrain_Splatting & operator = (const Terrain_Splatting & ) = delete;
+
+    public:
+
+        unsigned get_material_count () const { return material_count; }
+        GLuint   get_materials_texture_id () const { return materials_texture_id; }
+        GLuint   get_weights_texture_id   () const { return weights_texture_id;   }
+        GLuint   get_tiled_weights_sampler_id () const { return tiled_weights_sampler_id; }
+
+    private:
+
+        static void load_layer (const Material & material, GLsizei layer_size, std::vector< GLubyte > & texels);
+
+    };
+
+}
+
+#endif
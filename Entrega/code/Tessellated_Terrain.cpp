@@ -0,0 +1,155 @@
+// Tessellated_Terrain.cpp
+// angel.rodriguez@udit.es
+
+#include "Tessellated_Terrain.hpp"
+#include "Height_Map.hpp"
+#include <SDL3/SDL_video.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+using std::vector;
+
+namespace udit
+{
+
+    namespace
+    {
+        typedef void (GLAD_API_PTR * Patch_Parameteri_Function)(GLenum name, GLint value);
+
+        Patch_Parameteri_Function patch_parameteri = nullptr;
+    }
+
+    bool Tessellated_Terrain::is_supported()
+    {
+        GLint major_version = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+
+        if (major_version < 4) return false;
+
+        if (!patch_parameteri)
+        {
+            patch_parameteri = reinterpret_cast< Patch_Parameteri_Function >(SDL_GL_GetProcAddress("glPatchParameteri"));
+        }
+
+        return patch_parameteri != nullptr;
+    }
+
+    Tessellated_Terrain::Tessellated_Terrain(const Height_Map& source_map, float width, float depth, float max_height, unsigned patches_per_side)
+        : width(width), depth(depth), max_height(max_height),
+          patches_per_side(std::max(patches_per_side, 1u)),
+          triangle_size(8.0f),
+          program_id(0)
+    {
+        // 1. HEIGHTMAP (un solo canal, con su precision). Si no se pudo cargar se usa uno plano
+        // para poder seguir
+        const Height_Map   flat_map(1, 1, Height_Map::UNORM8);
+        const Height_Map & height_map = source_map.is_empty() ? flat_map : source_map;
+
+        int tex_w = height_map.get_width();
+        int tex_h = height_map.get_height();
+
+        height_texture.reset(new Height_Texture(height_map));
+
+        // 2. PARCHES CON SUS ALTURAS MINIMA Y MAXIMA
+        // Cada parche lleva sus 4 vertices propios (sin indices) para poder guardar sus limites.
+        unsigned n = this->patches_per_side;
+
+        vector< float > vertices;
+        vertices.reserve(n * n * 4 * 4);
+
+        for (unsigned patch_z = 0; patch_z < n; ++patch_z)
+        {
+            for (unsigned patch_x = 0; patch_x < n; ++patch_x)
+            {
+                int x0 = int(float(patch_x    ) / n * (tex_w - 1));
+                int x1 = int(float(patch_x + 1) / n * (tex_w - 1) + 0.999f);
+                int z0 = int(float(patch_z    ) / n * (tex_h - 1));
+                int z1 = int(float(patch_z + 1) / n * (tex_h - 1) + 0.999f);
+
+                float min_value = std::numeric_limits< float >::max(), max_value = -min_value;
+
+                for (int z = z0; z <= std::min(z1, tex_h - 1); ++z)
+                {
+                    for (int x = x0; x <= std::min(x1, tex_w - 1); ++x)
+                    {
+                        float value = height_map.value(x, z);
+                        min_value = std::min(min_value, value);
+                        max_value = std::max(max_value, value);
+                    }
+                }
+
+                float patch_min = min_value * max_height - max_height * 0.15f;
+                float patch_max = max_value * max_height - max_height * 0.15f;
+
+                static const unsigned corners[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+                for (const auto& corner : corners)
+                {
+                    vertices.push_back(float(patch_x + corner[0]) / n);
+                    vertices.push_back(float(patch_z + corner[1]) / n);
+                    vertices.push_back(patch_min);
+                    vertices.push_back(patch_max);
+                }
+            }
+        }
+
+        // Una fila de parches por dibujo (ver render)
+        for (unsigned row = 0; row < n; ++row)
+        {
+            row_firsts.push_back(GLint  (row * n * 4));
+            row_counts.push_back(GLsizei(n * 4));
+        }
+
+        // --- OPENGL CONFIG ---
+        glGenVertexArrays(1, &vao_id);
+        glGenBuffers(1, &vbo_id);
+
+        glBindVertexArray(vao_id);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_id);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), reinterpret_cast< const void * >(2 * sizeof(float)));
+
+        glBindVertexArray(0);
+    }
+
+    Tessellated_Terrain::~Tessellated_Terrain()
+    {
+        glDeleteVertexArrays(1, &vao_id);
+        glDeleteBuffers(1, &vbo_id);
+    }
+
+    void Tessellated_Terrain::render(GL_State& gl_state, Shader_Program& program, int viewport_height)
+    {
+        if (program.get_id() != program_id)
+        {
+            program_id         = program.get_id();
+            terrain_id         = program.get_uniform_id("u_terrain");
+            height_scale_id    = program.get_uniform_id("u_height_scale");
+            viewport_height_id = program.get_uniform_id("u_viewport_height");
+            triangle_size_id   = program.get_uniform_id("u_triangle_size");
+            height_map_id      = program.get_uniform_id("u_height_map");
+        }
+
+        // Shader_Program solo sube los que han cambiado desde el frame anterior
+        program.set(terrain_id, glm::vec4(-width * 0.5f, -depth * 0.5f, width, depth));
+        program.set(height_scale_id, glm::vec2(max_height, -max_height * 0.15f));
+        program.set(viewport_height_id, float(viewport_height));
+        program.set(triangle_size_id, std::max(triangle_size, 1.0f));
+        program.set(height_map_id, GLint(1));
+
+        height_texture->bind(gl_state, 1);
+
+        patch_parameteri(GL_PATCH_VERTICES, 4);
+
+        // Se dibuja por filas en una sola llamada: con un unico dibujo muy teselado el rasterizador
+        // por software de Mesa (llvmpipe) pierde triangulos y va varias veces mas lento
+        gl_state.bind_vertex_array(vao_id);
+        glMultiDrawArrays(GL_PATCHES, row_firsts.data(), row_counts.data(), GLsizei(row_firsts.size()));
+    }
+
+}
@@ -0,0 +1,84 @@
+// Tessellated_Terrain.hpp
+// angel.rodriguez@udit.es
+
+#ifndef TESSELLATED_TERRAIN_HEADER
+#define TESSELLATED_TERRAIN_HEADER
+
+#include <glad/gl.h>
+#include <glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "GL_State.hpp"
+#include "Height_Map.hpp"
+#include "Height_Texture.hpp"
+#include "Shader_Program.hpp"
+
+// GLAD se ha generado para OpenGL 3.3: las constantes de teselacion (OpenGL 4.0) se definen aqui
+// y glPatchParameteri se obtiene en tiempo de ejecucion (ver Tessellated_Terrain::is_supported)
+
+#ifndef GL_PATCHES
+    #define GL_PATCHES                  0x000E
+    #define GL_PATCH_VERTICES           0x8E72
+    #define GL_TESS_EVALUATION_SHADER   0x8E87
+    #define GL_TESS_CONTROL_SHADER      0x8E88
+#endif
+
+namespace udit
+{
+
+    // Terreno teselado en la GPU (necesita un contexto OpenGL 4.0 o superior).
+    // La malla base es una rejilla muy gruesa de parches de 4 vertices. El tessellation control
+    // shader elige el nivel de cada borde segun lo que mide en pantalla (mas triangulos donde se
+    // ven mas grandes) y descarta los parches que quedan fuera del frustum; el de evaluacion
+    // coloca los vertices generados y los desplaza con la textura de alturas.
+    // Dos parches vecinos calculan su borde comun con los mismos datos, asi que no hay grietas.
+
+    class Tessellated_Terrain
+    {
+    private:
+
+        GLuint   vao_id;
+        GLuint   vbo_id;
+        std::unique_ptr< Height_Texture > height_texture;
+
+        float    width, depth, max_height;
+        unsigned patches_per_side;
+
+        std::vector< GLint   > row_firsts;      // Primer vertice de cada fila de parches
+        std::vector< GLsizei > row_counts;      // Vertices de cada fila
+
+        float    triangle_size;                 // Lado deseado de los triangulos en pixeles
+
+        GLuint   program_id;                    // Programa para el que estan buscados los uniforms
+        Shader_Program::Uniform_Id terrain_id, height_scale_id, viewport_height_id, triangle_size_id, height_map_id;
+
+    public:
+
+        // Comprueba que el contexto actual es 4.0 o superior y carga las funciones de teselacion.
+        // Si devuelve false no se debe crear ningun Tessellated_Terrain.
+        static bool is_supported ();
+
+        Tessellated_Terrain(const Height_Map & source_map, float width, float depth, float max_height, unsigned patches_per_side = 16);
+       ~Tessellated_Terrain();
+
+    private:
+
+        Tessellated_Terrain(const Tessellated_Terrain & ) = delete;
+        Tessellated_Terrain & operator = (const Tessellated_Terrain & ) = delete;
+
+    public:
+
+        // Cuanto menor es el tamano mas se subdivide (1 pixel = el maximo detalle util)
+        void set_triangle_size (float pixels) { triangle_size = pixels; }
+
+        // Dibuja los parches con el programa indicado (que debe estar activo y haber sido enlazado
+        // con shaders/tessellated_terrain.vert, .tesc y .tese). La camara la lee el control shader
+        // del bloque Frame_Uniforms; el alto del viewport convierte medidas a pixeles.
+        void render (GL_State & gl_state, Shader_Program & program, int viewport_height);
+
+    };
+
+}
+
+#endif
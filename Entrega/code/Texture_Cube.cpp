@@ -1,5 +1,5 @@
 
-// Este cdigo es de dominio pblico
+// Este código es de dominio público
 // angel.rodriguez@udit.es
 
 #include <vector>
@@ -44,7 +44,7 @@ namespace udit
         glTexParameteri (GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
         glTexParameteri (GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R,     GL_CLAMP_TO_EDGE);
 
-        // Se envan los mapas de bits a la GPU:
+        // Se envían los mapas de bits a la GPU:
 
         static const GLenum texture_target[] =
         {
@@ -110,7 +110,7 @@ namespace udit
                 reinterpret_cast< uint8_t * >(image->colors ())
             );
 
-            // Se libera la memoria que reserv SOIL2 para cargar la imagen:
+            // Se libera la memoria que reservó SOIL2 para cargar la imagen:
 
             SOIL_free_image_data (loaded_pixels);
 
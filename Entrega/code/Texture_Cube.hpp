@@ -1,5 +1,5 @@
 
-// Este cdigo es de dominio pblico
+// Este código es de dominio público
 // angel.rodriguez@udit.es
 
 #ifndef TEXTURE_CUBE_HEADER
@@ -46,6 +46,11 @@
                 return texture_is_loaded;
             }
 
+            GLuint get_texture_id () const
+            {
+                return texture_id;
+            }
+
             bool bind () const
             {
                 return texture_is_loaded ? glBindTexture (GL_TEXTURE_CUBE_MAP, texture_id), true : false;
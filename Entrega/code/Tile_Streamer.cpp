@@ -0,0 +1,159 @@
+// Tile_Streamer.cpp
+// angel.rodriguez@udit.es
+
+#include "Tile_Streamer.hpp"
+#include <cstdlib>
+#include <unordered_set>
+
+namespace udit
+{
+
+    namespace
+    {
+        unsigned wrap(long long value, unsigned modulus)
+        {
+            long long result = value % (long long)modulus;
+            return unsigned(result < 0 ? result + modulus : result);
+        }
+
+        long long floor_div(long long value, long long divisor)
+        {
+            return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+        }
+    }
+
+    Tile_Streamer::Tile_Streamer(const Height_Database& database, unsigned radius)
+        : database(database), radius(radius), focus_x(0), focus_z(0), focus_changed(false), stopping(false)
+    {
+        if (database.is_open())
+        {
+            worker = std::thread(&Tile_Streamer::run, this);
+        }
+    }
+
+    Tile_Streamer::~Tile_Streamer()
+    {
+        {
+            std::lock_guard< std::mutex > lock(mutex);
+            stopping = true;
+        }
+
+        wake_up.notify_one();
+
+        if (worker.joinable()) worker.join();
+    }
+
+    void Tile_Streamer::set_focus(long long sample_x, long long sample_z)
+    {
+        if (!database.is_open()) return;
+
+        long long tile_x = floor_div(sample_x, database.get_tile_size());
+        long long tile_z = floor_div(sample_z, database.get_tile_size());
+
+        {
+            std::lock_guard< std::mutex > lock(mutex);
+
+            if (tile_x == focus_x && tile_z == focus_z && !resident.empty()) return;
+
+            focus_x       = tile_x;
+            focus_z       = tile_z;
+            focus_changed = true;
+        }
+
+        wake_up.notify_one();
+    }
+
+    std::shared_ptr< const Tile_Streamer::Tile > Tile_Streamer::get_tile(unsigned tile_x, unsigned tile_z) const
+    {
+        std::lock_guard< std::mutex > lock(mutex);
+
+        auto found = resident.find(tile_key(tile_x, tile_z));
+
+        return found != resident.end() ? found->second : nullptr;
+    }
+
+    size_t Tile_Streamer::get_resident_count() const
+    {
+        std::lock_guard< std::mutex > lock(mutex);
+
+        return resident.size();
+    }
+
+    void Tile_Streamer::run()
+    {
+        unsigned tiles_x   = database.get_tiles_x();
+        unsigned tiles_z   = database.get_tiles_z();
+        size_t   tile_area = size_t(database.get_tile_size()) * database.get_tile_size();
+
+        for (;;)
+        {
+            long long center_x, center_z;
+
+            {
+                std::unique_lock< std::mutex > lock(mutex);
+
+                wake_up.wait(lock, [this] { return stopping || focus_changed; });
+
+                if (stopping) return;
+
+                center_x      = focus_x;
+                center_z      = focus_z;
+                focus_changed = false;
+            }
+
+            // Se cargan primero los tiles mas cercanos al foco (anillos crecientes)
+            std::unordered_set< size_t > wanted;
+            bool interrupted = false;
+
+            for (int ring = 0; ring <= int(radius) && !interrupted; ++ring)
+            {
+                for (int dz = -ring; dz <= ring && !interrupted; ++dz)
+                {
+                    for (int dx = -ring; dx <= ring && !interrupted; ++dx)
+                    {
+                        if (std::abs(dx) != ring && std::abs(dz) != ring) continue;
+
+                        unsigned tile_x = wrap(center_x + dx, tiles_x);
+                        unsigned tile_z = wrap(center_z + dz, tiles_z);
+                        size_t   key    = tile_key(tile_x, tile_z);
+
+                        if (!wanted.insert(key).second) continue;
+
+                        {
+                            std::lock_guard< std::mutex > lock(mutex);
+
+                            interrupted = stopping || focus_changed;
+
+                            if (interrupted || resident.count(key)) continue;
+                        }
+
+                        // La copia (y los fallos de pagina que provoque) se hace sin bloquear
+                        std::shared_ptr< Tile > tile = std::make_shared< Tile >();
+
+                        const uint16_t * heights = database.get_tile(tile_x, tile_z);
+
+                        tile->tile_x = tile_x;
+                        tile->tile_z = tile_z;
+                        tile->heights.assign(heights, heights + tile_area);
+
+                        std::lock_guard< std::mutex > lock(mutex);
+
+                        resident[key] = tile;
+                    }
+                }
+            }
+
+            // Se descartan los tiles que han quedado fuera del radio
+            std::lock_guard< std::mutex > lock(mutex);
+
+            if (interrupted || focus_changed) continue;     // Se recalcula con el foco nuevo sin descartar nada
+
+            for (auto tile = resident.begin(); tile != resident.end(); )
+            {
+                if (wanted.count(tile->first)) ++tile;
+                else                           tile = resident.erase(tile);
+            }
+        }
+    }
+
+}
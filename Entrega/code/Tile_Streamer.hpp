@@ -0,0 +1,83 @@
+// Tile_Streamer.hpp
+// angel.rodriguez@udit.es
+
+#ifndef TILE_STREAMER_HEADER
+#define TILE_STREAMER_HEADER
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Height_Database.hpp"
+
+namespace udit
+{
+
+    // Mantiene en memoria los tiles de alturas que rodean un punto de interes (la camara).
+    // Un hilo en segundo plano copia los tiles que entran en el radio desde la base de datos
+    // proyectada y suelta los que se alejan, asi que el hilo de render no espera a disco.
+    // El mundo se repite en los dos ejes, igual que en Clipmap_Terrain.
+
+    class Tile_Streamer
+    {
+    public:
+
+        struct Tile
+        {
+            unsigned                tile_x, tile_z;
+            std::vector< uint16_t > heights;        // tile_size x tile_size, fila a fila
+        };
+
+    private:
+
+        const Height_Database & database;
+        unsigned                radius;             // Tiles alrededor del foco que se cargan
+
+        std::unordered_map< size_t, std::shared_ptr< const Tile > > resident;
+
+        long long               focus_x, focus_z;   // Tile en el que esta el foco
+        bool                    focus_changed;
+        bool                    stopping;
+
+        mutable std::mutex      mutex;
+        std::condition_variable wake_up;
+        std::thread             worker;
+
+    public:
+
+        Tile_Streamer(const Height_Database & database, unsigned radius = 2);
+       ~Tile_Streamer();
+
+    private:
+
+        Tile_Streamer(const Tile_Streamer & ) = delete;
+        Tile_Streamer & operator = (const Tile_Streamer & ) = delete;
+
+    public:
+
+        // Coloca el foco en unas coordenadas de muestra. Solo despierta al hilo si cambia de tile.
+        void set_focus (long long sample_x, long long sample_z);
+
+        // Tile ya cargado o nullptr si aun no esta en memoria. El puntero sigue siendo valido
+        // aunque el hilo lo descarte despues.
+        std::shared_ptr< const Tile > get_tile (unsigned tile_x, unsigned tile_z) const;
+
+        size_t get_resident_count () const;
+
+    private:
+
+        void run ();
+
+        size_t tile_key (unsigned tile_x, unsigned tile_z) const
+        {
+            return size_t(tile_z) * database.get_tiles_x() + tile_x;
+        }
+
+    };
+
+}
+
+#endif
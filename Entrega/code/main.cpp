@@ -2,21 +2,31 @@
 // Este código es de dominio público
 // angel.rodriguez@udit.es
 
+#include "Benchmarks.hpp"
 #include "Scene.hpp"
 #include <Window.hpp>
 #include <SDL3/SDL_main.h>
 #include <SDL3/SDL_events.h> // Necesario para eventos
+#include <string>
 
 using udit::Scene;
 using udit::Window;
 
-int main(int, char* [])
+int main(int argc, char* argv[])
 {
+    // Con --benchmark solo se miden los algoritmos de la CPU, sin abrir la ventana
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") return udit::run_benchmarks();
+
     constexpr unsigned viewport_width = 1024;
     constexpr unsigned viewport_height = 576;
 
-    Window window("OpenGL example", viewport_width, viewport_height, { 3, 3 });
-    Scene  scene(viewport_width, viewport_height);
+    // Con --tessellation se pide un contexto 4.0 para el terreno teselado; si no, se usa 3.3.
+    // Sin GPU se puede probar con el rasterizador por software de Mesa (LIBGL_ALWAYS_SOFTWARE=1).
+    Window::OpenGL_Context_Settings context_settings;
+    if (argc > 1 && std::string(argv[1]) == "--tessellation") { context_settings.version_major = 4; context_settings.version_minor = 0; }
+
+    Window window("OpenGL example", viewport_width, viewport_height, context_settings);
+    Scene  scene(viewport_width, viewport_height, context_settings);
 
     bool  exit = false;
     float mouse_x = 0;
@@ -0,0 +1,47 @@
+#version 330
+// cdlod_terrain.vert
+// angel.rodriguez@udit.es
+
+// El parche llega como coordenadas (0..1) dentro del nodo. Se coloca en el mundo con u_node,
+// se calcula cuanto hay que fundirlo con el nivel siguiente y se desplaza con la altura.
+
+layout (location = 0) in vec2 a_grid;
+
+#include "frame_uniforms.glsl"
+
+uniform sampler2D u_height_map;
+uniform vec4  u_node;                           // (x, z, lado x, lado z) del nodo en el mundo
+uniform vec2  u_morph;                          // (inicio, fin) de la zona de transicion del nivel
+uniform vec3  u_camera_position;
+uniform vec4  u_terrain;                        // (origen x, origen z, ancho, fondo)
+uniform vec2  u_height_scale;                   // (altura maxima, desplazamiento)
+uniform float u_grid_resolution;
+
+out vec2 v_tex_coord;
+out vec3 v_normal;
+out vec3 v_frag_pos;
+
+float height_at(vec2 world_xz) {
+    vec2 uv = (world_xz - u_terrain.xy) / u_terrain.zw;
+    return textureLod(u_height_map, uv, 0.0).r * u_height_scale.x + u_height_scale.y;
+}
+
+void main() {
+    vec2 world_xz = u_node.xy + a_grid * u_node.zw;
+    float dist = distance(vec3(world_xz.x, height_at(world_xz), world_xz.y), u_camera_position);
+    float morph = clamp((dist - u_morph.x) / (u_morph.y - u_morph.x), 0.0, 1.0);
+    // Los vertices impares se desplazan hacia el par vecino hasta coincidir con la rejilla del nivel siguiente
+    vec2 frac_part = fract(a_grid * u_grid_resolution * 0.5) * 2.0 / u_grid_resolution;
+    world_xz -= frac_part * u_node.zw * morph;
+    vec2 texel = u_terrain.zw / vec2(textureSize(u_height_map, 0));
+    float h_l = height_at(world_xz - vec2(texel.x, 0.0));
+    float h_r = height_at(world_xz + vec2(texel.x, 0.0));
+    float h_d = height_at(world_xz - vec2(0.0, texel.y));
+    float h_u = height_at(world_xz + vec2(0.0, texel.y));
+    vec3 normal = normalize(vec3((h_l - h_r) * texel.y, 2.0 * texel.x * texel.y, (h_d - h_u) * texel.x));
+    vec4 position = vec4(world_xz.x, height_at(world_xz), world_xz.y, 1.0);
+    v_tex_coord = (world_xz - u_terrain.xy) / u_terrain.zw;
+    v_normal = mat3(u_view) * normal;
+    v_frag_pos = vec3(u_view * position);
+    gl_Position = u_view_projection * position;
+}
@@ -0,0 +1,51 @@
+#version 330
+// clipmap_terrain.vert
+// angel.rodriguez@udit.es
+
+// La rejilla llega en unidades de muestra del nivel (0..grid_resolution). Cerca del borde
+// exterior la altura se mezcla con la del nivel siguiente para que coincida con el anillo
+// que lo rodea y no queden grietas entre niveles.
+
+layout (location = 0) in vec2 a_grid;
+
+#include "frame_uniforms.glsl"
+
+uniform sampler2DArray u_height_map;
+uniform int   u_level;
+uniform int   u_level_count;
+uniform vec2  u_level_origin;                   // Primera muestra del nivel
+uniform float u_level_spacing;                  // Separacion de las muestras del nivel en el mundo
+uniform float u_grid_resolution;
+uniform float u_texture_scale;
+
+out vec2 v_tex_coord;
+out vec3 v_normal;
+out vec3 v_frag_pos;
+
+float sample_height(vec2 sample_xz, int level) {
+    float size = float(textureSize(u_height_map, 0).x);
+    return textureLod(u_height_map, vec3((sample_xz + 0.5) / size, float(level)), 0.0).r;
+}
+
+void main() {
+    vec2 sample_xz = u_level_origin + a_grid;
+    vec2 world_xz = sample_xz * u_level_spacing;
+    float height = sample_height(sample_xz, u_level);
+    if (u_level + 1 < u_level_count) {
+        float transition = u_grid_resolution / 10.0;
+        vec2 from_center = abs(a_grid - u_grid_resolution * 0.5);
+        vec2 alpha = clamp((from_center - (u_grid_resolution * 0.5 - transition - 1.0)) / transition, 0.0, 1.0);
+        height = mix(height, sample_height(sample_xz * 0.5, u_level + 1), max(alpha.x, alpha.y));
+    }
+    vec2 low = u_level_origin, high = u_level_origin + u_grid_resolution;
+    float h_l = sample_height(max(sample_xz - vec2(1.0, 0.0), low), u_level);
+    float h_r = sample_height(min(sample_xz + vec2(1.0, 0.0), high), u_level);
+    float h_d = sample_height(max(sample_xz - vec2(0.0, 1.0), low), u_level);
+    float h_u = sample_height(min(sample_xz + vec2(0.0, 1.0), high), u_level);
+    vec3 normal = normalize(vec3(h_l - h_r, 2.0 * u_level_spacing, h_d - h_u));
+    vec4 position = vec4(world_xz.x, height, world_xz.y, 1.0);
+    v_tex_coord = world_xz * u_texture_scale;
+    v_normal = mat3(u_view) * normal;
+    v_frag_pos = vec3(u_view * position);
+    gl_Position = u_view_projection * position;
+}
@@ -0,0 +1,15 @@
+// frame_uniforms.glsl
+// angel.rodriguez@udit.es
+
+// Camara y luz del frame, comunes a todos los programas. Se incluye tras el #version de cada
+// shader que las usa. Tiene que coincidir con Frame_Uniforms::Data (layout std140).
+
+layout (std140) uniform Frame_Uniforms {
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_view_projection;
+    vec4 u_light_dir;
+    vec4 u_light_color;
+    vec4 u_ambient_color;
+    vec4 u_fog;                                 // Color de la niebla (rgb) y densidad (a)
+};
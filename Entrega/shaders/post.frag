@@ -0,0 +1,26 @@
+#version 330 core
+// post.frag
+// angel.rodriguez@udit.es
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;                // La imagen renderizada en el paso 1
+
+void main() {
+    vec4 col = texture(screenTexture, TexCoords);
+
+    // Filtro SEPIA: Multiplicacion canales RGB por matriz de conversion estandar
+    float r = dot(col.rgb, vec3(0.393, 0.769, 0.189));
+    float g = dot(col.rgb, vec3(0.349, 0.686, 0.168));
+    float b = dot(col.rgb, vec3(0.272, 0.534, 0.131));
+    vec3 sepia = vec3(r, g, b);
+
+    // Oscurecer bordes
+    // Calculo distancia al centro multiplicando coordenadas
+    vec2 uv = TexCoords * (1.0 - TexCoords.yx);
+    float vig = uv.x * uv.y * 15.0;
+    vig = pow(vig, 0.25);
+    FragColor = vec4(sepia * vig, 1.0);
+}
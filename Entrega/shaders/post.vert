@@ -0,0 +1,15 @@
+#version 330 core
+// post.vert
+// angel.rodriguez@udit.es
+
+// Simplemente dibuja un cuadrado que cubre toda la pantalla (-1 a 1)
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main() {
+    gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);
+    TexCoords = aTexCoords;
+}
@@ -0,0 +1,98 @@
+#version 330
+// scene.frag
+// angel.rodriguez@udit.es
+
+// Iluminacion de la escena. Lo comparten el cubo y todos los modos de terreno, cada uno con su
+// propio vertex shader (todos producen v_tex_coord, v_normal y v_frag_pos en espacio de vista).
+//
+// Cada parte opcional depende de un #define (ver Scene::Lit_Feature) y cada combinacion que se
+// usa es un programa distinto, asi que lo que un objeto no necesita no se llega a compilar:
+//   ALPHA_BLENDING  transparencia con u_alpha (sin el, alfa = 1)
+//   LIGHTING        luz direccional difusa mas ambiente (sin el, solo el color de la textura)
+//   NORMAL_MAPPING  normales del normal map horneado del terreno en vez de las de los vertices
+//   FOG             niebla segun la distancia a la camara
+//   SPLATTING       materiales del terreno mezclados con el splat map en vez de u_texture
+//
+// El terreno con clipmaps define ademas TILED_TERRAIN: su v_tex_coord se repite con el mundo.
+
+#include "frame_uniforms.glsl"                  // Luz (direccion, color y ambiente), niebla y camara del frame
+
+#ifdef SPLATTING
+uniform sampler2DArray u_materials;             // Materiales del terreno (una capa cada uno)
+uniform sampler2DArray u_splat_weights;         // Peso de cada material (4 por capa RGBA)
+uniform int u_material_count;
+uniform float u_material_tiling;                // Repeticiones de los materiales sobre el terreno
+#else
+uniform sampler2D u_texture;
+#endif
+
+#ifdef ALPHA_BLENDING
+uniform float u_alpha;                          // Transparencia (1.0 = opaco, <1.0 = transparente)
+#endif
+
+#ifdef NORMAL_MAPPING
+uniform sampler2D u_normal_map;                 // Normales horneadas del terreno (x, z)
+#endif
+
+in vec2 v_tex_coord;
+in vec3 v_normal;
+in vec3 v_frag_pos;
+
+out vec4 f_color;
+
+#if defined(NORMAL_MAPPING) || defined(SPLATTING)
+// Coordenada en un mapa horneado con un texel por muestra del heightmap (normal map y pesos):
+// v_tex_coord va de 0 a 1 sobre el terreno, asi que la muestra i cae en i / (n - 1) y no en el
+// centro de su texel, (i + 0.5) / n (la misma correccion que hace terrain_displacement.vert con
+// las alturas). En el clipmap cada repeticion del mundo tiene n muestras: la i cae en i / n.
+vec2 baked_uv(vec2 size) {
+#ifdef TILED_TERRAIN
+    return v_tex_coord + 0.5 / size;
+#else
+    return (v_tex_coord * (size - 1.0) + 0.5) / size;
+#endif
+}
+#endif
+
+void main() {
+#ifdef SPLATTING
+    vec2 weights_uv = baked_uv(vec2(textureSize(u_splat_weights, 0).xy));
+    vec4 weights[2];
+    weights[0] = texture(u_splat_weights, vec3(weights_uv, 0.0));
+    weights[1] = u_material_count > 4 ? texture(u_splat_weights, vec3(weights_uv, 1.0)) : vec4(0.0);
+    vec2 material_uv = v_tex_coord * u_material_tiling;
+    vec4 tex_color = vec4(0.0);
+    for (int i = 0; i < u_material_count; ++i)
+        tex_color += weights[i / 4][i % 4] * texture(u_materials, vec3(material_uv, float(i)));
+#else
+    vec4 tex_color = texture(u_texture, v_tex_coord);
+#endif
+
+    vec3 result = tex_color.rgb;
+
+#ifdef LIGHTING
+  #ifdef NORMAL_MAPPING
+    vec2 xz = texture(u_normal_map, baked_uv(vec2(textureSize(u_normal_map, 0)))).rg;
+    vec3 norm = normalize(mat3(u_view) * vec3(xz.x, sqrt(max(1.0 - dot(xz, xz), 0.0)), xz.y));
+  #else
+    vec3 norm = normalize(v_normal);
+  #endif
+    vec3 light_dir = normalize(-u_light_dir.xyz);
+    float diff = max(dot(norm, light_dir), 0.0);
+    vec3 diffuse = diff * u_light_color.rgb;
+    vec3 ambient = u_ambient_color.rgb;
+    result = (ambient + diffuse) * result;
+#endif
+
+#ifdef FOG
+    // Niebla exponencial al cuadrado: exp(-(distancia * densidad)^2)
+    float fog_distance = length(v_frag_pos) * u_fog.a;
+    result = mix(u_fog.rgb, result, exp(-fog_distance * fog_distance));
+#endif
+
+#ifdef ALPHA_BLENDING
+    f_color = vec4(result, tex_color.a * u_alpha);
+#else
+    f_color = vec4(result, 1.0);
+#endif
+}
@@ -0,0 +1,30 @@
+#version 330
+// scene.vert
+// angel.rodriguez@udit.es
+
+layout (location = 0) in vec3 a_position;
+layout (location = 1) in vec2 a_tex_coord;
+layout (location = 2) in vec2 a_normal;         // Normal octaedrica (ver Packed_Vertex)
+
+uniform mat4 u_model_view;
+
+#include "frame_uniforms.glsl"
+
+out vec2 v_tex_coord;
+out vec3 v_normal;
+out vec3 v_frag_pos;
+
+vec3 decode_octahedral(vec2 e) {
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    if (n.y < 0.0) n.xz = (1.0 - abs(n.zx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main() {
+    v_tex_coord = a_tex_coord;
+    // IMPORTANTE: Transformamos la normal al 'Espacio de la Vista' (View Space)
+    // Esto permite que la luz reaccione correctamente cuando la camara se mueve.
+    v_normal = mat3(u_model_view) * decode_octahedral(a_normal);
+    v_frag_pos = vec3(u_model_view * vec4(a_position, 1.0));
+    gl_Position = u_projection * u_model_view * vec4(a_position, 1.0);
+}
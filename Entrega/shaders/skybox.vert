@@ -0,0 +1,16 @@
+#version 330
+// skybox.vert
+// angel.rodriguez@udit.es
+
+#include "frame_uniforms.glsl"
+
+layout (location = 0) in vec3 vertex_coordinates;
+
+out vec3 texture_coordinates;
+
+void main()
+{
+   texture_coordinates = vec3(vertex_coordinates.x, -vertex_coordinates.y, vertex_coordinates.z);
+   // Solo la rotacion de la vista: el cubo se queda centrado en la camara
+   gl_Position = u_projection * mat4(mat3(u_view)) * vec4(vertex_coordinates, 1.0);
+}
@@ -0,0 +1,40 @@
+#version 330
+// terrain_displacement.vert
+// angel.rodriguez@udit.es
+
+// Terreno con Terrain::GPU_DISPLACEMENT. La rejilla llega normalizada (0..1). La altura y la
+// normal se leen de la textura en las mismas posiciones de texel que usa la malla de CPU, asi
+// que los dos modos coinciden. Produce las mismas salidas que scene.vert.
+
+layout (location = 0) in vec2 a_grid;
+
+#include "frame_uniforms.glsl"
+
+uniform sampler2D u_height_map;
+uniform vec4 u_terrain;                         // (origen x, origen z, ancho, fondo)
+uniform vec2 u_height_scale;                    // (altura maxima, desplazamiento)
+uniform vec2 u_grid_step;                       // (1 / x_slices, 1 / z_slices)
+
+out vec2 v_tex_coord;
+out vec3 v_normal;
+out vec3 v_frag_pos;
+
+float height_at(vec2 grid) {
+    vec2 size = vec2(textureSize(u_height_map, 0));
+    vec2 uv = (clamp(grid, 0.0, 1.0) * (size - 1.0) + 0.5) / size;
+    return textureLod(u_height_map, uv, 0.0).r * u_height_scale.x + u_height_scale.y;
+}
+
+void main() {
+    float h_l = height_at(a_grid - vec2(u_grid_step.x, 0.0));
+    float h_r = height_at(a_grid + vec2(u_grid_step.x, 0.0));
+    float h_d = height_at(a_grid - vec2(0.0, u_grid_step.y));
+    float h_u = height_at(a_grid + vec2(0.0, u_grid_step.y));
+    vec2 step = u_terrain.zw * u_grid_step;
+    vec3 normal = normalize(vec3((h_l - h_r) * step.y, 2.0 * step.x * step.y, (h_d - h_u) * step.x));
+    vec4 position = vec4(u_terrain.x + a_grid.x * u_terrain.z, height_at(a_grid), u_terrain.y + a_grid.y * u_terrain.w, 1.0);
+    v_tex_coord = a_grid;
+    v_normal = mat3(u_view) * normal;
+    v_frag_pos = vec3(u_view * position);
+    gl_Position = u_view_projection * position;
+}
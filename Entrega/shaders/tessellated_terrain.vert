@@ -0,0 +1,17 @@
+#version 400 core
+// tessellated_terrain.vert
+// angel.rodriguez@udit.es
+
+// Cada vertice del parche lleva su posicion (0..1) en el terreno y las alturas minima y maxima
+// del parche (iguales en sus 4 vertices) para descartarlo contra el frustum sin leer la textura.
+
+layout (location = 0) in vec2 a_grid;
+layout (location = 1) in vec2 a_height_bounds;
+
+out vec2 tc_grid;
+out vec2 tc_height_bounds;
+
+void main() {
+    tc_grid = a_grid;
+    tc_height_bounds = a_height_bounds;
+}
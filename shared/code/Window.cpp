@@ -1,5 +1,5 @@
 
-// Este cdigo es de dominio pblico
+// Este código es de dominio público
 // angel.rodriguez@udit.es
 
 #pragma once
@@ -62,7 +62,7 @@ namespace udit
 
         assert(glad_is_initialized);
 
-        // Se activa la sincronizacin con el refresco vertical del display:
+        // Se activa la sincronización con el refresco vertical del display:
 
         SDL_GL_SetSwapInterval (context_details.enable_vsync ? 1 : 0);
     }
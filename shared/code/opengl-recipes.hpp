@@ -1,5 +1,5 @@
 
-// Este cdigo es de dominio pblico
+// Este código es de dominio público
 // angel.rodriguez@udit.es
 
 #pragma once
@@ -14,12 +14,6 @@
 namespace udit
 {
 
-    GLuint compile_shaders        (const std::string & vertex_shader_code, const std::string & fragment_shader_code);
-    void   show_compilation_error (GLuint  shader_id);
-    void   show_linkage_error     (GLuint program_id);
-
-    // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // // //
-
     template< typename COLOR_FORMAT >
     std::unique_ptr< Color_Buffer< COLOR_FORMAT > > load_image (const std::string & image_path)
     {
@@ -53,7 +47,7 @@ namespace udit
                 reinterpret_cast< uint8_t * >(image->colors ())
             );
 
-            // Se libera la memoria que reserv SOIL2 para cargar la imagen:
+            // Se libera la memoria que reservó SOIL2 para cargar la imagen:
 
             SOIL_free_image_data (loaded_pixels);
 